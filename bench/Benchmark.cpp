@@ -0,0 +1,430 @@
+/**
+ * @file Benchmark.cpp
+ * @brief Benchmark suite for the spreadsheet core classes.
+ *
+ * Measures Tokenizer::tokenize, LexicalAnalysis::evaluateFormula,
+ * LexicalAnalysis::calculateRangeFunction and SUMIF/COUNTIF/AVERIF (row and column layouts), CellMatrix::loadFromFile/saveToFile,
+ * cell reads under a memory budget that spills blocks to disk, whole-sheet background and level-parallel recalculation,
+ * incremental recalculation of a workbook whose second sheet references the first,
+ * RangeIndex::findCovering over many column ranges,
+ * Spreadsheet::display (rendered to an in-memory sink) and Spreadsheet::sortByColumn on a synthetic sheet,
+ * PivotTable::aggregate grouping a million generated rows,
+ * and reports ns/op and allocations/op for each case, after the cell memory report.
+ *
+ * The sheet comes from SheetGenerator, so runs with the same options are comparable.
+ *
+ * Usage: Benchmark [--rows N] [--cols N] [--density F] [--chain-depth N] [--iterations N] [--seed N]
+ */
+
+#include "CellMatrix.h"
+#include "DependencyGraph.h"
+#include "LazyEvaluator.h"
+#include "LexicalAnalysis.h"
+#include "PivotTable.h"
+#include "RecalcEngine.h"
+#include "SheetGenerator.h"
+#include "Spreadsheet.h"
+#include "Tokenizer.h"
+#include "Workbook.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Every heap allocation made by the process goes through these operators,
+// so the difference of the counter around a benchmark gives allocations/op.
+static std::atomic<unsigned long long> allocationCount(0);
+
+// Both new forms allocate, and every delete form releases, through the same pair of helpers
+static void* countedAllocate(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+static void countedRelease(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void operator delete(void* ptr) noexcept { countedRelease(ptr); }
+void operator delete[](void* ptr) noexcept { countedRelease(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { countedRelease(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { countedRelease(ptr); }
+
+/**
+ * @brief Options controlling the size and shape of the synthetic sheet.
+ */
+struct BenchConfig {
+    int rows = 200;          ///< Number of rows in the synthetic sheet.
+    int cols = 10;           ///< Number of columns in the synthetic sheet.
+    double density = 0.5;    ///< Fraction of cells (outside column A) holding a formula.
+    int chainDepth = 10;     ///< Maximum length of the generated reference chains.
+    int iterations = 5;      ///< Number of timed repetitions for each case.
+    unsigned seed = 42;      ///< Seed of the synthetic sheet content.
+};
+
+/**
+ * @brief Result of a single benchmark case.
+ */
+struct BenchResult {
+    std::string name;        ///< Name of the benchmark case.
+    long long ops;           ///< Total number of operations measured.
+    double nsPerOp;          ///< Average wall time per operation in nanoseconds.
+    double allocsPerOp;      ///< Average heap allocations per operation.
+};
+
+// Accumulates results so the optimizer cannot drop the measured work.
+static std::size_t benchSink = 0;
+
+/**
+ * @brief Runs a benchmark body the configured number of times.
+ * @param name Name of the case.
+ * @param iterations Number of repetitions.
+ * @param body Callable executing one repetition and returning the number of operations it did.
+ */
+template <typename Body>
+static BenchResult runBenchmark(const std::string& name, int iterations, Body body) {
+    body(); // warm-up
+
+    long long ops = 0;
+    unsigned long long allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        ops += body();
+    }
+    auto end = std::chrono::steady_clock::now();
+    unsigned long long allocations = allocationCount.load() - allocationsBefore;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    ops = std::max(ops, 1LL);
+    return { name, ops, ns / ops, static_cast<double>(allocations) / ops };
+}
+
+static void printResult(const BenchResult& result) {
+    std::cout << std::left << std::setw(26) << result.name
+              << std::right << std::setw(12) << result.ops
+              << std::setw(16) << std::fixed << std::setprecision(1) << result.nsPerOp
+              << std::setw(16) << std::setprecision(2) << result.allocsPerOp << "\n";
+}
+
+static bool parseArguments(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--rows") config.rows = std::stoi(value);
+        else if (arg == "--cols") config.cols = std::stoi(value);
+        else if (arg == "--density") config.density = std::stod(value);
+        else if (arg == "--chain-depth") config.chainDepth = std::stoi(value);
+        else if (arg == "--iterations") config.iterations = std::stoi(value);
+        else if (arg == "--seed") config.seed = static_cast<unsigned>(std::stoul(value));
+        else {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    if (config.rows < 1 || config.cols < 2 || config.iterations < 1) {
+        std::cerr << "rows must be >= 1, cols >= 2 and iterations >= 1\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        std::cerr << "Usage: Benchmark [--rows N] [--cols N] [--density F] [--chain-depth N] [--iterations N] [--seed N]\n";
+        return 1;
+    }
+
+    GeneratorOptions options;
+    options.rows = config.rows;
+    options.cols = config.cols;
+    options.formulaRatio = config.density;
+    options.labelRatio = std::min(0.1, 1.0 - config.density);
+    options.chainDepth = config.chainDepth;
+    options.seed = config.seed;
+
+    std::string csvPath = "benchmark_sheet.csv";
+    Spreadsheet sheet(config.rows, config.cols);
+    sheet.setWindowSize(10);
+    try {
+        if (!SheetGenerator(options).writeToFile(csvPath) || !sheet.data.loadFromFile(csvPath)) {
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    Tokenizer tokenizer = Tokenizer::createDefault();
+    LexicalAnalysis analyzer(tokenizer, sheet.data);
+
+    // Collect cell contents and pre-tokenized formulas once, outside the timed loops
+    std::vector<std::string> contents;
+    std::vector<std::vector<Token>> formulas;
+    for (int r = 0; r < sheet.data.getRows(); ++r) {
+        for (int c = 0; c < sheet.data.getCols(); ++c) {
+            const std::string& content = sheet.data(r, c);
+            contents.push_back(content);
+            if (!content.empty() && content[0] == '=') {
+                formulas.push_back(tokenizer.tokenize(content));
+            }
+        }
+    }
+
+
+    std::cout << "Synthetic sheet: " << config.rows << " rows x " << config.cols << " cols, "
+              << formulas.size() << " formulas, density " << config.density
+              << ", seed " << config.seed << "\n\n";
+    std::cout << "Cell memory:\n";
+    sheet.data.writeMemoryReport(std::cout);
+    std::cout << "\n";
+    std::cout << std::left << std::setw(26) << "benchmark"
+              << std::right << std::setw(12) << "ops"
+              << std::setw(16) << "ns/op"
+              << std::setw(16) << "allocs/op" << "\n";
+
+    printResult(runBenchmark("tokenize", config.iterations, [&]() {
+        for (const auto& content : contents) {
+            benchSink += tokenizer.tokenize(content).size();
+        }
+        return static_cast<long long>(contents.size());
+    }));
+
+    printResult(runBenchmark("evaluateFormula", config.iterations, [&]() {
+        for (const auto& tokens : formulas) {
+            benchSink += analyzer.evaluateFormula(tokens).size();
+        }
+        return static_cast<long long>(formulas.size());
+    }));
+
+    const std::vector<std::string> labels = { "SUM", "AVER", "MAX", "MIN", "STDDEV" };
+    std::string lastCell = "A" + std::to_string(std::min(config.rows, 999));
+    printResult(runBenchmark("calculateRangeFunction", config.iterations, [&]() {
+        for (const auto& label : labels) {
+            benchSink += analyzer.calculateRangeFunction(label, "A1", lastCell).size();
+        }
+        return static_cast<long long>(labels.size());
+    }));
+
+    std::string lastValueCell = "B" + lastCell.substr(1);
+    const std::vector<std::string> conditionals = { "SUMIF(A1.." + lastCell + ";>50)", "COUNTIF(A1.." + lastCell + ";<>0)",
+                                                    "AVERIF(A1.." + lastCell + ";>=10;B1.." + lastValueCell + ")" };
+    printResult(runBenchmark("conditional aggregates", config.iterations, [&]() {
+        for (const auto& expression : conditionals) {
+            benchSink += analyzer.evaluateLabelFunction(expression).size();
+        }
+        return static_cast<long long>(conditionals.size());
+    }));
+
+    // The same aggregates over the contiguous numeric columns of the ColumnMajor layout
+    sheet.data.setLayout(CellLayout::ColumnMajor);
+    printResult(runBenchmark("rangeFunction columnar", config.iterations, [&]() {
+        for (const auto& label : labels) {
+            benchSink += analyzer.calculateRangeFunction(label, "A1", lastCell).size();
+        }
+        return static_cast<long long>(labels.size());
+    }));
+    printResult(runBenchmark("conditional columnar", config.iterations, [&]() {
+        for (const auto& expression : conditionals) {
+            benchSink += analyzer.evaluateLabelFunction(expression).size();
+        }
+        return static_cast<long long>(conditionals.size());
+    }));
+    sheet.data.setLayout(CellLayout::RowMajor);
+
+    // Reads every cell while only a quarter of the blocks may stay in memory
+    CellMatrix budgeted = sheet.data.snapshot();
+    budgeted.setMemoryBudget(budgeted.getSpillStats().residentBytes / 4);
+    printResult(runBenchmark("scan budget 1/4", config.iterations, [&]() {
+        for (int r = 0; r < budgeted.getRows(); ++r) {
+            for (int c = 0; c < budgeted.getCols(); ++c) {
+                benchSink += budgeted(r, c).size();
+            }
+        }
+        budgeted.enforceMemoryBudget();
+        return static_cast<long long>(budgeted.getRows()) * budgeted.getCols();
+    }));
+
+    printResult(runBenchmark("saveToFile", config.iterations, [&]() {
+        benchSink += sheet.data.saveToFile(csvPath);
+        return 1LL;
+    }));
+
+    CellMatrix loaded;
+    printResult(runBenchmark("loadFromFile", config.iterations, [&]() {
+        benchSink += loaded.loadFromFile(csvPath);
+        return 1LL;
+    }));
+
+    printResult(runBenchmark("recalculate", config.iterations, [&]() {
+        sheet.data.setValue(1, 1, std::to_string(benchSink % 1000)); // new version to evaluate
+        sheet.recalculate();
+        return 1LL;
+    }));
+
+    // Batch recalculation scaling: one thread against every hardware thread
+    std::vector<unsigned> threadCounts = { 1 };
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : threadCounts) {
+        RecalcEngine engine(threads);
+        printResult(runBenchmark("recalc " + std::to_string(threads) + " thread(s)", config.iterations, [&]() {
+            engine.invalidate();
+            benchSink += engine.recalculate(sheet.data, []() { return false; })->sheets[0].blocks.size();
+            return 1LL;
+        }));
+    }
+
+    // An edit of the synthetic sheet recalculates only the cells of a second sheet reading that cell
+    Workbook book(sheet.data);
+    CellMatrix& summary = book.getSheet(book.addSheet("Summary"));
+    for (int r = 1; r <= std::min(config.rows, MAXROWSIZE); ++r) {
+        summary.setValue(r, 1, "=Sheet1!A" + std::to_string(r) + "*2");
+    }
+    summary.setValue(1, 2, "=SUM(Sheet1!A1.." + lastCell + ")");
+    RecalcEngine bookEngine;
+    bookEngine.recalculate(book, []() { return false; });
+    printResult(runBenchmark("recalc cross-sheet edit", config.iterations, [&]() {
+        book.getSheet(0).setValue(1, 1, std::to_string(benchSink % 1000));
+        benchSink += bookEngine.recalculate(book, []() { return false; })->sheets.size();
+        return 1LL;
+    }));
+
+    // Finds the formulas whose range covers a cell among 100000 ranges over 100 columns
+    RangeIndex rangeIndex;
+    for (int i = 0; i < 100000; ++i) {
+        CellRange range;
+        range.startCol = range.endCol = i % 100;
+        range.startRow = (i * 7919) % 100000;
+        range.endRow = range.startRow + i % 1000;
+        rangeIndex.add(range, static_cast<std::size_t>(i));
+    }
+    rangeIndex.refresh();
+    std::vector<std::size_t> covering;
+    printResult(runBenchmark("range index query", config.iterations, [&]() {
+        for (int i = 0; i < 1000; ++i) {
+            covering.clear();
+            rangeIndex.findCovering(0, (i * 104729) % 100000, i % 100, covering);
+            benchSink += covering.size();
+        }
+        return 1000LL;
+    }));
+
+    // Render into an in-memory sink instead of the terminal, from published values
+    sheet.recalculate();
+    AnsiTerminal terminal;
+    std::ostringstream sink;
+    std::streambuf* original = std::cout.rdbuf(sink.rdbuf());
+    BenchResult render = runBenchmark("display", config.iterations, [&]() {
+        sink.str("");
+        sheet.display(terminal, 0, 0, 0, 0);
+        benchSink += sink.str().size();
+        return 1LL;
+    });
+    std::cout.rdbuf(original);
+    printResult(render);
+
+    // The first screen of a freshly loaded sheet evaluated on demand, against "recalc 1 thread(s)"
+    std::size_t lazyEvaluated = 0;
+    printResult(runBenchmark("lazy first screen", config.iterations, [&]() {
+        LazyEvaluator lazy(sheet.workbook);
+        for (int r = 0; r < 10; ++r) {
+            for (int c = 0; c < 10; ++c) {
+                benchSink += lazy.getDisplayText(0, r, c).size();
+            }
+        }
+        lazyEvaluated = lazy.getEvaluatedCount();
+        return 1LL;
+    }));
+    std::cout << "  lazy first screen evaluated " << lazyEvaluated << " cells\n";
+
+    // Reorders the row view over the computed values; the cells stay in place
+    bool ascending = true;
+    printResult(runBenchmark("sortByColumn", config.iterations, [&]() {
+        sheet.sortByColumn(1, ascending);
+        ascending = !ascending;
+        benchSink += sheet.getSourceRow(0);
+        return static_cast<long long>(sheet.getVisibleRows());
+    }));
+    sheet.clearView();
+
+    // Writes a formula into every row of one column, cell by cell and as one block
+    CellMatrix column = sheet.data.snapshot();
+    printResult(runBenchmark("setValue column", config.iterations, [&]() {
+        for (int r = 1; r <= column.getRows(); ++r) {
+            column.setValue(r, 1, "=B" + std::to_string(r) + "*2");
+        }
+        return static_cast<long long>(column.getRows());
+    }));
+    std::vector<std::vector<std::string>> columnValues(column.getRows(), std::vector<std::string>(1));
+    printResult(runBenchmark("setBlock column", config.iterations, [&]() {
+        for (int r = 1; r <= column.getRows(); ++r) {
+            columnValues[r - 1][0] = "=B" + std::to_string(r) + "*2";
+        }
+        column.setBlock(1, 1, columnValues);
+        return static_cast<long long>(column.getRows());
+    }));
+    // Includes shifting the references of every copy
+    sheet.data.setValue(1, 1, "=B1*2+SUM(C1..C5)");
+    printResult(runBenchmark("fillDown column", config.iterations, [&]() {
+        sheet.fillDown(0, 0, sheet.data.getRows() - 1, 0);
+        return static_cast<long long>(sheet.data.getRows() - 1);
+    }));
+
+    // Inserts and deletes a row near the top of 100k rows; one cell in a hundred is a formula to rewrite
+    std::vector<std::vector<std::string>> structureRows(100000);
+    for (int r = 0; r < static_cast<int>(structureRows.size()); ++r) {
+        structureRows[r] = { std::to_string(r), r % 100 == 0 ? "=A" + std::to_string(r + 1) + "*2" : "x" };
+    }
+    CellMatrix structureData;
+    structureData.setRows(structureRows);
+    Workbook structureBook(structureData);
+    printResult(runBenchmark("insert/delete row", config.iterations, [&]() {
+        structureBook.insertRows(0, 3, 1);
+        structureBook.deleteRows(0, 3, 1);
+        return static_cast<long long>(structureBook.getSheet(0).getRows());
+    }));
+    printResult(runBenchmark("insert/delete 64 rows", config.iterations, [&]() {
+        structureBook.insertRows(0, 65, 64);
+        structureBook.deleteRows(0, 65, 64);
+        return static_cast<long long>(structureBook.getSheet(0).getRows());
+    }));
+
+    // Groups a million rows by a text and a numeric key, aggregating two value columns
+    const int pivotRowCount = 1000000;
+    std::vector<std::vector<std::string>> pivotRows(pivotRowCount);
+    for (int r = 0; r < pivotRowCount; ++r) {
+        pivotRows[r] = { "Item" + std::to_string(r % 1000), std::to_string(r % 7),
+                         std::to_string(r % 97), std::to_string((r * 31) % 1000) + ".5" };
+    }
+    CellMatrix pivotData;
+    pivotData.setRows(pivotRows);
+    PivotTable pivot({ 0, 1 }, { { 2, "SUM" }, { 3, "AVER" }, { 3, "STDDEV" } });
+    ThreadPool pivotPool;
+    printResult(runBenchmark("pivot 1M rows", config.iterations, [&]() {
+        pivot.aggregate(pivotData, 0, pivotData.getRows() - 1, pivotPool);
+        benchSink += pivot.getGroupCount();
+        return static_cast<long long>(pivotRowCount);
+    }));
+
+    std::remove(csvPath.c_str());
+    return benchSink > 0 ? 0 : 1;
+}
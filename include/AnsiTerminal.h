@@ -28,6 +28,9 @@ public:
     // or detect other key combinations such as Alt+Key, Ctrl+Key, etc.
     char getSpecialKey();
 
+    // Wait up to timeoutMs milliseconds for a keystroke; returns true if one is ready to read
+    bool waitForInput(int timeoutMs);
+
 private:
     struct termios original_tio; // Holds the original terminal settings
 };
@@ -0,0 +1,95 @@
+/**
+ * @file AutoSaver.h
+ * @brief Declaration of the AutoSaver class that periodically saves sheet snapshots on a worker thread.
+ */
+
+#ifndef AUTO_SAVER_H
+#define AUTO_SAVER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "CellMatrix.h"
+
+/**
+ * @brief Default time between two autosaves in milliseconds.
+ */
+#define AUTOSAVEINTERVALMS 5000
+
+/**
+ * @class AutoSaver
+ * @brief Writes the latest snapshot of a sheet to an autosave file in the background.
+ *
+ * The editing thread hands over CellMatrix snapshots, which share their blocks
+ * with the live sheet, so editing continues while the worker serializes.
+ * Only the newest snapshot is kept, and unchanged versions are not written again.
+ */
+class AutoSaver {
+public:
+    /**
+     * @brief Starts the worker thread.
+     * @param intervalMs Time between two autosaves in milliseconds.
+     */
+    explicit AutoSaver(int intervalMs = AUTOSAVEINTERVALMS);
+
+    /**
+     * @brief Stops the worker thread without a final save.
+     */
+    ~AutoSaver();
+
+    AutoSaver(const AutoSaver&) = delete;
+    AutoSaver& operator=(const AutoSaver&) = delete;
+
+    /**
+     * @brief Sets the file the snapshots are written to.
+     * @param path The autosave file; an empty path disables autosaving.
+     */
+    void setPath(const std::string& path);
+
+    /**
+     * @brief Hands over the current content for the next autosave.
+     * @param data The cell data; a snapshot of it is taken.
+     */
+    void update(const CellMatrix& data);
+
+    /**
+     * @brief Writes the latest snapshot now and waits for it to be on disk.
+     * @return False if writing the file failed.
+     */
+    bool flush();
+
+    /**
+     * @brief Gets the data version of the last successful autosave.
+     */
+    std::uint64_t getSavedVersion() const;
+
+private:
+    /**
+     * @brief Worker thread loop: saves the newest snapshot once per interval.
+     */
+    void run();
+
+    /**
+     * @brief Writes the pending snapshot if it is newer than the last autosave.
+     * @param lock The held lock on mutex; released while writing.
+     * @return False if writing the file failed.
+     */
+    bool saveLocked(std::unique_lock<std::mutex>& lock);
+
+    const int intervalMs;                 ///< Time between two autosaves.
+    mutable std::mutex mutex;             ///< Guards every member below.
+    std::condition_variable wakeWorker;   ///< Signals shutdown.
+    std::unique_ptr<CellMatrix> pending;  ///< Newest snapshot handed over.
+    std::string path;                     ///< Autosave file; empty when disabled.
+    std::uint64_t savedVersion;           ///< Version of the last successful autosave.
+    bool hasSaved;                        ///< True once any snapshot was written.
+    bool saving;                          ///< True while a snapshot is being written.
+    std::condition_variable saved;        ///< Signals that a write finished.
+    bool stopping;                        ///< Set when the worker must exit.
+    std::thread worker;                   ///< The autosave thread.
+};
+
+#endif // AUTO_SAVER_H
@@ -0,0 +1,101 @@
+/**
+ * @file BackgroundRecalculator.h
+ * @brief Declaration of the BackgroundRecalculator class that evaluates a workbook on a worker thread.
+ *
+ * The input thread hands over a copy of the sheets together with their version
+ * and keeps handling keystrokes. The worker evaluates every cell and publishes
+ * the results as an immutable ValueSnapshot; the renderer keeps showing the
+ * previous snapshot until the new one is published. A newer request aborts a
+ * recalculation that is still running, so only the latest edit is computed.
+ */
+
+#ifndef BACKGROUND_RECALCULATOR_H
+#define BACKGROUND_RECALCULATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CellMatrix.h"
+#include "RecalcEngine.h"
+#include "ValueSnapshot.h"
+#include "Workbook.h"
+
+/**
+ * @class BackgroundRecalculator
+ * @brief Runs whole-workbook recalculation on a worker thread and publishes snapshots.
+ */
+class BackgroundRecalculator {
+public:
+    /**
+     * @brief Starts the worker thread.
+     * @param threadCount Number of threads evaluating cells; 0 uses the number of hardware threads.
+     */
+    explicit BackgroundRecalculator(unsigned threadCount = 0);
+
+    /**
+     * @brief Stops the worker thread, abandoning any running recalculation.
+     */
+    ~BackgroundRecalculator();
+
+    BackgroundRecalculator(const BackgroundRecalculator&) = delete;
+    BackgroundRecalculator& operator=(const BackgroundRecalculator&) = delete;
+
+    /**
+     * @brief Schedules a recalculation of the given sheets.
+     *
+     * Does nothing if this version is already published or scheduled. A
+     * recalculation of an older version that is still running is abandoned.
+     *
+     * @param book The sheets to evaluate; a snapshot of them is taken.
+     */
+    void request(const Workbook& book);
+
+    /**
+     * @brief Gets the most recently published snapshot.
+     * @return The latest snapshot, or nullptr if nothing was computed yet.
+     */
+    std::shared_ptr<const ValueSnapshot> latest() const;
+
+    /**
+     * @brief Checks whether a recalculation is scheduled or running.
+     * @return True while the worker has not published the latest requested version.
+     */
+    bool isCalculating() const;
+
+    /**
+     * @brief Blocks until the latest requested version has been published.
+     */
+    void waitUntilIdle();
+
+private:
+    /**
+     * @brief Worker thread loop: waits for requests and evaluates them.
+     */
+    void run();
+
+    /**
+     * @brief Evaluates every cell of the sheets.
+     * @return The computed snapshot, or nullptr if a newer request arrived meanwhile.
+     */
+    std::shared_ptr<const ValueSnapshot> evaluate(const Workbook& book, std::uint64_t version);
+
+    RecalcEngine engine;                           ///< Parallel evaluator, used by the worker only.
+
+    mutable std::mutex mutex;                      ///< Guards every member below except the atomics.
+    std::condition_variable wakeWorker;            ///< Signals a new request or shutdown.
+    std::condition_variable idle;                  ///< Signals that a snapshot was published.
+    std::unique_ptr<Workbook> pending;             ///< Sheets waiting to be evaluated.
+    std::uint64_t requestedVersion;                ///< Version of the latest request.
+    bool hasRequest;                               ///< True once any request was made.
+    std::shared_ptr<const ValueSnapshot> published;///< Latest published snapshot.
+    std::atomic<std::uint64_t> newestVersion;      ///< Lets the worker notice newer requests mid-run.
+    std::atomic<bool> stopping;                    ///< Set when the worker must exit.
+    std::thread worker;                            ///< The recalculation thread.
+};
+
+#endif // BACKGROUND_RECALCULATOR_H
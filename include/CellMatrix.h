@@ -12,6 +12,17 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <functional>
+#include "IoProgress.h"
+#include "StringPool.h"
+#include "NumericColumn.h"
+#include "LookupIndex.h"
+#include "SpillStore.h"
+#include <atomic>
 /**
  * @file CellMatrix.h
  * @brief Defines the CellMatrix class for managing a 2D grid of cells.
@@ -27,6 +38,29 @@
  */
 #define MAXCOLUMNSIZE 100
 
+/**
+ * @brief Maximum number of single-cell edits kept in the change log.
+ */
+#define MAXCHANGELOG 4096
+
+/**
+ * @brief The change log file of a CSV is compacted into it once larger than 1/MAXCHANGEFILEFRACTION of the CSV.
+ */
+#define MAXCHANGEFILEFRACTION 4
+
+/**
+ * @brief Number of rows stored together in one copy-on-write block.
+ */
+#define ROWSPERBLOCK 64
+
+/**
+ * @brief How a matrix keeps its cells, see CellMatrix::setLayout.
+ */
+enum class CellLayout {
+    RowMajor,   ///< Cell texts only, stored by row.
+    ColumnMajor ///< Cell texts, plus the numbers of every column in a contiguous NumericColumn.
+};
+
 /**
  * @class CellMatrix
  * @brief Represents a 2D matrix of cells, each storing a string value.
@@ -34,6 +68,28 @@
  * This class provides dynamic resizing capabilities while enforcing a maximum 
  * row and column limit. It supports direct access to cell values via 
  * operator() overloading.
+ *
+ * Rows are stored in reference-counted blocks of ROWSPERBLOCK rows. Copying a
+ * matrix only shares the blocks; a block is copied the first time one of its
+ * cells is written while another matrix still shares it.
+ *
+ * A cell holds a pointer into the sheet's StringPool, so each distinct text is
+ * stored once however many cells contain it.
+ *
+ * In the ColumnMajor layout every column also keeps its numeric cells in a
+ * NumericColumn, so column aggregates scan a contiguous array of doubles. The
+ * columns are shared with snapshots and copied on write like the row blocks.
+ *
+ * LOOKUP and MATCH use a hash index per column, built on first use and
+ * dropped when a cell of the column is set.
+ *
+ * Rows and columns can be inserted and deleted in place; the cells whose text
+ * may reference another cell are tracked so that rewriteReferences() only
+ * visits those.
+ *
+ * Under a memory budget (setMemoryBudget) the least recently used blocks are
+ * written to a temporary file and dropped, and read back the next time one of
+ * their cells is accessed.
  */
 class CellMatrix {
 public:
@@ -45,6 +101,16 @@ public:
      */
     CellMatrix(int rows=20, int cols=20);
 
+    /**
+     * @brief Takes an immutable copy of the current content in constant time.
+     *
+     * The snapshot shares every block with this matrix; later writes to either
+     * side copy the touched block only.
+     *
+     * @return A matrix holding the current cells, version and change log.
+     */
+    CellMatrix snapshot() const { return *this; }
+
 
     void resizeIfNeeded(int newRow, int newCol);
     // /**
@@ -64,6 +130,14 @@ public:
      * Returns an empty string if out of range.
      */
     const std::string& operator()(int row, int col) const;
+
+    /**
+     * @brief Gets whether a cell holds a number, and its value, as classified when its text was stored.
+     * @param row The row index of the cell (0-based).
+     * @param col The column index of the cell (0-based).
+     * @return The classification of the cell's text; an empty text for cells out of range.
+     */
+    const TextNumber& getNumber(int row, int col) const { return StringPool::numberOf(&(*this)(row, col)); }
     
     /**
      * @brief Retrieves the value of a cell in the matrix at the specified row and column.
@@ -94,6 +168,81 @@ public:
      */
     void setValue(int row, int col, const std::string& value);
 
+    /**
+     * @brief Sets the contents of a rectangle of cells as one modification.
+     *
+     * The matrix is resized once to fit the block, the lookup indexes of the
+     * touched columns are dropped once and the version advances once, so a
+     * recalculation sees a single edit listing every written cell. Cells past
+     * the end of a shorter row of values keep their content.
+     *
+     * @param row The row of the top left cell (1-based index).
+     * @param col The column of the top left cell (1-based index).
+     * @param values The contents by row, then by column.
+     */
+    void setBlock(int row, int col, const std::vector<std::vector<std::string>>& values);
+
+    /**
+     * @brief Empties a rectangle of cells as one modification; the size does not change.
+     *
+     * Cleared cells hold the empty text, as after setting them to "". Only
+     * cells holding more than spaces are written and listed as changed, so
+     * the padding resizing leaves is not. The rectangle is clipped to the
+     * matrix.
+     *
+     * @param firstRow The first row (1-based index).
+     * @param firstCol The first column (1-based index).
+     * @param lastRow The last row, inclusive.
+     * @param lastCol The last column, inclusive.
+     */
+    void clearRange(int firstRow, int firstCol, int lastRow, int lastCol);
+
+    /**
+     * @brief Inserts empty rows, moving the rows at and below row down.
+     *
+     * Rows are moved within their blocks, or whole blocks are inserted when the
+     * rows start a block and fill whole blocks. Cell texts are not rewritten;
+     * see Workbook::insertRows for moving the references.
+     *
+     * @param row The first inserted row (1-based index); nothing happens past the last row.
+     * @param count The number of rows to insert.
+     */
+    void insertRows(int row, int count);
+
+    /**
+     * @brief Deletes rows, moving the rows below them up.
+     * @param row The first deleted row (1-based index).
+     * @param count The number of rows to delete, clipped to the matrix.
+     */
+    void deleteRows(int row, int count);
+
+    /**
+     * @brief Inserts empty columns, moving the columns at and right of col to the right.
+     * @param col The first inserted column (1-based index); nothing happens past the last column.
+     * @param count The number of columns to insert.
+     */
+    void insertColumns(int col, int count);
+
+    /**
+     * @brief Deletes columns, moving the columns right of them to the left.
+     * @param col The first deleted column (1-based index).
+     * @param count The number of columns to delete, clipped to the matrix.
+     */
+    void deleteColumns(int col, int count);
+
+    /**
+     * @brief Rewrites the cells whose text may reference a cell, as one modification.
+     *
+     * Only the cells whose text has a capital letter followed by a digit are
+     * visited (see StringPool::mayReference); they are found by scanning the
+     * matrix once, then tracked through edits. rewrite is called once per
+     * distinct text, however many cells hold it.
+     *
+     * @param rewrite Gives the new text of a cell from its current text.
+     * @return The number of cells whose text changed.
+     */
+    std::size_t rewriteReferences(const std::function<std::string(const std::string&)>& rewrite);
+
 
     /**
      * @brief Resizes the matrix to the specified dimensions.
@@ -117,6 +266,28 @@ public:
 
     void clear();
 
+    /**
+     * @brief Gets the modification counter of the matrix.
+     *
+     * The counter changes whenever a cell, the size or the whole content changes,
+     * so cached results computed from one version can be recognised as stale.
+     *
+     * @return The current version.
+     */
+    std::uint64_t getVersion() const { return version; }
+
+    /**
+     * @brief Lists the cells modified after a given version.
+     *
+     * Only cell edits are logged, a block edit listing each of its cells. Loading, clearing and resizing replace
+     * the whole content, after which earlier versions cannot be caught up cell
+     * by cell. The log keeps the most recent MAXCHANGELOG edits.
+     *
+     * @param sinceVersion The version the caller has already processed.
+     * @param cells Receives the 0-based (row, col) of each modified cell, oldest first.
+     * @return True if the modified cells are known; false if the caller has to reprocess everything.
+     */
+    bool changesSince(std::uint64_t sinceVersion, std::vector<std::pair<int, int>>& cells) const;
 
 
     /**
@@ -126,6 +297,18 @@ public:
      */
     bool loadFromFile(const std::string& filename);
 
+    /**
+     * @brief Loads the matrix data from a CSV file, reporting progress as rows are parsed.
+     *
+     * Cell edits recorded in the file's change log are applied on top of the CSV.
+     * On failure or cancellation the matrix is left unchanged.
+     *
+     * @param filename The path to the CSV file.
+     * @param progress Receives bytes and rows read and the early rows; its cancelled flag is honoured.
+     * @return True if the file was loaded completely, false otherwise.
+     */
+    bool loadFromFile(const std::string& filename, IoProgress& progress);
+
     /**
      * @brief Saves the matrix data to a CSV file.
      * @param filename The path to the CSV file.
@@ -133,10 +316,297 @@ public:
      */
     bool saveToFile(const std::string& filename) const;
 
+    /**
+     * @brief Saves the matrix data to a CSV file, reporting progress as rows are written.
+     *
+     * The rows are written to "<filename>.part", which replaces the file only once
+     * complete, so a failed or cancelled save leaves the previous file intact. A
+     * change log left by saveChangesToFile is removed, as the file now holds everything.
+     *
+     * @param filename The path to the CSV file.
+     * @param progress Receives bytes and rows written; its cancelled flag is honoured.
+     * @return True if the file was saved completely, false otherwise.
+     */
+    bool saveToFile(const std::string& filename, IoProgress& progress) const;
+
+    /**
+     * @brief Saves only the cells edited since the file was last written.
+     *
+     * The edited cells are appended to the change log file next to the CSV
+     * (see getChangeFileName), which loadFromFile applies on top of the CSV. The
+     * whole file is rewritten instead, which also removes the change log, when the
+     * edits since baseVersion are not known cell by cell (loading, resizing or more
+     * than MAXCHANGELOG edits) or when the change log has outgrown the CSV.
+     *
+     * @param filename The path to the CSV file.
+     * @param baseVersion The version of this matrix the file already holds.
+     * @param progress Receives bytes and rows written; its cancelled flag is honoured.
+     * @return True if the file and its change log hold the current content.
+     */
+    bool saveChangesToFile(const std::string& filename, std::uint64_t baseVersion, IoProgress& progress) const;
+
+    /**
+     * @brief Gets the name of the change log file kept next to a CSV file.
+     * @param filename The path to the CSV file.
+     * @return The path of its change log.
+     */
+    static std::string getChangeFileName(const std::string& filename) { return filename + ".changes"; }
+
+    /**
+     * @brief Memory held by the cells of a matrix, see getMemoryUsage.
+     */
+    struct MemoryUsage {
+        std::size_t cells;          ///< Stored cells, including padding of ragged rows.
+        std::size_t nonEmptyCells;  ///< Cells with a non-empty text.
+        std::size_t distinctTexts;  ///< Texts in the string pool, including ones no longer used.
+        std::size_t cellBytes;      ///< Block table, row vectors and one pointer per cell.
+        std::size_t poolBytes;      ///< String pool: string objects, text buffers and lookup index.
+        std::size_t unpooledBytes;  ///< Estimate for the same cells stored as one std::string each.
+        std::size_t columnBytes;    ///< Numeric columns of the ColumnMajor layout, 0 otherwise.
+    };
+
+    /**
+     * @brief Measures the memory held by the cells.
+     *
+     * Blocks shared with snapshots are counted in full.
+     *
+     * @return The current usage.
+     */
+    MemoryUsage getMemoryUsage() const;
+
+    /**
+     * @brief Writes a human-readable memory report, including bytes per cell.
+     * @param out The stream receiving the report.
+     */
+    void writeMemoryReport(std::ostream& out) const;
+
+    /**
+     * @brief Limits the memory held by the resident row blocks; colder blocks are spilled to a temporary file.
+     *
+     * A block counts its row vectors, one pointer per cell and the text of
+     * every cell, as if the cell did not share it. Accesses stamp blocks with
+     * the current epoch, which advances at every enforcement, and the blocks
+     * with the oldest stamp are evicted first. Reading a spilled cell reads its
+     * block back, so the budget may be exceeded until the next modification or
+     * enforceMemoryBudget(). Snapshots keep the blocks they share in memory.
+     *
+     * @param bytes The budget in bytes, or 0 to keep every block in memory (the default).
+     */
+    void setMemoryBudget(std::size_t bytes);
+
+    /**
+     * @brief Gets the memory budget, 0 if there is none.
+     */
+    std::size_t getMemoryBudget() const { return memoryBudget; }
+
+    /**
+     * @brief Spills least recently used blocks until the resident ones fit in 3/4 of the budget.
+     *
+     * Called by every modification; callers that read many cells may call it
+     * afterwards to release the blocks read back.
+     */
+    void enforceMemoryBudget();
+
+    /**
+     * @brief Residency of the blocks and spill counters, see getSpillStats.
+     */
+    struct SpillStats {
+        std::size_t residentBlocks; ///< Blocks in memory.
+        std::size_t spilledBlocks;  ///< Blocks only in the spill file.
+        std::size_t residentBytes;  ///< Size of the resident blocks, as counted against the budget.
+        SpillStore::Stats io;       ///< Hits, faults and file traffic; all zero without a budget.
+    };
+
+    /**
+     * @brief Gets the block residency and the spill counters.
+     *
+     * Hits and faults are counted once per block and epoch, so the hit rate
+     * hits / (hits + faults) is the share of blocks found in memory.
+     *
+     * @return The current statistics.
+     */
+    SpillStats getSpillStats() const;
+
+    /**
+     * @brief Selects how the cells are stored; the content is unchanged.
+     *
+     * Switching to ColumnMajor builds the numeric columns from the current cells,
+     * switching back drops them. The layout survives loading and clearing.
+     *
+     * @param newLayout The layout to use from now on.
+     */
+    void setLayout(CellLayout newLayout);
+
+    /**
+     * @brief Gets the storage layout.
+     */
+    CellLayout getLayout() const { return layout; }
+
+    /**
+     * @brief Gets the numbers of a column in the ColumnMajor layout.
+     *
+     * The column may hold fewer rows than the matrix; the missing ones are null.
+     *
+     * @param col The column index (0-based).
+     * @return The column, or nullptr in the RowMajor layout or if the column is not stored.
+     */
+    const NumericColumn* findNumericColumn(int col) const;
+
+    /**
+     * @brief Gets the hash index of a column's raw contents, building it on first use.
+     *
+     * Safe to call from several threads reading the same matrix or its snapshots.
+     * The index stays valid while the caller holds it, even if the column changes.
+     *
+     * @param col The column index (0-based).
+     * @return The index of every stored row of the column.
+     */
+    std::shared_ptr<const LookupIndex> getLookupIndex(int col) const;
+
+    /**
+     * @brief Replaces the whole content with another matrix's, sharing its blocks.
+     *
+     * Counts as one modification of this matrix, like loading a file.
+     *
+     * @param other The matrix whose cells are taken over.
+     */
+    void replaceWith(const CellMatrix& other);
+
+    /**
+     * @brief Replaces the whole content with rows of texts, which may hold more than MAXROWSIZE rows.
+     *
+     * Counts as one modification of this matrix, like loading a file. Rows
+     * shorter than the widest one read as empty cells past their end.
+     *
+     * @param newRows The texts of every row.
+     */
+    void setRows(const std::vector<std::vector<std::string>>& newRows);
+
 private:
     int rows;  ///< Current number of rows in the matrix.
     int cols;  ///< Current number of columns in the matrix.
-    std::vector<std::vector<std::string>> data; ///< 2D vector storing cell values.
+
+    typedef std::vector<const std::string*> Row;  ///< Cell texts of one row, owned by the string pool.
+    typedef std::vector<Row> RowBlock;            ///< Up to ROWSPERBLOCK rows.
+
+    /**
+     * @brief One block of the table, either in memory or spilled to a SpillStore.
+     *
+     * Readers of a shared table may read a spilled block back concurrently, so
+     * the rows are published through the atomic resident pointer. Blocks are
+     * only spilled, and the other fields only written, in a table owned by a
+     * single matrix.
+     */
+    struct BlockEntry {
+        mutable std::shared_ptr<RowBlock> block;       ///< The rows while resident, null while spilled.
+        mutable std::atomic<const RowBlock*> resident; ///< block.get(), set once block is ready.
+        std::shared_ptr<SpillStore> store;             ///< Holds a copy of the rows, null if they changed since.
+        SpillStore::Slot slot;                         ///< Where the copy is in store.
+        mutable std::atomic<std::uint64_t> lastUse;    ///< Epoch of the last access, for LRU order.
+        std::size_t bytes = 0;                         ///< Resident size, 0 until measured.
+        int minWidth = 0;                              ///< Shortest row, recorded when spilled.
+        int maxWidth = 0;                              ///< Longest row, recorded when spilled.
+
+        BlockEntry() : resident(nullptr), lastUse(0) {}
+        BlockEntry(const BlockEntry& other) : resident(nullptr), lastUse(0) { *this = other; }
+        BlockEntry& operator=(const BlockEntry& other);
+
+        /**
+         * @brief Makes the given rows resident, or marks the block spilled if null.
+         */
+        void assign(std::shared_ptr<RowBlock> rows);
+    };
+    typedef std::vector<BlockEntry> BlockTable; ///< Every block, in row order.
+
+    std::shared_ptr<BlockTable> blocks; ///< Cell values, shared with snapshots.
+    std::shared_ptr<StringPool> strings; ///< Texts referenced by the cells, shared with snapshots.
+    int storedRows; ///< Number of row vectors held by the blocks.
+
+    typedef std::vector<std::shared_ptr<NumericColumn>> ColumnTable; ///< Every numeric column, in column order.
+
+    CellLayout layout; ///< Selected storage layout.
+    std::shared_ptr<ColumnTable> columns; ///< Numeric columns in the ColumnMajor layout, shared with snapshots; null otherwise.
+
+    /**
+     * @brief Gets a numeric column for writing, adding it or copying it if a snapshot shares it.
+     * @param col The column index (0-based).
+     */
+    NumericColumn& writableColumn(int col);
+
+    /**
+     * @brief Rebuilds the numeric columns from the cells, or drops them in the RowMajor layout.
+     */
+    void rebuildColumns();
+
+    /// Lookup indexes built for one content, shared with snapshots of that content.
+    struct LookupCache {
+        std::mutex mutex; ///< Guards columns; the cache is filled by whichever thread looks up first.
+        std::vector<std::shared_ptr<const LookupIndex>> columns; ///< Index by column, null until built.
+    };
+
+    std::shared_ptr<LookupCache> lookups; ///< Indexes of the current content.
+
+    /**
+     * @brief Drops the index of an edited column, copying the cache first if a snapshot shares it.
+     * @param col The column index (0-based).
+     */
+    void invalidateLookup(int col);
+
+    std::size_t memoryBudget = 0;       ///< Budget of the resident blocks in bytes, 0 for none.
+    std::shared_ptr<SpillStore> spill;  ///< File receiving evicted blocks, shared with snapshots; null without a budget.
+
+    /**
+     * @brief Reads a spilled block back, interning its texts into this matrix's pool.
+     * @throws std::runtime_error If the spill file cannot be read.
+     */
+    const RowBlock& faultIn(const BlockEntry& entry) const;
+
+    /**
+     * @brief Gets the bytes a resident block counts against the budget.
+     */
+    static std::size_t blockBytes(const RowBlock& block);
+
+    /**
+     * @brief Gets a stored row for reading.
+     * @param row The row index (0-based).
+     * @return The row, or nullptr if it is not stored.
+     */
+    const Row* findRow(int row) const;
+
+    /**
+     * @brief Gets a stored row for writing, copying the blocks shared with snapshots first.
+     * @param row The row index (0-based), which must be stored.
+     */
+    Row& writableRow(int row);
+
+    /**
+     * @brief Gets the block table for writing, copying it if a snapshot shares it.
+     */
+    BlockTable& writableTable();
+
+    /**
+     * @brief Gets a block for writing, copying it if a snapshot shares it.
+     */
+    RowBlock& writableBlock(std::size_t block);
+
+    /**
+     * @brief Grows or shrinks the number of stored rows.
+     * @param count The new number of stored rows.
+     * @param fill The content of added rows.
+     */
+    void setStoredRows(int count, const Row& fill);
+
+    /**
+     * @brief Replaces the whole content with the given rows, interning them into a new pool.
+     */
+    void assignRows(const std::vector<std::vector<std::string>>& newRows);
+
+    /**
+     * @brief Moves the texts still used by the cells into a new pool, dropping the rest.
+     *
+     * Typing leaves every intermediate text in the pool; this bounds that garbage.
+     */
+    void compactStrings();
 
     /**
      * @brief Checks if the given cell index is within the valid range.
@@ -157,6 +627,66 @@ private:
         // Used for tracking the last accessed cell for assignment
     int lastRow; ///< Last accessed row index.
     int lastCol; ///< Last accessed column index.
+
+    std::uint64_t version; ///< Incremented on every modification.
+
+    /// A single-cell edit recorded in the change log.
+    struct CellChange {
+        std::uint64_t version; ///< Version produced by the edit.
+        int row;               ///< Row index of the edited cell (0-based).
+        int col;               ///< Column index of the edited cell (0-based).
+    };
+
+    std::shared_ptr<std::vector<CellChange>> changeLog; ///< Recent single-cell edits, oldest first; shared with snapshots.
+    std::uint64_t changeLogStart; ///< Every edit after this version is in changeLog.
+
+    /**
+     * @brief Marks the whole content as replaced, dropping the change log.
+     */
+    void resetChangeLog();
+
+    /**
+     * @brief Stores a text, without newlines, in a cell of a writable row and in its numeric column.
+     */
+    void writeCell(Row& cells, int row, int col, const std::string& value);
+
+    /**
+     * @brief Completes an edit: drops stale lookups, advances the version and logs the written cells.
+     * @param changed The 0-based (row, col) of every written cell.
+     * @param oldRows The number of rows before the edit.
+     * @param oldCols The number of columns before the edit.
+     */
+    void commitCells(const std::vector<std::pair<int, int>>& changed, int oldRows, int oldCols);
+
+    /**
+     * @brief Completes an insertion or deletion: drops the lookups, advances the version and resets the change log.
+     */
+    void commitStructure();
+
+    /**
+     * @brief Positions of the cells whose text may reference a cell; not shared with copies.
+     *
+     * Built by the first rewriteReferences(), then kept up to date by every
+     * edit; replacing the whole content drops it. Copies start without one.
+     */
+    struct ReferenceCells {
+        bool built = false;                  ///< False until the matrix has been scanned.
+        std::map<int, std::vector<int>> rows; ///< Columns by row (0-based), in no particular order.
+
+        ReferenceCells() = default;
+        ReferenceCells(const ReferenceCells&) {}
+        ReferenceCells& operator=(const ReferenceCells&) { reset(); return *this; }
+
+        void reset() { built = false; rows.clear(); }
+        void add(int row, int col) { rows[row].push_back(col); }
+        void remove(int row, int col);
+        void moveRows(int row, int count);
+        void deleteRows(int row, int count);
+        void moveColumns(int col, int count);
+        void deleteColumns(int col, int count);
+    };
+
+    ReferenceCells referenceCells; ///< Cells rewriteReferences() visits.
 };
 
 #endif // CELL_MATRIX_H
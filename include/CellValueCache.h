@@ -0,0 +1,69 @@
+/**
+ * @file CellValueCache.h
+ * @brief Declaration of the CellValueCache struct holding already computed cell values.
+ */
+
+#ifndef CELL_VALUE_CACHE_H
+#define CELL_VALUE_CACHE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Row-major store of evaluated cell values shared by recalculation workers.
+ *
+ * LexicalAnalysis::getCellValue returns a cached value instead of evaluating
+ * the referenced cell again. Workers of one recalculation level write disjoint
+ * cells and only read cells finished in earlier levels, so no locking is needed.
+ */
+struct CellValueCache {
+    int rows = 0;                        ///< Number of rows covered.
+    int cols = 0;                        ///< Number of columns covered.
+    std::vector<std::string> values;     ///< Values as returned by LexicalAnalysis::getCellValue.
+    std::vector<unsigned char> ready;    ///< Non-zero where the value has been computed.
+
+    /**
+     * @brief Discards every value and resizes the cache.
+     * @param newRows The number of rows.
+     * @param newCols The number of columns.
+     */
+    void reset(int newRows, int newCols) {
+        rows = newRows;
+        cols = newCols;
+        values.assign(static_cast<std::size_t>(rows) * cols, std::string());
+        ready.assign(values.size(), 0);
+    }
+
+    /**
+     * @brief Gets the row-major index of a cell.
+     */
+    std::size_t index(int row, int col) const {
+        return static_cast<std::size_t>(row) * cols + col;
+    }
+
+    /**
+     * @brief Gets a computed value.
+     * @param row The row index of the cell (0-based).
+     * @param col The column index of the cell (0-based).
+     * @return A pointer to the value, or nullptr if it is not computed or out of range.
+     */
+    const std::string* find(int row, int col) const {
+        if (row < 0 || row >= rows || col < 0 || col >= cols || !ready[index(row, col)]) {
+            return nullptr;
+        }
+        return &values[index(row, col)];
+    }
+
+    /**
+     * @brief Stores a computed value.
+     * @param cellIndex The row-major index of the cell.
+     * @param value The computed value.
+     */
+    void store(std::size_t cellIndex, std::string value) {
+        values[cellIndex] = std::move(value);
+        ready[cellIndex] = 1;
+    }
+};
+
+#endif // CELL_VALUE_CACHE_H
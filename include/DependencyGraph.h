@@ -0,0 +1,208 @@
+/**
+ * @file DependencyGraph.h
+ * @brief Declaration of the DependencyGraph class describing which cells reference which.
+ */
+
+#ifndef DEPENDENCY_GRAPH_H
+#define DEPENDENCY_GRAPH_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "CellMatrix.h"
+#include "RangeIndex.h"
+#include "ThreadPool.h"
+#include "Tokenizer.h"
+#include "Workbook.h"
+
+/**
+ * @brief A rectangular block of cells read by a range function (0-based, inclusive).
+ */
+struct CellRange {
+    int sheet = 0; ///< Index of the sheet in the workbook.
+    int startRow;
+    int startCol;
+    int endRow;
+    int endCol;
+
+    /**
+     * @brief Checks whether the range covers a cell.
+     */
+    bool contains(int row, int col) const {
+        return row >= startRow && row <= endRow && col >= startCol && col <= endCol;
+    }
+};
+
+/**
+ * @class DependencyGraph
+ * @brief Tokens and precedents of every cell of a sheet, with a level schedule.
+ *
+ * Direct references ("=A1+7") are precedents: the referenced cell has to be
+ * evaluated first. Range functions ("=SUM(A1..A9)") read the raw content of the
+ * covered cells, so ranges are recorded separately and do not order evaluation;
+ * a RangeIndex finds the ranges covering an edited cell without expanding them.
+ * LOOKUP and MATCH record their key column as a range. A key given as a
+ * reference and every cell of the LOOKUP result column, whose value is
+ * returned, are precedents.
+ *
+ * The graph spans every sheet of a workbook, so references such as "Sheet2!A1"
+ * are precedents like any other. Cells are identified by their row-major index
+ * within their sheet, offset by the cells of the sheets before it.
+ */
+class DependencyGraph {
+public:
+    /**
+     * @brief Tokenizes every cell of every sheet and collects its precedents, in parallel.
+     * @param book The sheets.
+     * @param tokenizer The tokenizer for cell contents.
+     * @param pool The threads sharing the tokenization work.
+     */
+    void build(const Workbook& book, const Tokenizer& tokenizer, ThreadPool& pool);
+
+    /**
+     * @brief Groups the cells into levels whose precedents are all in earlier levels.
+     *
+     * Cells of one level are independent of each other and can be evaluated
+     * concurrently once the previous levels are complete.
+     *
+     * @param cyclic Receives the cells on or behind a circular reference, which fit no level.
+     * @return The levels, starting with the cells that have no precedents.
+     */
+    std::vector<std::vector<std::size_t>> computeLevels(std::vector<std::size_t>& cyclic) const;
+
+    /**
+     * @brief Groups a subset of the cells into levels, like computeLevels for the whole sheet.
+     *
+     * Only precedents inside the subset order the cells; the others are assumed complete.
+     *
+     * @param cells The cells to schedule.
+     * @param cyclic Receives the cells of the subset on or behind a circular reference.
+     * @return The levels of the subset.
+     */
+    std::vector<std::vector<std::size_t>> computeLevels(const std::vector<std::size_t>& cells,
+                                                        std::vector<std::size_t>& cyclic) const;
+
+    /**
+     * @brief Tokenizes edited cells again and updates their precedents and ranges.
+     *
+     * The range index is refreshed once for the whole batch, so a bulk edit of
+     * many formulas reading the same column rebuilds that column once.
+     *
+     * @param book The sheets holding the new content, with the same names and sizes as when built.
+     * @param tokenizer The tokenizer for cell contents.
+     * @param cells The indices of the edited cells.
+     */
+    void updateCells(const Workbook& book, const Tokenizer& tokenizer, const std::vector<std::size_t>& cells);
+
+    /**
+     * @brief Collects the cells whose value may change after the given cells were edited.
+     *
+     * These are the edited cells, the cells whose ranges cover an edited cell, and
+     * everything that references any of them directly or indirectly, on any sheet.
+     * The covering ranges are found in O(log n + k) per edited cell.
+     *
+     * @param edited The indices of the edited cells.
+     * @return The affected cells, each listed once.
+     */
+    std::vector<std::size_t> affectedBy(const std::vector<std::size_t>& edited) const;
+
+    /**
+     * @brief Gets the number of sheets covered by the graph.
+     */
+    int getSheetCount() const { return static_cast<int>(sheetRows.size()); }
+
+    /**
+     * @brief Gets the number of rows of a sheet covered by the graph.
+     */
+    int getRows(int sheet) const { return sheetRows[sheet]; }
+
+    /**
+     * @brief Gets the number of columns of a sheet covered by the graph.
+     */
+    int getCols(int sheet) const { return sheetCols[sheet]; }
+
+    /**
+     * @brief Gets the index of the first cell of a sheet; the sheet's cells follow it in row-major order.
+     */
+    std::size_t firstCell(int sheet) const { return sheetStart[sheet]; }
+
+    /**
+     * @brief Gets the number of cells of every sheet together.
+     */
+    std::size_t getCellCount() const { return sheetStart.back(); }
+
+    /**
+     * @brief Finds the sheet a cell belongs to.
+     * @param cell The index of the cell.
+     */
+    int sheetOf(std::size_t cell) const;
+
+    /**
+     * @brief Gets the tokens of a cell, with their constants folded.
+     * @param cell The index of the cell.
+     */
+    const std::vector<Token>& tokensOf(std::size_t cell) const { return tokens[cell]; }
+
+    /**
+     * @brief Gets the cells referenced directly by a cell.
+     * @param cell The index of the cell.
+     */
+    const std::vector<std::size_t>& precedentsOf(std::size_t cell) const { return precedents[cell]; }
+
+    /**
+     * @brief Gets the ranges read by the range functions of a cell.
+     * @param cell The index of the cell.
+     */
+    const std::vector<CellRange>& rangesOf(std::size_t cell) const { return ranges[cell]; }
+
+    /**
+     * @brief Parses a range given by its corner cells, such as "A1" and "B4".
+     * @param startCell The first corner.
+     * @param endCell The opposite corner.
+     * @param range Receives the covered cells.
+     * @return True if both corners are cell references.
+     */
+    static bool parseRange(const std::string& startCell, const std::string& endCell, CellRange& range);
+
+    /**
+     * @brief Lists what the tokens of a cell read: precedents and ranges, as described for the class.
+     * @param tokens The tokens of the cell.
+     * @param reference Called with every cell that has to be evaluated first, such as "A1" or "Sheet2!A1";
+     *        a LOOKUP key that is not a reference is passed too.
+     * @param range Called with the corners of every range read raw, such as "Sheet2!A1" and "A9".
+     * @param valueRange Called with the corners of every range whose cells are read by value, i.e. whose
+     *        cells all have to be evaluated first, such as a LOOKUP result column.
+     */
+    static void scanReferences(const std::vector<Token>& tokens, const std::function<void(const std::string&)>& reference,
+                               const std::function<void(const std::string&, const std::string&)>& range,
+                               const std::function<void(const std::string&, const std::string&)>& valueRange);
+
+private:
+    /**
+     * @brief Tokenizes one cell and records its precedents and ranges.
+     */
+    void analyzeCell(const Workbook& book, const Tokenizer& tokenizer, std::size_t cell);
+
+    /**
+     * @brief Replaces the tokens, precedents and ranges of an edited cell; the range index needs a refresh() after.
+     */
+    void updateCell(const Workbook& book, const Tokenizer& tokenizer, std::size_t cell);
+
+    /**
+     * @brief Adds (or removes) a cell to the dependents and range readers it belongs to.
+     */
+    void linkCell(std::size_t cell, bool add);
+
+    std::vector<int> sheetRows;             ///< Number of rows covered, by sheet.
+    std::vector<int> sheetCols;             ///< Number of columns covered, by sheet.
+    std::vector<std::size_t> sheetStart = { 0 }; ///< Index of the first cell of every sheet, then the cell count.
+    std::vector<std::vector<Token>> tokens;            ///< Tokens of every cell.
+    std::vector<std::vector<std::size_t>> precedents;  ///< Directly referenced cells of every cell.
+    std::vector<std::vector<CellRange>> ranges;        ///< Ranges read by every cell.
+    std::vector<std::vector<std::size_t>> dependents;  ///< Cells referencing every cell directly.
+    RangeIndex rangeIndex;                             ///< Every range, by the columns and rows it lies on.
+};
+
+#endif // DEPENDENCY_GRAPH_H
@@ -0,0 +1,105 @@
+/**
+ * @file EditJournal.h
+ * @brief Declaration of the EditJournal class recording cell edits for undo and redo.
+ */
+
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Default memory budget of an edit journal in bytes.
+ */
+#define MAXJOURNALBYTES (1 << 20)
+
+/**
+ * @class EditJournal
+ * @brief Append-only journal of cell edits with an undo/redo cursor.
+ *
+ * Each edit is a compact record pointing into a shared character arena that
+ * holds the old and new cell text. Keystrokes typed into the same cell are
+ * coalesced into one record. Once the journal exceeds its memory budget the
+ * oldest edits are forgotten and the arena is compacted.
+ */
+class EditJournal {
+public:
+    /**
+     * @brief Creates an empty journal.
+     * @param maxBytes Memory budget for the records and the arena.
+     */
+    explicit EditJournal(std::size_t maxBytes = MAXJOURNALBYTES);
+
+    /**
+     * @brief Records an edit, dropping every edit that could still be redone.
+     * @param row The row of the edited cell (0-based).
+     * @param col The column of the edited cell (0-based).
+     * @param oldValue The content before the edit.
+     * @param newValue The content after the edit.
+     * @param continueEdit True if the edit continues typing into the cell of the last edit.
+     */
+    void record(int row, int col, const std::string& oldValue, const std::string& newValue, bool continueEdit);
+
+    /**
+     * @brief Steps back over the most recent edit.
+     * @param row Receives the row of the edited cell.
+     * @param col Receives the column of the edited cell.
+     * @param value Receives the content to restore.
+     * @return False if there is nothing to undo.
+     */
+    bool undo(int& row, int& col, std::string& value);
+
+    /**
+     * @brief Steps forward over the most recently undone edit.
+     * @param row Receives the row of the edited cell.
+     * @param col Receives the column of the edited cell.
+     * @param value Receives the content to restore.
+     * @return False if there is nothing to redo.
+     */
+    bool redo(int& row, int& col, std::string& value);
+
+    /**
+     * @brief Forgets every edit.
+     */
+    void clear();
+
+    /**
+     * @brief Gets the number of edits that can be undone.
+     */
+    std::size_t getUndoCount() const { return position; }
+
+    /**
+     * @brief Gets the number of edits that can be redone.
+     */
+    std::size_t getRedoCount() const { return records.size() - position; }
+
+    /**
+     * @brief Gets the memory used by the records and the arena in bytes.
+     */
+    std::size_t getMemoryUsage() const;
+
+private:
+    /// One edit; the texts are slices of the arena.
+    struct EditRecord {
+        int row;               ///< Row of the edited cell (0-based).
+        int col;               ///< Column of the edited cell (0-based).
+        std::size_t oldOffset; ///< Arena offset of the content before the edit.
+        std::size_t oldLength; ///< Length of the content before the edit.
+        std::size_t newOffset; ///< Arena offset of the content after the edit.
+        std::size_t newLength; ///< Length of the content after the edit.
+    };
+
+    /**
+     * @brief Drops the oldest edits until the journal fits in three quarters of its budget.
+     */
+    void enforceBudget();
+
+    std::size_t maxBytes;             ///< Memory budget.
+    std::string arena;                ///< Old and new texts of every record, in record order.
+    std::vector<EditRecord> records;  ///< Edits, oldest first.
+    std::size_t position;             ///< Records before this index are applied.
+};
+
+#endif // EDIT_JOURNAL_H
@@ -0,0 +1,145 @@
+/**
+ * @file EvaluationProfiler.h
+ * @brief Declaration of the EvaluationProfiler class for per-cell formula profiling.
+ *
+ * The profiler records, for every evaluated cell, how long its evaluation took,
+ * how deep the recursion through referenced cells went and how many cells it
+ * referenced. LexicalAnalysis only touches the profiler through a pointer that
+ * is null when profiling is disabled, so the disabled cost is a single branch.
+ */
+
+#ifndef EVALUATION_PROFILER_H
+#define EVALUATION_PROFILER_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Accumulated measurements for a single cell.
+ */
+struct CellProfile {
+    int row = 0;                  ///< Row index of the cell (0-based).
+    int col = 0;                  ///< Column index of the cell (0-based).
+    long long evaluations = 0;    ///< Number of times the cell was evaluated.
+    double selfNs = 0;            ///< Time spent in the cell itself, excluding referenced cells.
+    double totalNs = 0;           ///< Time spent in the cell including referenced cells.
+    int maxDepth = 0;             ///< Deepest recursion through referenced cells below this cell.
+    long long referencedCells = 0;///< Number of cells referenced per evaluation (last evaluation).
+};
+
+/**
+ * @class EvaluationProfiler
+ * @brief Collects per-cell evaluation time, recursion depth and reference counts.
+ */
+class EvaluationProfiler {
+public:
+    /**
+     * @brief RAII helper opening a cell frame on construction and closing it on destruction.
+     *
+     * Does nothing when constructed with a null profiler.
+     */
+    class Scope {
+    public:
+        Scope(EvaluationProfiler* profiler, int row, int col) : profiler(profiler) {
+            if (profiler) profiler->beginCell(row, col);
+        }
+        ~Scope() {
+            if (profiler) profiler->endCell();
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        EvaluationProfiler* profiler;
+    };
+
+    /**
+     * @brief Starts timing of a cell evaluation (nested calls are referenced cells).
+     * @param row The row index of the cell (0-based).
+     * @param col The column index of the cell (0-based).
+     */
+    void beginCell(int row, int col);
+
+    /**
+     * @brief Finishes the innermost cell evaluation started by beginCell.
+     */
+    void endCell();
+
+    /**
+     * @brief Adds referenced cells to the innermost cell being evaluated.
+     * @param count The number of referenced cells.
+     */
+    void addReferences(long long count);
+
+    /**
+     * @brief Starts timing of a whole-sheet recalculation.
+     */
+    void beginRecalculation();
+
+    /**
+     * @brief Finishes timing of a whole-sheet recalculation.
+     */
+    void endRecalculation();
+
+    /**
+     * @brief Discards all collected measurements.
+     */
+    void reset();
+
+    /**
+     * @brief Returns the most expensive cells ordered by self time.
+     * @param count The maximum number of cells to return.
+     * @return Up to count cell profiles, most expensive first.
+     */
+    std::vector<CellProfile> topCells(std::size_t count) const;
+
+    /**
+     * @brief Gets the duration of the last whole-sheet recalculation.
+     * @return The recalculation time in milliseconds.
+     */
+    double getRecalculationMs() const { return recalculationNs / 1e6; }
+
+    /**
+     * @brief Gets the number of distinct cells that were evaluated.
+     * @return The number of profiled cells.
+     */
+    std::size_t getCellCount() const { return cells.size(); }
+
+    /**
+     * @brief Writes the top cells and total recalculation time as CSV.
+     * @param out The stream receiving the report.
+     * @param count The maximum number of cells to list.
+     */
+    void writeReport(std::ostream& out, std::size_t count) const;
+
+    /**
+     * @brief Writes the report of writeReport to a file.
+     * @param filename The path of the report file.
+     * @param count The maximum number of cells to list.
+     * @return True if the file was written successfully, false otherwise.
+     */
+    bool exportToFile(const std::string& filename, std::size_t count) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// A cell currently being evaluated.
+    struct Frame {
+        int row;
+        int col;
+        Clock::time_point start;
+        double childNs;        ///< Time spent in nested (referenced) cells.
+        int depthBelow;        ///< Deepest nesting seen below this frame.
+        long long references;  ///< Cells referenced by this evaluation.
+    };
+
+    std::vector<Frame> stack; ///< Cells currently being evaluated, innermost last.
+    std::unordered_map<long long, CellProfile> cells; ///< Profiles keyed by row and column.
+    Clock::time_point recalculationStart; ///< Start of the current recalculation.
+    double recalculationNs = 0; ///< Duration of the last recalculation.
+};
+
+#endif // EVALUATION_PROFILER_H
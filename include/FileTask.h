@@ -0,0 +1,107 @@
+/**
+ * @file FileTask.h
+ * @brief Declaration of the FileTask class that loads or saves a sheet on a worker thread.
+ */
+
+#ifndef FILE_TASK_H
+#define FILE_TASK_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "CellMatrix.h"
+#include "IoProgress.h"
+
+/**
+ * @class FileTask
+ * @brief A CSV load or save running in the background.
+ *
+ * The caller polls isFinished() and the progress counters and may cancel the
+ * task. A save writes a snapshot of the data, so the sheet can change meanwhile.
+ */
+class FileTask {
+public:
+    /**
+     * @brief Starts loading a file.
+     * @param filename The CSV file to read.
+     * @param previewRows Number of rows to publish as soon as they are parsed; 0 disables the preview.
+     */
+    FileTask(const std::string& filename, int previewRows);
+
+    /**
+     * @brief Starts saving a snapshot of the data.
+     * @param filename The CSV file to write.
+     * @param data The cell data to save.
+     */
+    FileTask(const std::string& filename, const CellMatrix& data);
+
+    /**
+     * @brief Starts saving only the cells edited since the file held a given version.
+     * @param filename The CSV file to update.
+     * @param data The cell data to save.
+     * @param baseVersion The version of the data the file already holds.
+     * @see CellMatrix::saveChangesToFile
+     */
+    FileTask(const std::string& filename, const CellMatrix& data, std::uint64_t baseVersion);
+
+    /**
+     * @brief Cancels the task if it is still running and waits for the worker.
+     */
+    ~FileTask();
+
+    FileTask(const FileTask&) = delete;
+    FileTask& operator=(const FileTask&) = delete;
+
+    /**
+     * @brief Asks the task to stop at the next row; it then fails.
+     */
+    void cancel() { progress.cancelled = true; }
+
+    /**
+     * @brief Checks whether the worker is done.
+     */
+    bool isFinished() const { return finished; }
+
+    /**
+     * @brief Checks whether the task completed successfully; only meaningful once finished.
+     */
+    bool succeeded() const { return finished && ok; }
+
+    /**
+     * @brief Checks whether the task was cancelled.
+     */
+    bool wasCancelled() const { return progress.cancelled; }
+
+    /**
+     * @brief Checks whether the task loads a file.
+     */
+    bool isLoad() const { return loading; }
+
+    /**
+     * @brief Gets the live progress counters and preview.
+     */
+    IoProgress& getProgress() { return progress; }
+
+    /**
+     * @brief Gets the loaded data, or the saved snapshot; only valid once finished.
+     */
+    const CellMatrix& getData() const { return data; }
+
+private:
+    /**
+     * @brief Worker body: runs the load or save.
+     */
+    void run(const std::string& filename);
+
+    bool loading;                 ///< True for a load, false for a save.
+    bool incremental;             ///< True for a save appending to the change log.
+    std::uint64_t baseVersion;    ///< Version the file holds, for an incremental save.
+    CellMatrix data;              ///< Loaded cells, or the snapshot being saved.
+    IoProgress progress;          ///< Counters read by the observing thread.
+    bool ok;                      ///< Result of the operation, written before finished is set.
+    std::atomic<bool> finished;   ///< Set once the worker is done.
+    std::thread worker;           ///< The I/O thread.
+};
+
+#endif // FILE_TASK_H
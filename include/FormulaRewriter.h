@@ -0,0 +1,91 @@
+/**
+ * @file FormulaRewriter.h
+ * @brief Declaration of the FormulaRewriter class moving the references of cell contents.
+ */
+
+#ifndef FORMULA_REWRITER_H
+#define FORMULA_REWRITER_H
+
+#include <functional>
+#include <string>
+#include "Tokenizer.h"
+
+/**
+ * @brief The cells a reference or a range of a formula names, as written.
+ */
+struct ReferenceArea {
+    std::string sheet; ///< The sheet name written before '!', empty for the formula's own sheet.
+    int startRow;      ///< Row of the first cell (0-based).
+    int startCol;      ///< Column of the first cell (0-based).
+    int endRow;        ///< Row of the last cell; startRow for a single reference.
+    int endCol;        ///< Column of the last cell; startCol for a single reference.
+};
+
+/**
+ * @class FormulaRewriter
+ * @brief Rewrites the references of cell contents found by the tokenizer.
+ *
+ * Only the references the evaluator reads are rewritten: reference tokens,
+ * the ranges of range functions, LOOKUP and MATCH keys given as references
+ * and the ranges of conditional aggregates. Criteria, labels, numbers and
+ * texts the evaluator shows as they are keep their spelling, as does
+ * everything between the references. A reference that no longer names a
+ * cell is written as "#REF", which the evaluator shows as text.
+ */
+class FormulaRewriter {
+public:
+    /**
+     * @brief Moves a reference or range; returns false if it no longer names any cell.
+     */
+    typedef std::function<bool(ReferenceArea&)> Move;
+
+    /**
+     * @brief Creates a rewriter splitting contents with the given tokenizer.
+     * @param tokenizer The tokenizer of the evaluator; must outlive the rewriter.
+     */
+    explicit FormulaRewriter(const Tokenizer& tokenizer) : tokenizer(tokenizer) {}
+
+    /**
+     * @brief Shifts every reference of a content, as copying it to another cell does.
+     *
+     * References are relative: copying "=A1+SUM(B1..B3)" one row down gives
+     * "=A2+SUM(B2..B4)". References shifted off the sheet become "#REF".
+     *
+     * @param content The content to copy.
+     * @param rowOffset Rows from the copied cell to its copy.
+     * @param colOffset Columns from the copied cell to its copy.
+     * @return The content of the copy.
+     */
+    std::string shift(const std::string& content, int rowOffset, int colOffset) const;
+
+    /**
+     * @brief Passes every reference and range of a content to move and writes back the result.
+     * @param content The content to rewrite.
+     * @param move Called with every reference and range, in order.
+     * @return The rewritten content; content itself if it reads no cell.
+     */
+    std::string rewrite(const std::string& content, const Move& move) const;
+
+    /**
+     * @brief Formats a cell reference such as "B7" from 0-based indices.
+     * @return The reference, or an empty string if the indices are out of what references can name.
+     */
+    static std::string formatCell(int row, int col);
+
+private:
+    const Tokenizer& tokenizer; ///< Splits contents the way the evaluator does.
+
+    /**
+     * @brief Rewrites the reference arguments of a function call token.
+     * @return False if the call reads no cell.
+     */
+    bool rewriteCall(const std::string& call, const Move& move, std::string& result) const;
+
+    /**
+     * @brief Moves one reference or range written as "Sheet2!A1..B9", "A1..B9" or "A1".
+     * @return False if the text is not a reference or range.
+     */
+    static bool rewriteArea(const std::string& text, const Move& move, std::string& result);
+};
+
+#endif // FORMULA_REWRITER_H
@@ -0,0 +1,52 @@
+/**
+ * @file IoProgress.h
+ * @brief Declaration of the IoProgress struct shared between a file operation and its observer.
+ */
+
+#ifndef IO_PROGRESS_H
+#define IO_PROGRESS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+class CellMatrix;
+
+/**
+ * @brief Progress, cancellation and early rows of a running load or save.
+ *
+ * The file operation updates the counters while another thread reads them.
+ * Setting cancelled makes the operation stop at the next row and fail.
+ */
+struct IoProgress {
+    std::atomic<std::uint64_t> bytesDone{0};  ///< Bytes read or written so far.
+    std::atomic<std::uint64_t> bytesTotal{0}; ///< Size of the file being read or written.
+    std::atomic<int> rowsDone{0};             ///< Rows parsed or written so far.
+    std::atomic<bool> cancelled{false};       ///< Set by the observer to abandon the operation.
+
+    int previewRows = 0; ///< A load publishes its first rows once this many are parsed; 0 disables it.
+
+    /**
+     * @brief Publishes the first rows of a running load.
+     */
+    void setPreview(std::shared_ptr<const CellMatrix> rows) {
+        std::lock_guard<std::mutex> lock(previewMutex);
+        preview = std::move(rows);
+    }
+
+    /**
+     * @brief Takes the published first rows, if any.
+     * @return The rows parsed so far, or nullptr if none were published since the last call.
+     */
+    std::shared_ptr<const CellMatrix> takePreview() {
+        std::lock_guard<std::mutex> lock(previewMutex);
+        return std::move(preview);
+    }
+
+private:
+    std::mutex previewMutex;                   ///< Guards preview.
+    std::shared_ptr<const CellMatrix> preview; ///< First rows of a running load.
+};
+
+#endif // IO_PROGRESS_H
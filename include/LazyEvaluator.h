@@ -0,0 +1,125 @@
+/**
+ * @file LazyEvaluator.h
+ * @brief Declaration of the LazyEvaluator class computing cell values on demand.
+ */
+
+#ifndef LAZY_EVALUATOR_H
+#define LAZY_EVALUATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "CellValueCache.h"
+#include "DependencyGraph.h"
+#include "RangeIndex.h"
+#include "Tokenizer.h"
+#include "Workbook.h"
+
+/**
+ * @class LazyEvaluator
+ * @brief Evaluates the cells that are read, and their precedents, on the calling thread.
+ *
+ * Nothing is computed up front: the first read of a cell tokenizes it,
+ * evaluates the cells it references first, then the cell itself, and keeps
+ * every value. Formulas that are never read are never tokenized, so a large
+ * sheet shows its first screen after evaluating that screen only.
+ *
+ * The evaluator reads the workbook it was given as it is edited. sync()
+ * catches up with the edits: it forgets the values of the edited cells and of
+ * the computed cells reading them, directly or through a range, and keeps the
+ * others. Values and circular references come out as in a full recalculation.
+ */
+class LazyEvaluator {
+public:
+    /**
+     * @brief Starts with no values computed.
+     * @param book The sheets to evaluate; must outlive the evaluator.
+     */
+    explicit LazyEvaluator(const Workbook& book);
+
+    /**
+     * @brief Forgets the values that edits made since the last call may have changed.
+     *
+     * Falls back to forgetting everything when the edits are not known cell by
+     * cell, e.g. after loading a file or adding a sheet.
+     */
+    void sync();
+
+    /**
+     * @brief Gets the value of a cell, as LexicalAnalysis::getCellValue gives it, computing it if needed.
+     * @param sheet The index of the sheet.
+     * @param row The row of the cell (0-based).
+     * @param col The column of the cell (0-based).
+     * @return The value; empty for empty cells and cells outside the sheet.
+     */
+    const std::string& getValue(int sheet, int row, int col);
+
+    /**
+     * @brief Gets the text displayed for a cell, computing its value if needed.
+     * @param sheet The index of the sheet.
+     * @param row The row of the cell (0-based).
+     * @param col The column of the cell (0-based).
+     * @return The formatted value, or the content itself for texts and errors; empty for empty cells.
+     */
+    const std::string& getDisplayText(int sheet, int row, int col);
+
+    /**
+     * @brief Gets the number of cells evaluated since the evaluator was created.
+     */
+    std::size_t getEvaluatedCount() const { return evaluatedCount; }
+
+private:
+    /**
+     * @brief What a computed cell read, so that edits find it.
+     */
+    struct Reads {
+        std::vector<std::size_t> precedents; ///< Cells referenced directly.
+        std::vector<CellRange> ranges;       ///< Ranges read raw.
+    };
+
+    const Workbook& book;                    ///< The sheets, read as they are.
+    Tokenizer tokenizer;                     ///< Tokenizer for cell contents.
+    std::vector<std::string> names;          ///< Sheet names when the values were computed.
+    std::vector<std::uint64_t> versions;     ///< Sheet versions the values are current with.
+    std::vector<int> sheetRows;              ///< Rows covered, by sheet.
+    std::vector<int> sheetCols;              ///< Columns covered, by sheet.
+    std::vector<std::size_t> sheetStart;     ///< Index of the first cell of every sheet, as in DependencyGraph.
+    std::vector<CellValueCache> values;      ///< Computed values, by sheet.
+    std::unordered_map<std::size_t, std::string> texts;  ///< Display texts of computed cells.
+    std::unordered_map<std::size_t, Reads> reads;        ///< What every cell computed or being computed read.
+    std::unordered_map<std::size_t, std::vector<std::size_t>> dependents; ///< Computed cells referencing a cell.
+    std::unordered_set<std::size_t> circular;            ///< Computed cells on or reading a circular reference.
+    RangeIndex rangeReaders;                 ///< Ranges read by computed cells.
+    std::size_t evaluatedCount = 0;          ///< Cells evaluated so far.
+
+    /**
+     * @brief Forgets every value and adopts the current sheets and their sizes.
+     */
+    void reset();
+
+    /**
+     * @brief Evaluates a cell after its precedents, depth first, marking the cells of a cycle.
+     */
+    void compute(std::size_t cell);
+
+    /**
+     * @brief Tokenizes a cell and records what it reads.
+     * @return The tokens of the cell, with their constants folded.
+     */
+    std::vector<Token> analyze(std::size_t cell);
+
+    /**
+     * @brief Forgets the values of the given cells and of every computed cell reading them.
+     */
+    void invalidate(std::vector<std::size_t> cells);
+
+    /**
+     * @brief Finds the sheet of a cell and its row-major index within the sheet.
+     */
+    int locate(std::size_t cell, std::size_t& index) const;
+};
+
+#endif // LAZY_EVALUATOR_H
@@ -13,6 +13,34 @@
 #include <cmath>
 #include "Tokenizer.h" // Tokenizer class is assumed to be implemented separately
 #include "CellMatrix.h"
+#include "EvaluationProfiler.h"
+#include "CellValueCache.h"
+#include "RangeFunctionCache.h"
+#include "Workbook.h"
+
+/**
+ * @brief The arguments of a LOOKUP or MATCH call such as "LOOKUP(A1;B1..B99;C1..C99)".
+ */
+struct LookupCall {
+    std::string label;       ///< LOOKUP or MATCH, without a leading '@'.
+    std::string key;         ///< A cell reference, a number or a label.
+    std::string keyStart;    ///< First cell of the key column.
+    std::string keyEnd;      ///< Last cell of the key column.
+    std::string resultStart; ///< First cell of the result column; empty for MATCH.
+    std::string resultEnd;   ///< Last cell of the result column; empty for MATCH.
+};
+
+/**
+ * @brief The arguments of a SUMIF, COUNTIF or AVERIF call such as "SUMIF(A1..A99;>5;B1..B99)".
+ */
+struct ConditionalCall {
+    std::string label;      ///< SUMIF, COUNTIF or AVERIF, without a leading '@'.
+    std::string testStart;  ///< First cell of the tested range.
+    std::string testEnd;    ///< Last cell of the tested range.
+    std::string criterion;  ///< A comparison with a constant, such as ">5", "<>0", "=East" or "East".
+    std::string valueStart; ///< First cell of the aggregated range; empty to aggregate the tested range.
+    std::string valueEnd;   ///< Last cell of the aggregated range; empty to aggregate the tested range.
+};
 
 /**
  * @brief The LexicalAnalysis class for analyzing and evaluating formulas and expressions.
@@ -36,14 +64,96 @@ public:
 
     /**
      * @brief Evaluates a formula based on a vector of tokens.
+     *
+     * Supports + - * / and right-associative ^, parentheses and unary minus;
+     * ^ binds tighter than unary minus, which binds tighter than * and /.
      * 
      * @param tokens The vector of tokens representing the formula.
      * @return std::string The result of the formula evaluation.
      */
     std::string evaluateFormula(const std::vector<Token>& tokens);
 
+    /**
+     * @brief Folds the constant parts of a tokenized formula, leaving its value unchanged.
+     *
+     * Leading constant operands of a product chain (2*3*A1) and leading constant
+     * terms of a sum (2*3+4-A1) are replaced by the number evaluateFormula computes
+     * for them. A fully constant formula keeps its last operation, so the cell is
+     * still evaluated as a formula. Sequences evaluateFormula would reject, and
+     * parts whose result is an error, are left unchanged.
+     *
+     * @param tokens The tokens of a cell, rewritten in place.
+     */
+    void foldConstants(std::vector<Token>& tokens);
+
+    /**
+     * @brief Evaluates a cell the way it is shown in the spreadsheet view.
+     *
+     * Formulas and references are evaluated and numeric results are formatted.
+     * Cells that are not formulas, and formulas that fail, keep their raw content.
+     *
+     * @param row The row index of the cell (0-based).
+     * @param col The column index of the cell (0-based).
+     * @return std::string The text to display for the cell.
+     */
+    std::string evaluateCellText(int row, int col);
+
+    /**
+     * @brief Computes the value of a cell from its already tokenized content.
+     *
+     * This is what getCellValue returns for the cell, without tokenizing it again.
+     *
+     * @param row The row index of the cell (0-based).
+     * @param col The column index of the cell (0-based).
+     * @param cellContent The raw content of the cell.
+     * @param tokens The tokens of the raw content.
+     * @return std::string The value of the cell.
+     */
+    std::string evaluateCellValue(int row, int col, const std::string& cellContent, const std::vector<Token>& tokens);
+
+    /**
+     * @brief Derives the displayed text of a cell from its raw content and computed value.
+     *
+     * @param cellContent The raw content of the cell.
+     * @param value The value computed by getCellValue or evaluateCellValue.
+     * @return std::string The formatted value, or the raw content if the value is an error.
+     */
+    std::string formatCellText(const std::string& cellContent, const std::string& value);
+
+    /**
+     * @brief Derives the displayed text of a cell into an existing string, reusing its capacity.
+     *
+     * @param cellContent The raw content of the cell.
+     * @param value The value computed by getCellValue or evaluateCellValue.
+     * @param text Receives the formatted value, or the raw content if the value is an error.
+     */
+    void formatCellText(const std::string& cellContent, const std::string& value, std::string& text);
+
+    /**
+     * @brief Converts a cell reference such as "B12" to 0-based row and column indices.
+     *
+     * @param cell The cell reference.
+     * @param row Receives the row index.
+     * @param col Receives the column index.
+     * @return bool True if the text has the shape of a cell reference.
+     */
+    static bool parseCellReference(const std::string& cell, int& row, int& col);
+
+    /**
+     * @brief Splits a reference such as "Sheet2!A1" into its sheet name and cell.
+     *
+     * @param reference The reference, with or without a sheet name.
+     * @param sheetName Receives the sheet name, or an empty string if there is none.
+     * @param cell Receives the reference without its sheet name.
+     * @return bool True if the reference names a sheet.
+     */
+    static bool splitSheetName(const std::string& reference, std::string& sheetName, std::string& cell);
+
     /**
      * @brief Retrieves the value of a matrix cell based on its reference.
+     *
+     * A cell of another sheet ("Sheet2!A1") is evaluated on that sheet, so its
+     * own unqualified references point into it.
      * 
      * @param cell The string representing the cell reference (e.g., "A1").
      * @return std::string The value of the cell.
@@ -51,13 +161,81 @@ public:
     std::string getCellValue(const std::string& cell);
 
     /**
-     * @brief Evaluates a function label expression such as SUM, AVER, MAX, or MIN.
+     * @brief Evaluates a function label expression such as SUM, AVER, MAX, MIN, LOOKUP or MATCH.
      * 
      * @param labelExpression The string containing the function label expression.
      * @return std::string The result of the evaluation.
      */
     std::string evaluateLabelFunction(const std::string& labelExpression);
 
+    /**
+     * @brief Splits a range function expression such as "@SUM(Sheet2!A1..A9)" into its parts.
+     *
+     * @param expression The function token.
+     * @param label Receives the function label, without a leading '@'.
+     * @param startCell Receives the first cell, which may name a sheet.
+     * @param endCell Receives the last cell.
+     * @return bool True if the expression is a well-formed range function.
+     */
+    static bool parseRangeFunction(const std::string& expression, std::string& label, std::string& startCell, std::string& endCell);
+
+    /**
+     * @brief Splits a LOOKUP or MATCH expression into its arguments.
+     *
+     * MATCH(key;A1..A9) takes a key column; LOOKUP(key;A1..A9;B1..B9) also takes
+     * a result column. Arguments are separated by ';' as cells are saved as CSV.
+     *
+     * @param expression The function token, with or without a leading '@'.
+     * @param call Receives the arguments.
+     * @return bool True if the expression is a well-formed LOOKUP or MATCH call.
+     */
+    static bool parseLookup(const std::string& expression, LookupCall& call);
+
+    /**
+     * @brief Splits a SUMIF, COUNTIF or AVERIF expression into its arguments.
+     *
+     * The tested range comes first, then the criterion; SUMIF and AVERIF may
+     * take a third argument, the range aggregated in place of the tested one.
+     *
+     * @param expression The function token, with or without a leading '@'.
+     * @param call Receives the arguments.
+     * @return bool True if the expression is a well-formed conditional aggregate.
+     */
+    static bool parseConditional(const std::string& expression, ConditionalCall& call);
+
+    /**
+     * @brief Aggregates the cells of a range whose tested cell satisfies a criterion.
+     *
+     * The criterion is an operator (=, <>, <, <=, >, >=; = if omitted) and a
+     * constant. A numeric constant is compared with the numeric cells by value;
+     * other cells only satisfy <>. A text constant is compared with the texts
+     * of the cells by their bytes, where blank cells read as empty; numeric
+     * cells only satisfy <>. COUNTIF counts the cells satisfying the criterion;
+     * SUMIF and AVERIF add and average the numbers at their positions in the
+     * aggregated range.
+     *
+     * On numeric columns of a ColumnMajor sheet, the criterion is evaluated as a
+     * bit mask over the typed column, and the aggregated column is reduced
+     * through the mask without reading any text.
+     *
+     * @param call The parsed arguments.
+     * @return std::string The result, or an error for invalid ranges or an average of no numbers.
+     */
+    std::string calculateConditionalFunction(const ConditionalCall& call);
+
+    /**
+     * @brief Finds a key in a column with the column's hash index.
+     *
+     * A key given as a cell reference is looked up by the referenced cell's value.
+     * Numbers match by value. MATCH returns the 1-based position of the first
+     * matching cell in the key column; LOOKUP returns the value of the result
+     * column at that position.
+     *
+     * @param call The parsed arguments.
+     * @return std::string The result, or an error if the key is not found.
+     */
+    std::string calculateLookupFunction(const LookupCall& call);
+
     /**
      * @brief Calculates a function over a specified range of cells.
      * 
@@ -88,21 +266,98 @@ public:
      */
     std::string  formatDecimal(const std::string& number) ;
 
+    /**
+     * @brief Formats a decimal string into an existing string, reusing its capacity.
+     *
+     * @param number The decimal number as a string.
+     * @param formatted Receives the formatted number.
+     */
+    void formatDecimal(const std::string& number, std::string& formatted);
+
+    /**
+     * @brief Enables or disables per-cell profiling of evaluations.
+     *
+     * @param profilerIn The profiler receiving measurements, or nullptr to disable profiling.
+     */
+    void setProfiler(EvaluationProfiler* profilerIn) { profiler = profilerIn; }
+
+    /**
+     * @brief Makes referenced cells resolve from already computed values when available.
+     *
+     * @param cache The computed values, or nullptr to always evaluate referenced cells.
+     */
+    void setValueCache(const CellValueCache* cache) { valueCache = cache; }
+
+    /**
+     * @brief Shares range function results with other formulas of the same recalculation.
+     *
+     * @param cache The results of the current data version, or nullptr to always compute ranges.
+     */
+    void setRangeCache(RangeFunctionCache* cache) { rangeCache = cache; }
+
+    /**
+     * @brief Lets references such as "Sheet2!A1" resolve to the other sheets of a workbook.
+     *
+     * Without a workbook a reference naming a sheet is an invalid reference.
+     *
+     * @param book The workbook holding the referenced sheets, or nullptr.
+     * @param values Computed values of every sheet by sheet index, or nullptr to always evaluate cells of other sheets.
+     */
+    void setWorkbook(const Workbook* book, const std::vector<CellValueCache>* values = nullptr) {
+        workbook = book;
+        sheetValues = values;
+    }
+
 private:
     const Tokenizer& tokenizer; ///< Reference to the Tokenizer instance.
     const CellMatrix& data; ///< Spreadsheet data.
+    EvaluationProfiler* profiler; ///< Optional profiler, nullptr when profiling is disabled.
+    const CellValueCache* valueCache; ///< Optional computed values, nullptr to always evaluate.
+    RangeFunctionCache* rangeCache; ///< Optional range function results, nullptr to always compute.
+    const Workbook* workbook; ///< Optional sheets that references may name, nullptr for this sheet only.
+    const std::vector<CellValueCache>* sheetValues; ///< Optional computed values of every sheet of the workbook.
+
+    /**
+     * @brief Finds the cells a reference such as "A1" or "Sheet2!A1" points into.
+     *
+     * @param reference The reference, with or without a sheet name.
+     * @param cell Receives the reference without its sheet name.
+     * @return const CellMatrix* The analysed data for an unqualified reference, the named sheet, or nullptr if there is no such sheet.
+     */
+    const CellMatrix* sheetOf(const std::string& reference, std::string& cell) const;
 
     /**
      * @brief Applies an arithmetic operation to two string values.
      * 
      * @param a The first operand as a string.
      * @param b The second operand as a string.
-     * @param op The operator (+, -, *, /).
+     * @param op The operator (+, -, *, /, ^).
      * @return std::string The result of the operation.
      */
     std::string applyOp(const std::string& a, const std::string& b, char op);
 
 
+    /**
+     * @brief Calculates a function over the numbers of a column range.
+     *
+     * @param label The function label (SUM, AVER, etc.).
+     * @param column The numeric column, exact and holding at least one number in the range.
+     * @param startRow The first row (0-based).
+     * @param endRow The last row, inclusive.
+     * @return std::string The result of the calculation.
+     */
+    std::string calculateColumnFunction(const std::string& label, const NumericColumn& column, int startRow, int endRow);
+
+    /**
+     * @brief Replaces a run of tokens by its value if it evaluates without error.
+     *
+     * @param tokens The tokens to rewrite.
+     * @param first The first token of the run.
+     * @param last One past the last token of the run.
+     * @return bool True if the run was replaced by a single Number token.
+     */
+    bool foldRun(std::vector<Token>& tokens, std::size_t first, std::size_t last);
+
     /**
      * @brief Determines the precedence of an operator.
      * 
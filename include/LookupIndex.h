@@ -0,0 +1,50 @@
+/**
+ * @file LookupIndex.h
+ * @brief Declaration of the LookupIndex class mapping the cell contents of a column to their rows.
+ */
+
+#ifndef LOOKUP_INDEX_H
+#define LOOKUP_INDEX_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class LookupIndex
+ * @brief Hash index of one column, used by the LOOKUP and MATCH functions.
+ *
+ * Keys are compared exactly, except that numbers match by value, so "5",
+ * "5.0" and the computed "5.000000" are the same key. Empty cells are not
+ * indexed. Rows holding the same key are chained in row order, so the first
+ * match inside any row range is found without scanning the column.
+ */
+class LookupIndex {
+public:
+    /**
+     * @brief Adds a cell; rows must be added from the last one up, in decreasing order.
+     * @param row The row index (0-based).
+     * @param text The raw content of the cell.
+     */
+    void add(int row, const std::string& text);
+
+    /**
+     * @brief Finds the first row in a range holding a key.
+     * @param key The value looked up.
+     * @param firstRow The first row of the range (0-based).
+     * @param lastRow The last row of the range, inclusive.
+     * @return The row, or -1 if no cell of the range holds the key.
+     */
+    int find(const std::string& key, int firstRow, int lastRow) const;
+
+private:
+    std::unordered_map<std::string, int> firstRows; ///< First row of every normalized key.
+    std::vector<int> nextRows;                      ///< Next row with the same key, -1 at the end of a chain.
+
+    /**
+     * @brief Makes numbers comparable by value and keeps other texts apart from them.
+     */
+    static std::string normalize(const std::string& text);
+};
+
+#endif // LOOKUP_INDEX_H
@@ -0,0 +1,73 @@
+/**
+ * @file NumberFormat.h
+ * @brief Declaration of the NumberFormat class converting between numbers and text without allocating.
+ */
+
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Classification of a text as a number, computed in one pass by NumberFormat::parse.
+ */
+struct TextNumber {
+    double value = 0.0;      ///< The number, as strtod gives it; 0.0 for texts that are not numbers.
+    bool numeric = false;    ///< True if the text matches -?\d*\.?\d+([eE][-+]?\d+)?
+    bool outOfRange = false; ///< True for numbers std::stod rejects as out of range.
+};
+
+/**
+ * @class NumberFormat
+ * @brief Writes doubles as plain decimal text into caller-provided buffers.
+ *
+ * Neither form uses an exponent, so the text is accepted wherever cell
+ * contents are parsed as numbers. Values passed between evaluations use the
+ * shortest text that reads back as the same double, so no precision is lost
+ * along a chain of formulas. Displayed values are rounded to 15 decimals and
+ * trimmed, so 0.1+0.2 shows as 0.3.
+ *
+ * Parsing accepts exactly the texts LexicalAnalysis::isNumeric accepts and
+ * converts them like std::stod, in the same pass over the characters.
+ */
+class NumberFormat {
+public:
+    /**
+     * @brief Buffer size large enough for any double in either form.
+     */
+    static const std::size_t bufferSize = 384;
+
+    /**
+     * @brief Writes the shortest decimal text that reads back as the same value.
+     * @param value The number to write.
+     * @param buffer Receives the text, not terminated; at least bufferSize chars.
+     * @return The length of the text.
+     */
+    static std::size_t writeShortest(double value, char* buffer);
+
+    /**
+     * @brief Writes a value rounded to 15 decimals, without trailing zeros or a trailing point.
+     * @param value The number to write.
+     * @param buffer Receives the text, not terminated; at least bufferSize chars.
+     * @return The length of the text.
+     */
+    static std::size_t writeDisplay(double value, char* buffer);
+
+    /**
+     * @brief Classifies a text and converts it if it is a number.
+     * @param text The text to parse.
+     * @return The classification and value of the text.
+     */
+    static TextNumber parse(const std::string& text);
+
+    /**
+     * @brief Gets the shortest round-trip text of a value.
+     */
+    static std::string toString(double value) {
+        char buffer[bufferSize];
+        return std::string(buffer, writeShortest(value, buffer));
+    }
+};
+
+#endif // NUMBER_FORMAT_H
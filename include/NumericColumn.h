@@ -0,0 +1,157 @@
+/**
+ * @file NumericColumn.h
+ * @brief Declaration of the NumericColumn class holding the numbers of one sheet column contiguously.
+ */
+
+#ifndef NUMERIC_COLUMN_H
+#define NUMERIC_COLUMN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "NumberFormat.h"
+
+/**
+ * @brief Comparison of a cell with a constant, as in the criterion of SUMIF.
+ */
+enum class Comparison { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+/**
+ * @class NumericColumn
+ * @brief Typed array of the numeric cells of one column, with a null bitmap.
+ *
+ * A cell counts as a number exactly when LexicalAnalysis::isNumeric accepts its
+ * raw content. Other cells are null: their bit is clear and their value is 0.0,
+ * so a sum can run over the array without looking at the bitmap.
+ *
+ * Numbers that std::stod rejects as out of range are tracked separately; ranges
+ * containing one are not exact and must be evaluated from the cell texts.
+ */
+class NumericColumn {
+public:
+    /**
+     * @brief Stores the number of a cell, growing the column if needed.
+     * @param row The row index (0-based).
+     * @param number The classification of the cell's raw content.
+     */
+    void set(int row, const TextNumber& number);
+
+    /**
+     * @brief Grows or shrinks the column; added cells are null.
+     * @param rows The new number of rows.
+     */
+    void resize(int rows);
+
+    /**
+     * @brief Gets the number of rows held by the column.
+     */
+    int size() const { return static_cast<int>(values.size()); }
+
+    /**
+     * @brief Checks whether every number in a range could be converted.
+     * @param first The first row (0-based).
+     * @param last The last row, inclusive.
+     */
+    bool isExact(int first, int last) const;
+
+    /**
+     * @brief Counts the numeric cells in a range.
+     * @param first The first row (0-based).
+     * @param last The last row, inclusive.
+     */
+    std::size_t count(int first, int last) const;
+
+    /**
+     * @brief Adds the numbers of a range in row order.
+     * @param first The first row (0-based).
+     * @param last The last row, inclusive.
+     */
+    double sum(int first, int last) const;
+
+    /**
+     * @brief Gets the smallest number of a range, which must hold at least one.
+     * @param first The first row (0-based).
+     * @param last The last row, inclusive.
+     */
+    double min(int first, int last) const;
+
+    /**
+     * @brief Gets the largest number of a range, which must hold at least one.
+     * @param first The first row (0-based).
+     * @param last The last row, inclusive.
+     */
+    double max(int first, int last) const;
+
+    /**
+     * @brief Adds the squared distances of the numbers of a range from a mean.
+     * @param first The first row (0-based).
+     * @param last The last row, inclusive.
+     * @param mean The value distances are measured from.
+     */
+    double sumSquaredDeviations(int first, int last, double mean) const;
+
+    /**
+     * @brief Marks the rows of a range whose number compares true with a constant.
+     *
+     * Bit i of the mask stands for row first + i. Null rows never compare true,
+     * except with NotEqual. Each word of the mask is built by a branch-free loop
+     * over 64 values, which the compiler can vectorize.
+     *
+     * @param first The first row (0-based).
+     * @param last The last row, inclusive.
+     * @param comparison How each number is compared with the constant.
+     * @param constant The number on the right-hand side of the comparison.
+     * @param mask Receives one bit per row of the range.
+     */
+    void compare(int first, int last, Comparison comparison, double constant, std::vector<std::uint64_t>& mask) const;
+
+    /**
+     * @brief Adds the numbers of the rows set in a mask, in row order.
+     * @param first The row of bit 0 of the mask (0-based).
+     * @param mask One bit per row, as built by compare().
+     */
+    double maskedSum(int first, const std::vector<std::uint64_t>& mask) const;
+
+    /**
+     * @brief Counts the numeric cells among the rows set in a mask.
+     * @param first The row of bit 0 of the mask (0-based).
+     * @param mask One bit per row, as built by compare().
+     */
+    std::size_t maskedCount(int first, const std::vector<std::uint64_t>& mask) const;
+
+    /**
+     * @brief Counts the bits set in a mask.
+     */
+    static std::size_t countSet(const std::vector<std::uint64_t>& mask);
+
+    /**
+     * @brief Gets the bytes held by the arrays.
+     */
+    std::size_t getMemoryUsage() const;
+
+private:
+    std::vector<double> values;          ///< One value per row, 0.0 for null cells.
+    std::vector<std::uint64_t> valid;    ///< Bit set for rows holding a convertible number.
+    std::vector<std::uint64_t> overflow; ///< Bit set for rows whose number std::stod rejects.
+    std::size_t overflowCount = 0;       ///< Number of bits set in overflow.
+
+    /**
+     * @brief Visits the rows of a range whose valid bit is set, in row order.
+     */
+    template <typename Visit>
+    void forEachNumber(int first, int last, Visit visit) const;
+
+    /**
+     * @brief Builds the mask of compare() for one test of a value against the constant.
+     */
+    template <typename Test>
+    void compareRange(int first, int last, bool negate, Test test, std::vector<std::uint64_t>& mask) const;
+
+    /**
+     * @brief Gets the 64 bits of a bitmap starting at a row; bits past its end are clear.
+     */
+    static std::uint64_t bitsFrom(const std::vector<std::uint64_t>& words, int row);
+};
+
+#endif // NUMERIC_COLUMN_H
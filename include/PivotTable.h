@@ -0,0 +1,96 @@
+/**
+ * @file PivotTable.h
+ * @brief Declaration of the PivotTable class grouping the rows of a sheet and aggregating each group.
+ */
+
+#ifndef PIVOT_TABLE_H
+#define PIVOT_TABLE_H
+
+#include <string>
+#include <vector>
+#include "CellMatrix.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief One aggregated column of a pivot table, such as SUM(C).
+ */
+struct PivotValue {
+    int column;           ///< The column aggregated (0-based).
+    std::string function; ///< SUM, AVER, MAX, MIN or STDDEV.
+};
+
+/**
+ * @class PivotTable
+ * @brief Groups rows by the contents of key columns and aggregates value columns per group.
+ *
+ * Keys are typed like the keys of RowView::sort: numeric texts group by value,
+ * so "5" and "5.0" are one group, other texts by their bytes, and cells that are
+ * empty or only spaces form one group of their own. Values are aggregated like
+ * the range functions: only numeric cells count, formulas are read as their
+ * text and STDDEV is the population deviation.
+ *
+ * Each pool thread aggregates a chunk of rows into its own hash tables, one per
+ * partition of the key hashes; the partitions are then merged on the pool
+ * threads without locking, since equal keys always fall into the same partition.
+ */
+class PivotTable {
+public:
+    /**
+     * @brief Defines the grouping and the aggregates.
+     * @param keyColumns The columns whose contents identify a group (0-based), at least one.
+     * @param values The aggregated columns, in the order they are output.
+     * @throws std::invalid_argument If there is no key column or a function is unknown.
+     */
+    PivotTable(std::vector<int> keyColumns, std::vector<PivotValue> values);
+
+    /**
+     * @brief Parses a list of column letters such as "A,B".
+     * @param text The list; spaces are ignored.
+     * @param columns Receives the columns (0-based).
+     * @return False if the list is empty or an item is not a column.
+     */
+    static bool parseColumns(const std::string& text, std::vector<int>& columns);
+
+    /**
+     * @brief Parses a list of aggregates such as "SUM(C),AVER(D)".
+     * @param text The list; spaces are ignored.
+     * @param values Receives the aggregates.
+     * @return False if the list is empty or an item is not an aggregate of a column.
+     */
+    static bool parseValues(const std::string& text, std::vector<PivotValue>& values);
+
+    /**
+     * @brief Groups a range of rows, replacing the result of any earlier call.
+     *
+     * The groups are ordered by their keys: numbers by value, then texts by
+     * their bytes, then the empty key, comparing the key columns in order.
+     *
+     * @param data The rows to group; read concurrently, so it must not change meanwhile.
+     * @param firstRow The first row of the range (0-based).
+     * @param lastRow The last row of the range (0-based), clamped to the rows of the data.
+     * @param pool The threads sharing the work.
+     */
+    void aggregate(const CellMatrix& data, int firstRow, int lastRow, ThreadPool& pool);
+
+    /**
+     * @brief Gets the number of groups found by the last aggregate() call.
+     */
+    int getGroupCount() const { return static_cast<int>(rows.empty() ? 0 : rows.size() - 1); }
+
+    /**
+     * @brief Gets the result as cell texts, ready for Spreadsheet::pasteBlock.
+     *
+     * The first row names the columns, such as "A" and "SUM(C)"; every group
+     * follows with the texts of its keys, as in the first row of the group,
+     * and its aggregates. An aggregate of a group without numbers is empty,
+     * except SUM which is 0.
+     */
+    const std::vector<std::vector<std::string>>& getRows() const { return rows; }
+
+private:
+    std::vector<int> keyColumns;               ///< Columns identifying a group.
+    std::vector<PivotValue> values;            ///< Aggregated columns.
+    std::vector<std::vector<std::string>> rows; ///< Header and one row per group.
+};
+
+#endif // PIVOT_TABLE_H
@@ -0,0 +1,66 @@
+/**
+ * @file RangeFunctionCache.h
+ * @brief Declaration of the RangeFunctionCache class sharing range function results within a recalculation.
+ */
+
+#ifndef RANGE_FUNCTION_CACHE_H
+#define RANGE_FUNCTION_CACHE_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Results of range functions such as "SUM(A1..A100)" computed during one recalculation.
+ *
+ * Range functions read the raw cell contents, so within one data version the
+ * same expression always gives the same result, whichever formula contains it.
+ * Workers of a recalculation share one cache; it must be cleared whenever the
+ * data changes. "@SUM(...)" and "SUM(...)" share an entry.
+ */
+class RangeFunctionCache {
+public:
+    /**
+     * @brief Looks up the result of an expression.
+     * @param expression The range function token, e.g. "@MAX(B2..B9)".
+     * @param result Receives the cached result.
+     * @return True if the expression was computed before.
+     */
+    bool find(const std::string& expression, std::string& result) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = results.find(key(expression));
+        if (found == results.end()) {
+            return false;
+        }
+        result = found->second;
+        return true;
+    }
+
+    /**
+     * @brief Records the result of an expression.
+     * @param expression The range function token.
+     * @param result Its result.
+     */
+    void store(const std::string& expression, const std::string& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[key(expression)] = result;
+    }
+
+    /**
+     * @brief Forgets every result.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.clear();
+    }
+
+private:
+    mutable std::mutex mutex;                              ///< Guards results.
+    std::unordered_map<std::string, std::string> results;  ///< Result by expression without its '@'.
+
+    static std::string key(const std::string& expression) {
+        return !expression.empty() && expression[0] == '@' ? expression.substr(1) : expression;
+    }
+};
+
+#endif // RANGE_FUNCTION_CACHE_H
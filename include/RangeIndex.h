@@ -0,0 +1,132 @@
+/**
+ * @file RangeIndex.h
+ * @brief Declaration of the RangeIndex class finding the ranges that cover a cell.
+ */
+
+#ifndef RANGE_INDEX_H
+#define RANGE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct CellRange;
+
+/**
+ * @class RangeIndex
+ * @brief Interval index of the ranges read by formulas, per column and per row.
+ *
+ * A range within one column, such as A1..A100000, is one row interval of that
+ * column; a range within one row is one column interval of that row. Other
+ * rectangles are an interval of each of their columns. Finding the formulas
+ * whose range covers a cell therefore looks at one column and one row, in
+ * O(log n + k) for n intervals on them and k results, and the memory grows with
+ * the number of ranges rather than with the cells they cover.
+ *
+ * Each line keeps its intervals sorted by start as an implicit binary search
+ * tree, where every node also holds the largest end of its subtree. Changes
+ * are collected until refresh(), which rebuilds the changed lines only: the
+ * removed intervals are dropped in one pass over the line and the added ones
+ * are sorted and merged in, so a batch of a changes and r removals on a line
+ * of m intervals costs O(m + a log a + r log r) however many there are.
+ */
+class RangeIndex {
+public:
+    /**
+     * @brief Removes every range.
+     */
+    void clear() { lines.clear(); }
+
+    /**
+     * @brief Records a range read by a cell; takes effect at the next refresh().
+     * @param range The covered cells.
+     * @param reader The index of the cell reading the range.
+     */
+    void add(const CellRange& range, std::size_t reader);
+
+    /**
+     * @brief Forgets a range recorded by add(); takes effect at the next refresh().
+     *
+     * The interval is only marked for removal, so removing many readers of one
+     * line does not scan the line once per reader.
+     * @param range The covered cells, as added.
+     * @param reader The index of the cell reading the range.
+     */
+    void remove(const CellRange& range, std::size_t reader);
+
+    /**
+     * @brief Rebuilds the lines changed since the last call, so that queries see the changes.
+     */
+    void refresh();
+
+    /**
+     * @brief Lists the readers of every range covering a cell.
+     * @param sheet The index of the cell's sheet.
+     * @param row The row of the cell (0-based).
+     * @param col The column of the cell (0-based).
+     * @param readers Receives the readers, appended; a reader appears once per covering range.
+     */
+    void findCovering(int sheet, int row, int col, std::vector<std::size_t>& readers) const;
+
+    /**
+     * @brief Gets the number of intervals held, not counting the ones marked for removal.
+     */
+    std::size_t size() const;
+
+private:
+    /**
+     * @brief One range on one line: a row interval of a column or a column interval of a row.
+     */
+    struct Interval {
+        int start;          ///< First covered row or column.
+        int end;            ///< Last covered row or column, inclusive.
+        int maxEnd;         ///< Largest end in the subtree rooted at this interval.
+        std::size_t reader; ///< The cell reading the range.
+    };
+
+    /**
+     * @brief The intervals of one column or row.
+     */
+    struct Line {
+        std::vector<Interval> intervals; ///< Sorted by start up to sorted; added ones follow.
+        std::vector<Interval> removed;   ///< Intervals to drop at the next refresh.
+        std::size_t sorted = 0;          ///< Number of leading intervals sorted and augmented.
+        bool changed = false;            ///< True if intervals were added or removed since the last refresh.
+    };
+
+    std::unordered_map<std::uint64_t, Line> lines; ///< Lines holding at least one interval, by key().
+    std::vector<std::uint64_t> changedLines;       ///< Keys of the lines to rebuild at the next refresh.
+
+    /**
+     * @brief Identifies a column (byRow false) or a row (byRow true) of a sheet.
+     */
+    static std::uint64_t key(int sheet, bool byRow, int line) {
+        return (static_cast<std::uint64_t>(sheet) << 33) | (static_cast<std::uint64_t>(byRow) << 32) |
+               static_cast<std::uint32_t>(line);
+    }
+
+    /**
+     * @brief Calls visit(key, start, end) for every line interval of a range.
+     */
+    template <typename Visit>
+    static void forEachLine(const CellRange& range, Visit visit);
+
+    /**
+     * @brief Drops the intervals marked for removal from a line, keeping the order of the others.
+     */
+    static void dropRemoved(Line& line);
+
+    /**
+     * @brief Computes maxEnd for the subtree over intervals [begin, end) and returns it.
+     */
+    static int augment(std::vector<Interval>& intervals, std::size_t begin, std::size_t end);
+
+    /**
+     * @brief Appends the readers of the intervals in [begin, end) containing a position.
+     */
+    static void stab(const std::vector<Interval>& intervals, std::size_t begin, std::size_t end, int position,
+                     std::vector<std::size_t>& readers);
+};
+
+#endif // RANGE_INDEX_H
@@ -0,0 +1,131 @@
+/**
+ * @file RecalcEngine.h
+ * @brief Declaration of the RecalcEngine class that evaluates a whole workbook in parallel.
+ */
+
+#ifndef RECALC_ENGINE_H
+#define RECALC_ENGINE_H
+
+#include <functional>
+#include <memory>
+#include "CellMatrix.h"
+#include "CellValueCache.h"
+#include "DependencyGraph.h"
+#include "RangeFunctionCache.h"
+#include "ThreadPool.h"
+#include "Tokenizer.h"
+#include "ValueSnapshot.h"
+#include "Workbook.h"
+
+/**
+ * @class RecalcEngine
+ * @brief Level-parallel whole-workbook recalculation.
+ *
+ * The engine builds the dependency graph of every sheet together, splits the
+ * cells into levels whose precedents are complete, and evaluates each level
+ * across a thread pool. Every worker uses its own LexicalAnalysis per sheet over
+ * the shared const data; referenced cells, on the same sheet or another one,
+ * resolve from the sheet's CellValueCache instead of being evaluated recursively,
+ * and each distinct range function of a sheet is computed once per recalculation.
+ *
+ * The graph and values are kept between calls. When every sheet only differs
+ * from its last recalculated version by single-cell edits (CellMatrix::changesSince),
+ * only the edited cells and the cells depending on them, on any sheet, are
+ * evaluated again. Adding, removing or resizing a sheet recalculates everything.
+ */
+class RecalcEngine {
+public:
+    /**
+     * @brief Creates the engine and its thread pool.
+     * @param threadCount Number of evaluating threads; 0 uses the number of hardware threads.
+     */
+    explicit RecalcEngine(unsigned threadCount = 0);
+
+    /**
+     * @brief Brings the values of every sheet up to date with the workbook.
+     * @param book The sheets.
+     * @param cancelled Polled between chunks; returning true abandons the recalculation.
+     * @return The display values of every cell, or nullptr if the recalculation was abandoned.
+     */
+    std::shared_ptr<ValueSnapshot> recalculate(const Workbook& book, const std::function<bool()>& cancelled);
+
+    /**
+     * @brief Brings the values up to date with a single sheet.
+     * @param data The cell data, recalculated as the only sheet of a workbook.
+     * @param cancelled Polled between chunks; returning true abandons the recalculation.
+     * @return The display values of every cell, or nullptr if the recalculation was abandoned.
+     */
+    std::shared_ptr<ValueSnapshot> recalculate(const CellMatrix& data, const std::function<bool()>& cancelled);
+
+    /**
+     * @brief Forgets the previous results so the next recalculation evaluates every cell.
+     */
+    void invalidate() { hasComputed = false; }
+
+    /**
+     * @brief Gets the number of threads evaluating cells.
+     */
+    unsigned getThreadCount() const { return pool.size(); }
+
+    /**
+     * @brief Gets the number of cells evaluated by the last recalculation.
+     */
+    std::size_t getLastEvaluatedCount() const { return lastEvaluatedCount; }
+
+private:
+    /**
+     * @brief Lists the cells edited since the last recalculation, if they are known cell by cell.
+     * @param book The sheets.
+     * @param edited Receives the graph indices of the edited cells.
+     * @return False if the sheets were added, removed, resized or replaced since.
+     */
+    bool collectEdits(const Workbook& book, std::vector<std::size_t>& edited) const;
+
+    /**
+     * @brief Rebuilds the graph and evaluates every cell.
+     * @return False if the recalculation was abandoned.
+     */
+    bool recalculateAll(const Workbook& book, const std::function<bool()>& cancelled);
+
+    /**
+     * @brief Evaluates the edited cells and everything depending on them.
+     * @param edited The graph indices of the edited cells.
+     * @return False if the recalculation was abandoned.
+     */
+    bool recalculateCells(const Workbook& book, std::vector<std::size_t> edited,
+                          const std::function<bool()>& cancelled);
+
+    /**
+     * @brief Evaluates the cells of each level in parallel, one level after the other.
+     * @return False if the recalculation was abandoned.
+     */
+    bool evaluateLevels(const Workbook& book, const std::vector<std::vector<std::size_t>>& levels,
+                        const std::function<bool()>& cancelled);
+
+    /**
+     * @brief Finds the sheet of a graph cell and its row-major index within that sheet.
+     */
+    int locate(std::size_t cell, std::size_t& index) const {
+        int sheet = graph.sheetOf(cell);
+        index = cell - graph.firstCell(sheet);
+        return sheet;
+    }
+
+    /**
+     * @brief Gets a display block of a sheet that is not shared with a published snapshot.
+     */
+    std::vector<std::string>& writableBlock(int sheet, std::size_t block);
+
+    ThreadPool pool;           ///< Threads evaluating the cells of a level.
+    const Tokenizer tokenizer; ///< Shared tokenizer, only used through const methods.
+    DependencyGraph graph;     ///< Tokens and precedents of the last recalculated workbook.
+    std::vector<CellValueCache> values; ///< Values of the last recalculated workbook, by sheet.
+    std::vector<std::unique_ptr<RangeFunctionCache>> rangeResults; ///< Range function results of the workbook being recalculated, by sheet.
+    std::vector<std::vector<std::shared_ptr<std::vector<std::string>>>> displayBlocks; ///< Display texts by sheet, shared with snapshots.
+    std::vector<std::string> computedNames;       ///< Sheet names the values belong to.
+    std::vector<std::uint64_t> computedVersions;  ///< Sheet versions the values belong to.
+    bool hasComputed = false;  ///< False until a recalculation completes.
+    std::size_t lastEvaluatedCount = 0; ///< Cells evaluated by the last recalculation.
+};
+
+#endif // RECALC_ENGINE_H
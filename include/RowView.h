@@ -0,0 +1,87 @@
+/**
+ * @file RowView.h
+ * @brief Declaration of the RowView class ordering and selecting rows without moving cells.
+ */
+
+#ifndef ROW_VIEW_H
+#define ROW_VIEW_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+/**
+ * @class RowView
+ * @brief Sorted and filtered order of the rows of a sheet, as a list of row indices.
+ *
+ * The cells stay where they are; a view row is mapped to the row of the data
+ * it shows. An inactive view shows every row in its own order. Sorting and
+ * filtering an active view apply to the rows it already shows, so a filter
+ * followed by a sort orders the selected rows only.
+ */
+class RowView {
+public:
+    /**
+     * @brief Checks whether rows are sorted or filtered.
+     */
+    bool isActive() const { return active; }
+
+    /**
+     * @brief Gets the number of rows shown by an active view.
+     */
+    int size() const { return static_cast<int>(rows.size()); }
+
+    /**
+     * @brief Maps a view row to the data row it shows.
+     * @param viewRow The row index in the view (0-based).
+     * @return The row index in the data.
+     */
+    int sourceRow(int viewRow) const { return active ? rows[viewRow] : viewRow; }
+
+    /**
+     * @brief Finds where a data row is shown.
+     * @param sourceRow The row index in the data (0-based).
+     * @return The row index in the view, or -1 if the row is filtered out.
+     */
+    int viewRowOf(int sourceRow) const;
+
+    /**
+     * @brief Shows every row in its own order again.
+     */
+    void reset();
+
+    /**
+     * @brief Orders the shown rows by a text per row, compared by type.
+     *
+     * The key of every row is extracted once: numbers sort by value before
+     * texts, which sort by their bytes; empty texts and texts of spaces only
+     * always come last. Equal keys keep their current order. The rows are
+     * sorted in chunks on the pool threads, then the chunks are merged
+     * pairwise in parallel.
+     *
+     * @param rowCount The number of rows of the data, used when the view is inactive.
+     * @param textOf Gives the text of a data row; called concurrently.
+     * @param ascending False to sort numbers and texts in descending order.
+     * @param pool The threads sharing the work.
+     */
+    void sort(int rowCount, const std::function<const std::string&(int)>& textOf, bool ascending, ThreadPool& pool);
+
+    /**
+     * @brief Keeps only the shown rows satisfying a predicate.
+     * @param rowCount The number of rows of the data, used when the view is inactive.
+     * @param keep Called with each shown data row; returns true to keep it.
+     */
+    void filter(int rowCount, const std::function<bool(int)>& keep);
+
+private:
+    bool active = false;    ///< False while every row is shown in its own order.
+    std::vector<int> rows;  ///< Data row of every view row, when active.
+
+    /**
+     * @brief Lists every data row in order if the view is not active yet.
+     */
+    void activate(int rowCount);
+};
+
+#endif // ROW_VIEW_H
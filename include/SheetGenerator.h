@@ -0,0 +1,96 @@
+/**
+ * @file SheetGenerator.h
+ * @brief Declaration of the SheetGenerator class for producing synthetic spreadsheets.
+ *
+ * The generator emits sheets shaped like the sample files (numeric columns,
+ * "=A1+7" style reference chains, fan-in SUM ranges and label noise) in the
+ * CSV format read by CellMatrix::loadFromFile. The content of every cell is a
+ * pure function of the options and its coordinates, so the same options
+ * always produce byte-identical output.
+ */
+
+#ifndef SHEET_GENERATOR_H
+#define SHEET_GENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Options describing the size and content mix of a generated sheet.
+ *
+ * The formula kinds (chain, sum, arithmetic) are picked according to their
+ * relative weights among the cells selected as formulas.
+ */
+struct GeneratorOptions {
+    int rows = 1000;            ///< Number of rows to generate.
+    int cols = 8;               ///< Number of columns to generate (column A is always numeric).
+    double formulaRatio = 0.5;  ///< Fraction of cells outside column A holding a formula.
+    double labelRatio = 0.1;    ///< Fraction of cells outside column A holding a label.
+    int chainWeight = 1;        ///< Relative weight of "=B1+7" reference chain formulas.
+    int sumWeight = 1;          ///< Relative weight of fan-in "=SUM(A1..A10)" formulas.
+    int arithWeight = 1;        ///< Relative weight of "=2*A1" / "=A1+B1" formulas.
+    int chainDepth = 10;        ///< Maximum length of a reference chain before it restarts.
+    int fanIn = 10;             ///< Number of cells aggregated by each SUM formula.
+    std::uint64_t seed = 1;     ///< Seed controlling every random choice.
+};
+
+/**
+ * @brief Produces deterministic synthetic spreadsheets for benchmarks and soak tests.
+ */
+class SheetGenerator {
+public:
+    /**
+     * @brief Constructs a generator for the given options.
+     * @param options Size, content mix and seed of the sheet.
+     * @throws std::invalid_argument If the options are out of range.
+     */
+    explicit SheetGenerator(const GeneratorOptions& options);
+
+    /**
+     * @brief Returns the content of a cell.
+     * @param row The row index of the cell (1-based indexing).
+     * @param col The column index of the cell (1-based indexing).
+     * @return The generated cell content, identical on every call.
+     */
+    std::string cellAt(int row, int col) const;
+
+    /**
+     * @brief Writes the whole sheet as CSV.
+     * @param out The stream receiving the rows.
+     */
+    void write(std::ostream& out) const;
+
+    /**
+     * @brief Writes the whole sheet to a CSV file.
+     * @param filename The path of the CSV file.
+     * @return True if the file was written successfully, false otherwise.
+     */
+    bool writeToFile(const std::string& filename) const;
+
+    /**
+     * @brief Gets the options used by this generator.
+     * @return The generator options.
+     */
+    const GeneratorOptions& getOptions() const { return options; }
+
+private:
+    GeneratorOptions options; ///< Size, content mix and seed of the sheet.
+
+    /**
+     * @brief Hashes the seed, cell coordinates and a salt into a uniform 64-bit value.
+     */
+    std::uint64_t hash(int row, int col, std::uint64_t salt) const;
+
+    /**
+     * @brief Hashes into a uniform value in [0, 1).
+     */
+    double unit(int row, int col, std::uint64_t salt) const;
+
+    /**
+     * @brief Builds a formula cell of the kind selected by the mix weights.
+     */
+    std::string formulaAt(int row, int col) const;
+};
+
+#endif // SHEET_GENERATOR_H
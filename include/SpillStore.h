@@ -0,0 +1,116 @@
+/**
+ * @file SpillStore.h
+ * @brief Declaration of the SpillStore class keeping evicted cell blocks in a temporary file.
+ */
+
+#ifndef SPILL_STORE_H
+#define SPILL_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class SpillStore
+ * @brief Append-only temporary file of cell blocks evicted under a memory budget.
+ *
+ * A block is written once and read back as often as it is faulted in; a
+ * record is never rewritten, so a block that was not modified since it was
+ * read back can be evicted again without writing. The file is deleted when
+ * the store is destroyed. Reads and writes are serialized by a mutex, which
+ * also serializes the faults of the matrices sharing the store.
+ *
+ * The counters are updated by every matrix sharing the store, snapshots
+ * included, and are meant for sizing the budget.
+ */
+class SpillStore {
+public:
+    /**
+     * @brief Location of one record in the file.
+     */
+    struct Slot {
+        std::uint64_t offset = 0; ///< Byte offset of the record.
+        std::uint64_t size = 0;   ///< Length of the record in bytes.
+    };
+
+    /**
+     * @brief Counters of the residency checks and of the file traffic.
+     */
+    struct Stats {
+        std::uint64_t hits;          ///< Block accesses that found the block in memory.
+        std::uint64_t faults;        ///< Block accesses that read the block back from the file.
+        std::uint64_t blocksWritten; ///< Records appended to the file.
+        std::uint64_t bytesWritten;  ///< Bytes appended to the file.
+        std::uint64_t blocksRead;    ///< Records read back.
+        std::uint64_t bytesRead;     ///< Bytes read back.
+    };
+
+    SpillStore();
+    ~SpillStore();
+    SpillStore(const SpillStore&) = delete;
+    SpillStore& operator=(const SpillStore&) = delete;
+
+    /**
+     * @brief Appends the texts of a block of rows.
+     * @param rows The cell texts of every row of the block.
+     * @param slot Receives the location of the record.
+     * @return False if the file cannot be created or written.
+     */
+    bool write(const std::vector<std::vector<const std::string*>>& rows, Slot& slot);
+
+    /**
+     * @brief Reads the texts of a block back.
+     * @param slot The location returned by write().
+     * @param rows Receives the cell texts of every row of the block.
+     * @return False if the file cannot be read.
+     */
+    bool read(const Slot& slot, std::vector<std::vector<std::string>>& rows);
+
+    /**
+     * @brief Gets the mutex serializing faults into blocks spilled to this store.
+     */
+    std::mutex& faultMutex() { return faults; }
+
+    /**
+     * @brief Gets the current eviction epoch; accesses are stamped with it for LRU order.
+     */
+    std::uint64_t getEpoch() const { return epoch.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Starts a new eviction epoch.
+     */
+    void nextEpoch() { epoch.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Counts a block access that found the block in memory.
+     */
+    void countHit() { hitCount.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Counts a block access that read the block back.
+     */
+    void countFault() { faultCount.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Gets a copy of the counters.
+     */
+    Stats getStats() const;
+
+private:
+    std::FILE* file = nullptr;      ///< The temporary file, created on the first write.
+    std::uint64_t fileSize = 0;     ///< Bytes appended so far.
+    mutable std::mutex mutex;       ///< Guards the file and the I/O counters.
+    std::mutex faults;              ///< Serializes faults, see faultMutex().
+    std::atomic<std::uint64_t> epoch{1};
+    std::atomic<std::uint64_t> hitCount{0};
+    std::atomic<std::uint64_t> faultCount{0};
+    std::uint64_t blocksWritten = 0;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t blocksRead = 0;
+    std::uint64_t bytesRead = 0;
+};
+
+#endif // SPILL_STORE_H
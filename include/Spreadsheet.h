@@ -17,6 +17,16 @@
 #include "Tokenizer.h"
 #include "LexicalAnalysis.h"
 #include "CellMatrix.h"
+#include "EvaluationProfiler.h"
+#include "BackgroundRecalculator.h"
+#include "EditJournal.h"
+#include "AutoSaver.h"
+#include "RowView.h"
+#include "PivotTable.h"
+#include "Workbook.h"
+#include "LazyEvaluator.h"
+#include <functional>
+#include <memory>
 
 /**
  * @brief Represents a spreadsheet for managing and displaying data.
@@ -62,6 +72,232 @@ public:
      */
     void display(AnsiTerminal& terminal, int cursorRow, int cursorCol, int offsetRow, int offsetCol);
 
+    /**
+     * @brief Sets the content of a cell and records the edit for undo.
+     *
+     * @param row The row of the cell (0-based).
+     * @param col The column of the cell (0-based).
+     * @param value The new content.
+     * @param continueEdit True if this keystroke continues typing into the cell of the previous edit.
+     */
+    void setCell(int row, int col, const std::string& value, bool continueEdit);
+
+    /**
+     * @brief Reverts the most recent edit.
+     *
+     * @param row Receives the row of the reverted cell (0-based).
+     * @param col Receives the column of the reverted cell (0-based).
+     * @return False if there is nothing to undo.
+     */
+    bool undo(int& row, int& col);
+
+    /**
+     * @brief Applies the most recently undone edit again.
+     *
+     * @param row Receives the row of the restored cell (0-based).
+     * @param col Receives the column of the restored cell (0-based).
+     * @return False if there is nothing to redo.
+     */
+    bool redo(int& row, int& col);
+
+    /**
+     * @brief Copies the cells of a row down over the rows below it, shifting their references.
+     *
+     * Like the other bulk edits, the cells are written as one edit: the data is
+     * resized once and the next recalculation revisits the written cells in one
+     * pass. Bulk edits cannot be undone and clear the undo history.
+     *
+     * @param row The row copied (0-based).
+     * @param col The first column copied (0-based).
+     * @param lastRow The last row filled, inclusive.
+     * @param lastCol The last column copied, inclusive.
+     */
+    void fillDown(int row, int col, int lastRow, int lastCol);
+
+    /**
+     * @brief Copies the cells of a column right over the columns after it, shifting their references.
+     *
+     * @param row The first row copied (0-based).
+     * @param col The column copied (0-based).
+     * @param lastRow The last row copied, inclusive.
+     * @param lastCol The last column filled, inclusive.
+     */
+    void fillRight(int row, int col, int lastRow, int lastCol);
+
+    /**
+     * @brief Sets a block of cells to the given contents as they are, as one edit.
+     *
+     * @param row The row of the top left cell (0-based).
+     * @param col The column of the top left cell (0-based).
+     * @param values The contents by row, then by column.
+     */
+    void pasteBlock(int row, int col, const std::vector<std::vector<std::string>>& values);
+
+    /**
+     * @brief Empties a rectangle of cells as one edit.
+     *
+     * @param firstRow The first row (0-based).
+     * @param firstCol The first column (0-based).
+     * @param lastRow The last row, inclusive.
+     * @param lastCol The last column, inclusive.
+     */
+    void clearRange(int firstRow, int firstCol, int lastRow, int lastCol);
+
+    /**
+     * @brief Inserts empty rows before a row, moving the references to the rows below in every sheet.
+     *
+     * Like the bulk edits, this cannot be undone; the rows on screen return to
+     * the order of the data, as the sorted rows have moved.
+     *
+     * @param row The first inserted row (0-based).
+     * @param count The number of rows to insert.
+     */
+    void insertRows(int row, int count);
+
+    /**
+     * @brief Deletes rows, moving the references to the rows below; references to deleted cells become "#REF".
+     * @param row The first deleted row (0-based).
+     * @param count The number of rows to delete.
+     */
+    void deleteRows(int row, int count);
+
+    /**
+     * @brief Inserts empty columns before a column, moving the references to the columns after it.
+     * @param col The first inserted column (0-based).
+     * @param count The number of columns to insert.
+     */
+    void insertColumns(int col, int count);
+
+    /**
+     * @brief Deletes columns, moving the references to the columns after them.
+     * @param col The first deleted column (0-based).
+     * @param count The number of columns to delete.
+     */
+    void deleteColumns(int col, int count);
+
+    /**
+     * @brief Sorts the shown rows by the displayed values of a column.
+     *
+     * Only the order of the rows on screen changes; cells and references keep
+     * their rows. Formula cells sort by their computed values once those are
+     * current, and by their content while a recalculation is pending.
+     *
+     * @param col The column to sort by (0-based).
+     * @param ascending False to sort from the largest value down.
+     */
+    void sortByColumn(int col, bool ascending);
+
+    /**
+     * @brief Hides the shown rows whose displayed value in a column fails a predicate.
+     *
+     * @param col The column tested (0-based).
+     * @param keep Called with the displayed value of each shown row; returns true to keep the row.
+     */
+    void filterByColumn(int col, const std::function<bool(const std::string&)>& keep);
+
+    /**
+     * @brief Shows every row in its own order again.
+     */
+    void clearView();
+
+    /**
+     * @brief Groups every row of the data and pastes the result as one edit, see PivotTable.
+     *
+     * The result lands in the sheet like any pasted block, so it is shown,
+     * saved and recalculated with the data. Rows and columns are added if the
+     * result does not fit.
+     *
+     * @param row The row of the result's top left cell (0-based).
+     * @param col The column of the result's top left cell (0-based).
+     * @param pivot The grouping and aggregates; receives the result.
+     */
+    void pivotToRange(int row, int col, PivotTable& pivot);
+
+    /**
+     * @brief Gets the value sorting and filtering see for a cell.
+     *
+     * @param row The row of the data (0-based).
+     * @param col The column (0-based).
+     * @return The computed value if current, otherwise the content of the cell.
+     */
+    std::string getDisplayedValue(int row, int col) const;
+
+    /**
+     * @brief Checks whether the rows are sorted or filtered.
+     */
+    bool hasView() const { return view.isActive(); }
+
+    /**
+     * @brief Gets the number of rows shown, which is less than getRows() while a filter hides rows.
+     */
+    int getVisibleRows() const { return view.isActive() ? view.size() : rows; }
+
+    /**
+     * @brief Maps a row on screen to the row of the data it shows.
+     *
+     * @param viewRow The row on screen (0-based).
+     * @return The row of the data (0-based).
+     */
+    int getSourceRow(int viewRow) const { return view.sourceRow(viewRow); }
+
+    /**
+     * @brief Finds the row on screen showing a row of the data.
+     *
+     * @param sourceRow The row of the data (0-based).
+     * @return The row on screen, or -1 if the row is filtered out.
+     */
+    int getViewRow(int sourceRow) const { return view.viewRowOf(sourceRow); }
+
+    /**
+     * @brief Sets the file that edits are autosaved to in the background.
+     *
+     * @param path The autosave file; an empty path disables autosaving.
+     */
+    void setAutosavePath(const std::string& path);
+
+    /**
+     * @brief Recalculates the current data and waits for the values to be published.
+     */
+    void recalculate();
+
+    /**
+     * @brief Chooses between recalculating every cell in the background and evaluating cells as they are shown.
+     *
+     * With lazy evaluation display() evaluates the cells on screen, and the cells
+     * they reference, on the calling thread and keeps their values; formulas that
+     * are never shown, sorted or filtered by are never evaluated. recalculate()
+     * and profile() still evaluate everything.
+     *
+     * @param enabled True to evaluate on demand, false to recalculate in the background.
+     */
+    void setLazyEvaluation(bool enabled);
+
+    /**
+     * @brief Checks whether cells are evaluated as they are shown, see setLazyEvaluation().
+     */
+    bool isLazyEvaluation() const { return lazy != nullptr; }
+
+    /**
+     * @brief Checks whether values newer than the ones last displayed are available.
+     *
+     * @return True if display() should be called again to show fresh values.
+     */
+    bool hasNewValues() const;
+
+    /**
+     * @brief Checks whether a background recalculation is scheduled or running.
+     *
+     * @return True while the displayed values may be stale.
+     */
+    bool isRecalculating() const;
+
+    /**
+     * @brief Recalculates every cell of the spreadsheet while recording per-cell costs.
+     *
+     * @param profiler The profiler receiving the measurements; it is reset first.
+     */
+    void profile(EvaluationProfiler& profiler);
+
     /**
      * @brief Determines the content type of a given string.
      * 
@@ -107,7 +343,7 @@ public:
     void setWindowSize(int size) { windowSize = size; }
 
     /**
-     * @brief Creates a new spreadsheet with the specified dimensions.
+     * @brief Creates a new spreadsheet with the specified dimensions, dropping every other sheet.
      * 
      * @param newRows The number of rows for the new spreadsheet.
      * @param newCols The number of columns for the new spreadsheet.
@@ -115,9 +351,14 @@ public:
     void createNew(int newRows, int newCols);
 
     /**
-     * @brief Manages the cell data for the spreadsheet.
+     * @brief Holds the sheets formulas can reference by name, such as "=Sales!B2"; the first one is data.
      */
-    CellMatrix data;
+    Workbook workbook;
+
+    /**
+     * @brief Manages the cell data for the spreadsheet: the first sheet of the workbook, shown and edited.
+     */
+    CellMatrix& data;
 
 private:
     int rows; ///< Number of rows in the spreadsheet.
@@ -125,6 +366,30 @@ private:
     std::string firsHeader; ///< The first header of the spreadsheet.
     std::string secondHeader; ///< The second header of the spreadsheet.
     int windowSize; ///< The size of the visible window in the spreadsheet.
+    BackgroundRecalculator recalculator; ///< Evaluates the data on a worker thread.
+    std::shared_ptr<const ValueSnapshot> shownSnapshot; ///< Values used by the last display() call.
+    EditJournal journal; ///< Cell edits that can be undone and redone.
+    AutoSaver autosaver; ///< Writes snapshots of the edited data on a worker thread.
+    std::uint64_t journalVersion = 0; ///< Data version after the last journaled edit.
+    RowView view; ///< Order and selection of the rows on screen.
+    std::unique_ptr<LazyEvaluator> lazy; ///< Evaluates shown cells on demand; nullptr to recalculate in the background.
+
+    /**
+     * @brief Forgets the journal and the row view if the data was replaced behind their back (loaded, created, resized).
+     */
+    void syncJournal();
+
+    /**
+     * @brief Completes a bulk edit: forgets the undo history, keeps the row view and schedules an autosave.
+     */
+    void finishBulkEdit();
+
+    /**
+     * @brief Gets the value shown for a cell: its computed value if current, otherwise its content.
+     *
+     * With lazy evaluation the value is computed if needed and values is ignored.
+     */
+    const std::string& displayedText(const ValueSnapshot* values, int row, int col) const;
 };
 
 #endif // SPREADSHEET_H
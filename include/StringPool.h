@@ -0,0 +1,98 @@
+/**
+ * @file StringPool.h
+ * @brief Declaration of the StringPool class interning the cell texts of a sheet.
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include "NumberFormat.h"
+
+/**
+ * @class StringPool
+ * @brief Append-only arena of distinct cell texts.
+ *
+ * Every distinct text is stored once; cells hold pointers to it, so repeated
+ * labels such as category names share one copy. Texts are never moved or
+ * freed while the pool lives, so other threads can read them without locking.
+ * Interning itself is serialized by a mutex.
+ *
+ * Each text is classified as a number once, when it is first interned; the
+ * result is found from the text's address with numberOf(). Whether it may
+ * reference a cell is recorded the same way, see mayReference().
+ */
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    /**
+     * @brief Gets the pooled copy of a text, adding it on first use.
+     * @param text The text to intern.
+     * @return A pointer that stays valid as long as the pool.
+     */
+    const std::string* intern(const std::string& text);
+
+    /**
+     * @brief Gets the empty text shared by every pool.
+     */
+    static const std::string* empty() {
+        static const PooledText text{};
+        return &text.text;
+    }
+
+    /**
+     * @brief Gets the number classification stored with a pooled text.
+     * @param pooled A text returned by intern() or empty().
+     */
+    static const TextNumber& numberOf(const std::string* pooled) {
+        return reinterpret_cast<const PooledText*>(pooled)->number;
+    }
+
+    /**
+     * @brief Checks whether a pooled text may reference a cell: it has a capital letter followed by a digit.
+     *
+     * Texts without one, such as numbers and most labels, never need their references rewritten.
+     *
+     * @param pooled A text returned by intern() or empty().
+     */
+    static bool mayReference(const std::string* pooled) {
+        return reinterpret_cast<const PooledText*>(pooled)->reference;
+    }
+
+    /**
+     * @brief Gets the number of distinct texts in the pool.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Gets the bytes held by the pool: string objects, text buffers and the index.
+     */
+    std::size_t getMemoryUsage() const;
+
+private:
+    /**
+     * @brief A distinct text and its classification; the text comes first so its address is the entry's.
+     */
+    struct PooledText {
+        std::string text;
+        TextNumber number;
+        bool reference; ///< See mayReference().
+    };
+    static_assert(std::is_standard_layout<PooledText>::value, "numberOf() casts a text back to its entry");
+
+    mutable std::mutex mutex;                                   ///< Guards every member below.
+    std::deque<PooledText> texts;                               ///< Stable storage of the distinct texts.
+    std::unordered_map<std::string_view, const std::string*> index; ///< Looks texts up by content.
+    std::size_t heapBytes = 0;                                  ///< Text bytes stored outside the string objects.
+};
+
+#endif // STRING_POOL_H
@@ -0,0 +1,86 @@
+/**
+ * @file ThreadPool.h
+ * @brief Declaration of the ThreadPool class used for parallel recalculation.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads executing parallel loops.
+ *
+ * parallelFor splits an index range into chunks that the workers and the
+ * calling thread claim from a shared atomic counter, so faster threads simply
+ * take more chunks. Only one loop runs at a time; the call returns when every
+ * chunk is done. A chunk that throws does not stop the others; the first
+ * exception is rethrown to the caller once the loop is over.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the worker threads.
+     * @param threadCount Total number of threads taking part in a loop, including
+     *        the caller; 0 uses the number of hardware threads.
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    /**
+     * @brief Stops and joins the worker threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Gets the number of threads taking part in a loop.
+     * @return The number of worker threads plus the calling thread.
+     */
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /**
+     * @brief Runs body over [0, count) in chunks of at most grain indices.
+     * @param count Number of indices to process.
+     * @param body Called as body(begin, end) for each chunk; must be safe to run concurrently.
+     * @param grain Maximum number of indices per chunk.
+     * @throws Rethrows the first exception thrown by body, after every chunk has run.
+     */
+    void parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body,
+                     std::size_t grain = 256);
+
+private:
+    /**
+     * @brief Worker thread loop: waits for a loop and helps executing it.
+     */
+    void run();
+
+    /**
+     * @brief Claims and executes chunks of the current loop until none are left.
+     */
+    void executeChunks();
+
+    std::vector<std::thread> workers;   ///< Worker threads (the caller is the extra thread).
+    std::mutex mutex;                   ///< Guards the job description and the counters below.
+    std::condition_variable jobReady;   ///< Wakes workers for a new loop or shutdown.
+    std::condition_variable jobDone;    ///< Wakes the caller when the workers have finished.
+    const std::function<void(std::size_t, std::size_t)>* job; ///< Body of the current loop.
+    std::size_t jobCount;               ///< Number of indices of the current loop.
+    std::size_t jobGrain;               ///< Chunk size of the current loop.
+    std::atomic<std::size_t> nextIndex; ///< First index of the next unclaimed chunk.
+    std::exception_ptr failure;         ///< First exception thrown by a chunk of the current loop.
+    unsigned long long generation;      ///< Incremented for every loop so workers join each once.
+    unsigned busyWorkers;               ///< Workers still executing the current loop.
+    bool stopping;                      ///< Set when the workers must exit.
+};
+
+#endif // THREAD_POOL_H
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
 #include <regex>
 
 /**
@@ -13,7 +14,7 @@
  */
 enum class RegexType {
     TokenPattern,        ///< General pattern for token extraction.
-    MatrixReference,     ///< Pattern for matrix references (e.g., A1, B10).
+    MatrixReference,     ///< Pattern for matrix references (e.g., A1, B10, Sheet2!A1).
     Formula,             ///< Pattern for formulas (e.g., SUM(A1..A10)).
     DecimalNumber,       ///< Pattern for numbers starting with a decimal point (e.g., .123).
     GeneralNumber,       ///< Pattern for general numbers (e.g., 123, 1.23E4).
@@ -58,6 +59,21 @@ public:
      */
     std::vector<Token> tokenize(const std::string& str) const;
 
+    /**
+     * @brief Splits a given input string into tokens and reports where each one starts.
+     * @param str The input string to be tokenized.
+     * @param positions Receives the offset in str of every token; a merged label starts at its first part.
+     * @return A vector of tokens representing parts of the input string.
+     */
+    std::vector<Token> tokenize(const std::string& str, std::vector<std::size_t>& positions) const;
+
+    /**
+     * @brief Creates a Tokenizer configured with the spreadsheet grammar
+     *        (arithmetic operators, parentheses, range functions and cell references).
+     * @return A Tokenizer ready to split cell contents.
+     */
+    static Tokenizer createDefault();
+
 private:
     std::unordered_set<std::string> operators; ///< Set of valid operators for tokenization.
     std::unordered_set<std::string> formulaLabels; ///< Set of valid formula labels for tokenization.
@@ -0,0 +1,64 @@
+/**
+ * @file ValueSnapshot.h
+ * @brief Declaration of the ValueSnapshot struct holding published display values.
+ */
+
+#ifndef VALUE_SNAPSHOT_H
+#define VALUE_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Immutable set of computed cell values for one version of a workbook.
+ *
+ * Values are stored in fixed-size blocks shared between consecutive snapshots;
+ * an incremental recalculation copies only the blocks containing changed cells.
+ */
+struct ValueSnapshot {
+    static const std::size_t blockSize = 4096; ///< Number of cells per block.
+
+    /**
+     * @brief Computed values of one sheet.
+     */
+    struct Sheet {
+        int rows = 0;                 ///< Number of rows covered by the snapshot.
+        int cols = 0;                 ///< Number of columns covered by the snapshot.
+        std::vector<std::shared_ptr<const std::vector<std::string>>> blocks; ///< Display values, row-major.
+    };
+
+    std::uint64_t version = 0;        ///< Workbook version the values were computed from.
+    std::vector<Sheet> sheets;        ///< Values of every sheet, in workbook order.
+
+    /**
+     * @brief Gets the computed value of a cell of a sheet.
+     * @param sheet The index of the sheet in the workbook.
+     * @param row The row index of the cell (0-based).
+     * @param col The column index of the cell (0-based).
+     * @return A pointer to the value, or nullptr if the cell is outside the snapshot.
+     */
+    const std::string* valueAt(int sheet, int row, int col) const {
+        if (sheet < 0 || sheet >= static_cast<int>(sheets.size())) {
+            return nullptr;
+        }
+        const Sheet& values = sheets[sheet];
+        if (row < 0 || row >= values.rows || col < 0 || col >= values.cols) {
+            return nullptr;
+        }
+        std::size_t cell = static_cast<std::size_t>(row) * values.cols + col;
+        return &(*values.blocks[cell / blockSize])[cell % blockSize];
+    }
+
+    /**
+     * @brief Gets the computed value of a cell of the first sheet.
+     * @param row The row index of the cell (0-based).
+     * @param col The column index of the cell (0-based).
+     * @return A pointer to the value, or nullptr if the cell is outside the snapshot.
+     */
+    const std::string* valueAt(int row, int col) const { return valueAt(0, row, col); }
+};
+
+#endif // VALUE_SNAPSHOT_H
@@ -0,0 +1,170 @@
+/**
+ * @file Workbook.h
+ * @brief Declaration of the Workbook class holding the named sheets formulas can reference.
+ */
+
+#ifndef WORKBOOK_H
+#define WORKBOOK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CellMatrix.h"
+
+/**
+ * @class Workbook
+ * @brief Ordered set of named CellMatrix sheets.
+ *
+ * A formula of any sheet reads another sheet by naming it, as in "=Sheet2!A1"
+ * or "=SUM(Sheet2!A1..A9)"; references without a name read their own sheet.
+ * The first sheet, "Sheet1", always exists, and the address of every sheet
+ * stays the same while it is in the workbook.
+ *
+ * Sheets are edited directly, so the version of the workbook is derived from
+ * the versions of its sheets and grows whenever any of them changes or a
+ * sheet is added or removed.
+ *
+ * Inserting or deleting rows and columns moves the cells of one sheet and
+ * rewrites the references to them in every sheet, so formulas keep reading
+ * the same cells.
+ */
+class Workbook {
+public:
+    /**
+     * @brief Creates a workbook with an empty first sheet.
+     */
+    Workbook();
+
+    /**
+     * @brief Creates a workbook whose first sheet shares the blocks of a matrix.
+     * @param first The content of the first sheet; a snapshot of it is taken.
+     */
+    explicit Workbook(const CellMatrix& first);
+
+    Workbook(Workbook&&) = default;
+    Workbook& operator=(Workbook&&) = default;
+    Workbook(const Workbook&) = delete;
+    Workbook& operator=(const Workbook&) = delete;
+
+    /**
+     * @brief Takes an immutable copy of every sheet in time proportional to the number of blocks.
+     * @return A workbook with the same names, cells and versions.
+     */
+    Workbook snapshot() const;
+
+    /**
+     * @brief Gets the number of sheets, at least one.
+     */
+    int getSheetCount() const { return static_cast<int>(sheets.size()); }
+
+    /**
+     * @brief Gets the name of a sheet.
+     * @param index The index of the sheet (0-based).
+     */
+    const std::string& getSheetName(int index) const { return names[index]; }
+
+    /**
+     * @brief Gets a sheet for reading.
+     * @param index The index of the sheet (0-based).
+     */
+    const CellMatrix& getSheet(int index) const { return *sheets[index]; }
+
+    /**
+     * @brief Gets a sheet for editing.
+     * @param index The index of the sheet (0-based).
+     */
+    CellMatrix& getSheet(int index) { return *sheets[index]; }
+
+    /**
+     * @brief Finds a sheet by name.
+     * @param name The name, compared case-sensitively.
+     * @return The index of the sheet, or -1 if there is none of that name.
+     */
+    int findSheet(const std::string& name) const;
+
+    /**
+     * @brief Appends an empty sheet.
+     * @param name The name of the new sheet, see isValidSheetName.
+     * @return The index of the new sheet, or -1 if the name is invalid or already used.
+     */
+    int addSheet(const std::string& name);
+
+    /**
+     * @brief Removes a sheet; the sheets after it move down by one index.
+     * @param index The index of the sheet, which cannot be the first one.
+     * @return False if there is no such sheet or it is the first one.
+     */
+    bool removeSheet(int index);
+
+    /**
+     * @brief Inserts empty rows into a sheet and moves the references to the rows below them.
+     *
+     * A range spanning the insertion grows. Only the cells whose text may hold
+     * a reference are rewritten, see CellMatrix::rewriteReferences.
+     *
+     * @param sheet The index of the sheet.
+     * @param row The first inserted row (1-based index), as in CellMatrix::insertRows.
+     * @param count The number of rows to insert.
+     */
+    void insertRows(int sheet, int row, int count);
+
+    /**
+     * @brief Deletes rows of a sheet and moves the references to the rows below them.
+     *
+     * A range losing some of its rows shrinks; a reference or range losing
+     * all of them becomes "#REF".
+     *
+     * @param sheet The index of the sheet.
+     * @param row The first deleted row (1-based index).
+     * @param count The number of rows to delete.
+     */
+    void deleteRows(int sheet, int row, int count);
+
+    /**
+     * @brief Inserts empty columns into a sheet and moves the references to the columns right of them.
+     * @param sheet The index of the sheet.
+     * @param col The first inserted column (1-based index).
+     * @param count The number of columns to insert.
+     */
+    void insertColumns(int sheet, int col, int count);
+
+    /**
+     * @brief Deletes columns of a sheet and moves the references to the columns right of them.
+     * @param sheet The index of the sheet.
+     * @param col The first deleted column (1-based index).
+     * @param count The number of columns to delete.
+     */
+    void deleteColumns(int sheet, int col, int count);
+
+    /**
+     * @brief Gets a number that grows on every change to any sheet or to the set of sheets.
+     */
+    std::uint64_t getVersion() const;
+
+    /**
+     * @brief Checks whether a text can name a sheet in a reference.
+     *
+     * A name is a letter or '_' followed by letters, digits and '_', so
+     * "Sales_2024" is valid while "2024" and "My Sheet" are not.
+     *
+     * @param name The candidate name.
+     */
+    static bool isValidSheetName(const std::string& name);
+
+private:
+    std::vector<std::string> names;                   ///< Name of every sheet.
+    std::vector<std::unique_ptr<CellMatrix>> sheets;  ///< Every sheet, at a stable address.
+    std::uint64_t structureVersion = 0;               ///< Added to the sheet versions when sheets are added or removed.
+
+    /**
+     * @brief Rewrites the references of every sheet to the rows or columns of a sheet that moved.
+     * @param sheet The index of the edited sheet.
+     * @param byRow True if rows moved, false if columns did.
+     * @param at The first inserted or deleted row or column (0-based).
+     * @param count The number inserted, or minus the number deleted.
+     */
+    void moveReferences(int sheet, bool byRow, int at, int count);
+};
+
+#endif // WORKBOOK_H
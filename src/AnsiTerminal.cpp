@@ -1,6 +1,7 @@
 #include "AnsiTerminal.h"
 #include <iostream>
 #include <unistd.h>   // For read()
+#include <poll.h>     // For poll()
 
 // Constructor: Configure terminal for non-canonical mode
 AnsiTerminal::AnsiTerminal() {
@@ -83,3 +84,9 @@ char AnsiTerminal::getSpecialKey() {
     // If it's a normal character or Ctrl combination, return as-is
     return ch;
 }
+
+// Method to wait for a keystroke without consuming it
+bool AnsiTerminal::waitForInput(int timeoutMs) {
+    struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+    return poll(&input, 1, timeoutMs) > 0;
+}
@@ -0,0 +1,91 @@
+#include "AutoSaver.h"
+
+#include <chrono>
+
+/**
+ * @brief Starts the worker thread.
+ */
+AutoSaver::AutoSaver(int intervalMs)
+    : intervalMs(intervalMs), savedVersion(0), hasSaved(false), saving(false), stopping(false) {
+    worker = std::thread(&AutoSaver::run, this);
+}
+
+/**
+ * @brief Stops the worker thread.
+ */
+AutoSaver::~AutoSaver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorker.notify_all();
+    worker.join();
+}
+
+void AutoSaver::setPath(const std::string& newPath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (newPath != path) {
+        path = newPath;
+        hasSaved = false; // the new file has not been written yet
+    }
+}
+
+/**
+ * @brief Keeps a constant-time snapshot of the data for the worker.
+ */
+void AutoSaver::update(const CellMatrix& data) {
+    std::unique_ptr<CellMatrix> snapshot(new CellMatrix(data.snapshot()));
+    std::lock_guard<std::mutex> lock(mutex);
+    pending = std::move(snapshot);
+}
+
+bool AutoSaver::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    saved.wait(lock, [this]() { return !saving; });
+    return saveLocked(lock);
+}
+
+std::uint64_t AutoSaver::getSavedVersion() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return savedVersion;
+}
+
+/**
+ * @brief Worker thread loop: wakes once per interval and writes the newest snapshot.
+ */
+void AutoSaver::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wakeWorker.wait_for(lock, std::chrono::milliseconds(intervalMs), [this]() { return stopping; });
+        if (stopping) {
+            return;
+        }
+        if (!saving) {
+            saveLocked(lock);
+        }
+    }
+}
+
+/**
+ * @brief Serializes the pending snapshot outside the lock so editing is never blocked.
+ */
+bool AutoSaver::saveLocked(std::unique_lock<std::mutex>& lock) {
+    if (!pending || path.empty() || (hasSaved && pending->getVersion() == savedVersion)) {
+        return true; // nothing new to write
+    }
+    CellMatrix snapshot = pending->snapshot();
+    std::string target = path;
+    saving = true;
+
+    lock.unlock();
+    bool ok = snapshot.saveToFile(target);
+    lock.lock();
+
+    saving = false;
+    if (ok && target == path) {
+        savedVersion = snapshot.getVersion();
+        hasSaved = true;
+    }
+    saved.notify_all();
+    return ok;
+}
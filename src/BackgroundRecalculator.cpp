@@ -0,0 +1,95 @@
+#include "BackgroundRecalculator.h"
+
+/**
+ * @brief Starts the worker thread.
+ */
+BackgroundRecalculator::BackgroundRecalculator(unsigned threadCount)
+    : engine(threadCount), requestedVersion(0), hasRequest(false), newestVersion(0), stopping(false) {
+    worker = std::thread(&BackgroundRecalculator::run, this);
+}
+
+/**
+ * @brief Stops the worker thread.
+ */
+BackgroundRecalculator::~BackgroundRecalculator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorker.notify_all();
+    worker.join();
+}
+
+/**
+ * @brief Schedules a recalculation of a copy of the sheets.
+ */
+void BackgroundRecalculator::request(const Workbook& book) {
+    std::uint64_t version = book.getVersion();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (hasRequest && requestedVersion == version) {
+            return; // Already scheduled, running or published
+        }
+        pending.reset(new Workbook(book.snapshot())); // shares the blocks of every sheet
+        requestedVersion = version;
+        hasRequest = true;
+        newestVersion = version;
+    }
+    wakeWorker.notify_one();
+}
+
+std::shared_ptr<const ValueSnapshot> BackgroundRecalculator::latest() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return published;
+}
+
+bool BackgroundRecalculator::isCalculating() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hasRequest && (!published || published->version != requestedVersion);
+}
+
+void BackgroundRecalculator::waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() {
+        return !hasRequest || (published && published->version == requestedVersion);
+    });
+}
+
+/**
+ * @brief Worker thread loop: takes the latest pending data and evaluates it.
+ */
+void BackgroundRecalculator::run() {
+    for (;;) {
+        std::unique_ptr<Workbook> book;
+        std::uint64_t version;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorker.wait(lock, [this]() { return stopping || pending; });
+            if (stopping) {
+                return;
+            }
+            book = std::move(pending);
+            version = requestedVersion;
+        }
+
+        std::shared_ptr<const ValueSnapshot> snapshot = evaluate(*book, version);
+        if (!snapshot) {
+            continue; // A newer request superseded this one
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            published = snapshot;
+        }
+        idle.notify_all();
+    }
+}
+
+/**
+ * @brief Evaluates every cell in parallel, abandoning the work once a newer request arrives.
+ */
+std::shared_ptr<const ValueSnapshot> BackgroundRecalculator::evaluate(const Workbook& book, std::uint64_t version) {
+    return engine.recalculate(book, [this, version]() {
+        return stopping || newestVersion != version;
+    });
+}
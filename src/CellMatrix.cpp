@@ -3,35 +3,120 @@
  */
 
 #include "CellMatrix.h"
+#include <cstdio>
+#include <cstdlib>
 #include <exception>
+#include <iterator>
+#include <set>
+#include <unordered_map>
+
+namespace {
+
+/**
+ * @brief Gets the size of a file in bytes, or -1 if it cannot be opened.
+ */
+long long fileSize(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast<long long>(file.tellg()) : -1;
+}
+
+/**
+ * @brief Applies the committed edits of a CSV's change log to its freshly parsed rows.
+ *
+ * The log starts with "@<size of the CSV>" followed by blocks of "<row>,<col>,<value>"
+ * lines (1-based), each closed by "=<number of lines>". A log written against another
+ * version of the CSV, or a block cut short by a crash, is ignored.
+ */
+void applyChangeFile(const std::string& filename, std::vector<std::vector<std::string>>& rows, std::size_t& maxCols) {
+    std::ifstream log(CellMatrix::getChangeFileName(filename), std::ios::binary);
+    if (!log.is_open()) {
+        return;
+    }
+    std::string line;
+    if (!std::getline(log, line) || line.empty() || line[0] != '@' ||
+        line.substr(1) != std::to_string(fileSize(filename))) {
+        std::cerr << "Warning: Ignoring change log that does not match " << filename << "\n";
+        return;
+    }
+
+    struct Edit {
+        std::size_t row;
+        std::size_t col;
+        std::string value;
+    };
+    std::vector<Edit> block;
+    while (std::getline(log, line)) {
+        if (!line.empty() && line[0] == '=') {
+            if (line.substr(1) != std::to_string(block.size())) {
+                break; // damaged block
+            }
+            for (const Edit& edit : block) {
+                if (rows.size() < edit.row) {
+                    rows.resize(edit.row, std::vector<std::string>(std::max<std::size_t>(maxCols, 1), ""));
+                }
+                std::vector<std::string>& row = rows[edit.row - 1];
+                if (row.size() < edit.col) {
+                    row.resize(edit.col, "");
+                }
+                row[edit.col - 1] = edit.value;
+                maxCols = std::max(maxCols, row.size());
+            }
+            block.clear();
+            continue;
+        }
+
+        std::size_t first = line.find(',');
+        std::size_t second = first == std::string::npos ? first : line.find(',', first + 1);
+        if (second == std::string::npos) {
+            break; // incomplete record written by an interrupted save
+        }
+        Edit edit;
+        edit.row = std::strtoul(line.c_str(), nullptr, 10);
+        edit.col = std::strtoul(line.c_str() + first + 1, nullptr, 10);
+        edit.value = line.substr(second + 1);
+        if (edit.row == 0 || edit.col == 0) {
+            break;
+        }
+        block.push_back(edit);
+    }
+}
+
+} // namespace
 /**
  * @brief Constructs a CellMatrix with the specified number of rows and columns.
  * @param rows Initial number of rows.
  * @param cols Initial number of columns.
  */
 CellMatrix::CellMatrix(int rows, int cols)
-    : rows(rows), cols(cols), data(rows, std::vector<std::string>(cols, "")),
-    lastRow(-1), lastCol(-1) {
+    : rows(rows), cols(cols), blocks(std::make_shared<BlockTable>()), strings(std::make_shared<StringPool>()), storedRows(0),
+    layout(CellLayout::RowMajor), lookups(std::make_shared<LookupCache>()),
+    lastRow(-1), lastCol(-1), version(0), changeLog(std::make_shared<std::vector<CellChange>>()), changeLogStart(0) {
     if (rows > MAXROWSIZE || cols > MAXCOLUMNSIZE) {
         throw std::out_of_range("Initial size exceeds maximum allowed dimensions.");
     }
+    setStoredRows(rows, Row(cols, StringPool::empty()));
 }
 void CellMatrix::resizeIfNeeded(int newRow, int newCol) {
 
 
 
     // Resize rows if necessary
-    if (newRow >= data.size()) {
+    if (newRow >= storedRows) {
         // Yeni satırların, boş vektör olarak eklenmesini sağlıyoruz.
-        data.resize(newRow + 1, std::vector<std::string>{});
+        setStoredRows(newRow + 1, Row{});
         rows = newRow;
     }
     // Resize columns if necessary
 
-    for (auto& row : data) {
-        if (newCol >= row.size()) {
-            row.resize(newCol + 1, " ");
-            cols = newCol;
+    for (int r = 0; r < storedRows; ++r) {
+        const BlockEntry& entry = (*blocks)[r / ROWSPERBLOCK];
+        if (!entry.resident.load(std::memory_order_acquire) && entry.minWidth > newCol) {
+            r += ROWSPERBLOCK - 1; // a spilled block wide enough is not read back
+            continue;
+        }
+        if (newCol >= static_cast<int>(findRow(r)->size())) {
+            writableRow(r).resize(newCol + 1, strings->intern(" "));
+            cols = std::max(cols, newCol); // rows added below narrower than the sheet must not shrink it
 
         }
     }
@@ -45,18 +130,18 @@ void CellMatrix::resizeIfNeeded(int newRow, int newCol) {
  *         or a reference to a static empty string if out of bounds.
  */
 const std::string& CellMatrix::operator()(int row, int col) const {
-    static const std::string empty = ""; // Static empty string for invalid access
+    const std::string& empty = *StringPool::empty(); // pooled, so getNumber() works for invalid access too
 
     // Validate row and column indices
     if (row < 0 || row >= rows || col < 0 || col >= cols) {
         return empty;
     }
 
-    try {
-        return data.at(row ).at(col); // Use 0-based indexing with bounds checking
-    } catch (const std::out_of_range& e) {
-            return empty; // Return empty string in case of any error
-    } 
+    const Row* cells = findRow(row);
+    if (!cells || col >= static_cast<int>(cells->size())) {
+        return empty; // Rows loaded from a file may be shorter than the widest one
+    }
+    return *(*cells)[col];
 }
 
 /**
@@ -68,16 +153,12 @@ const std::string& CellMatrix::operator()(int row, int col) const {
  */
 const std::string CellMatrix::getValue(int row, int col) const 
 {
-    try
-    {
-        if (row >= 1 && row <= rows && col >= 1 && col <= cols) {
-            return data.at(row - 1).at(col - 1); // Retrieve value using 0-based indexing
+    if (row >= 1 && row <= rows && col >= 1 && col <= cols) {
+        const Row* cells = findRow(row - 1);
+        if (cells && col <= static_cast<int>(cells->size())) {
+            return *(*cells)[col - 1]; // Retrieve value using 0-based indexing
         }
     }
-    catch(const std::exception& e)
-    {
-             return " ";
-    }
 
     return " ";
 }
@@ -87,16 +168,389 @@ const std::string CellMatrix::getValue(int row, int col) const
  */
 void CellMatrix::setValue(int row, int col, const std::string& value) {
     if (row >= 1 && col >= 1) { // Ensure valid 1-based indexing
+        int oldRows = rows;
+        int oldCols = cols;
         resizeIfNeeded(row, col); // Resize if necessary
 
+        writeCell(writableRow(row - 1), row - 1, col - 1, value);
+        std::vector<std::pair<int, int>> changed = { { row - 1, col - 1 } };
+        commitCells(changed, oldRows, oldCols);
+    }
+}
+
+/**
+ * @brief Resizes once for the whole block, then writes it row by row.
+ */
+void CellMatrix::setBlock(int row, int col, const std::vector<std::vector<std::string>>& values) {
+    std::size_t width = 0;
+    for (const auto& cells : values) {
+        width = std::max(width, cells.size());
+    }
+    if (row < 1 || col < 1 || width == 0) {
+        return;
+    }
+    int oldRows = rows;
+    int oldCols = cols;
+    resizeIfNeeded(row + static_cast<int>(values.size()) - 1, col + static_cast<int>(width) - 1);
+
+    std::vector<std::pair<int, int>> changed;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (values[i].empty()) {
+            continue;
+        }
+        Row& cells = writableRow(row - 1 + static_cast<int>(i));
+        for (std::size_t j = 0; j < values[i].size(); ++j) {
+            writeCell(cells, row - 1 + static_cast<int>(i), col - 1 + static_cast<int>(j), values[i][j]);
+            changed.emplace_back(row - 1 + static_cast<int>(i), col - 1 + static_cast<int>(j));
+        }
+    }
+    commitCells(changed, oldRows, oldCols);
+}
+
+/**
+ * @brief Empties the stored cells of the rectangle that hold more than spaces; the size does not change.
+ */
+void CellMatrix::clearRange(int firstRow, int firstCol, int lastRow, int lastCol) {
+    firstRow = std::max(firstRow, 1);
+    firstCol = std::max(firstCol, 1);
+    lastRow = std::min(lastRow, std::min(rows, storedRows));
+    lastCol = std::min(lastCol, cols);
+    std::vector<std::pair<int, int>> changed;
+    for (int r = firstRow - 1; r < lastRow; ++r) {
+        const Row* cells = findRow(r);
+        int end = std::min(lastCol, static_cast<int>(cells->size()));
+        for (int c = firstCol - 1; c < end; ++c) {
+            if ((*cells)[c]->find_first_not_of(' ') != std::string::npos) {
+                changed.emplace_back(r, c); // padding of " " is already blank
+            }
+        }
+    }
+    if (changed.empty()) {
+        return;
+    }
+    Row* cells = nullptr;
+    for (std::size_t i = 0; i < changed.size(); ++i) {
+        if (i == 0 || changed[i].first != changed[i - 1].first) {
+            cells = &writableRow(changed[i].first);
+        }
+        writeCell(*cells, changed[i].first, changed[i].second, std::string());
+    }
+    commitCells(changed, rows, cols);
+}
+
+void CellMatrix::writeCell(Row& cells, int row, int col, const std::string& value) {
+    const std::string* text;
+    if (value.find('\n') == std::string::npos) {
+        text = strings->intern(value);
+    } else {
         // Remove newline characters from the input value
         std::string filteredValue = value;
         filteredValue.erase(std::remove(filteredValue.begin(), filteredValue.end(), '\n'), filteredValue.end());
+        text = strings->intern(filteredValue);
+    }
+    if (referenceCells.built && StringPool::mayReference(cells[col]) != StringPool::mayReference(text)) {
+        if (StringPool::mayReference(text)) {
+            referenceCells.add(row, col);
+        } else {
+            referenceCells.remove(row, col);
+        }
+    }
+    cells[col] = text;
+    if (columns) {
+        writableColumn(col).set(row, StringPool::numberOf(text));
+    }
+}
+
+/**
+ * @brief Invalidates the lookups, versions and logs the written cells once for the whole edit.
+ */
+void CellMatrix::commitCells(const std::vector<std::pair<int, int>>& changed, int oldRows, int oldCols) {
+    bool reshaped = rows != oldRows || cols != oldCols;
+    if (reshaped) {
+        lookups = std::make_shared<LookupCache>(); // padding changed other columns too
+    } else {
+        std::vector<char> edited(static_cast<std::size_t>(std::max(cols, 0)) + 1, 0);
+        for (const auto& cell : changed) {
+            if (!edited[cell.second]) {
+                edited[cell.second] = 1;
+                invalidateLookup(cell.second);
+            }
+        }
+    }
+    ++version;
+
+    // Every keystroke interns a new text; drop the unused ones once they dominate
+    if (strings->size() > 2 * static_cast<std::size_t>(storedRows) * std::max(cols, 1) + 4096) {
+        compactStrings();
+    }
+
+    if (reshaped || changed.size() > MAXCHANGELOG / 2) {
+        resetChangeLog(); // the shape changed, or listing the cells would cost more than reprocessing
+    } else {
+        if (changeLog.use_count() > 1) {
+            changeLog = std::make_shared<std::vector<CellChange>>(*changeLog); // a snapshot keeps the old log
+        }
+        if (changeLog->size() + changed.size() > MAXCHANGELOG) {
+            // Forget the oldest half; callers behind it reprocess everything
+            changeLogStart = (*changeLog)[MAXCHANGELOG / 2 - 1].version;
+            changeLog->erase(changeLog->begin(), changeLog->begin() + MAXCHANGELOG / 2);
+        }
+        for (const auto& cell : changed) {
+            changeLog->push_back({ version, cell.first, cell.second });
+        }
+    }
+    enforceMemoryBudget();
+}
+/**
+ * @brief Inserts whole blocks when the rows are block aligned; otherwise moves the rows below down one by one.
+ */
+void CellMatrix::insertRows(int row, int count) {
+    int at = row - 1;
+    if (at < 0 || at >= rows || count <= 0) {
+        return;
+    }
+    if (at < storedRows) {
+        if (at % ROWSPERBLOCK == 0 && count % ROWSPERBLOCK == 0) {
+            BlockTable& table = writableTable();
+            auto first = table.insert(table.begin() + at / ROWSPERBLOCK, count / ROWSPERBLOCK, BlockEntry());
+            for (auto entry = first; entry != first + count / ROWSPERBLOCK; ++entry) {
+                entry->assign(std::make_shared<RowBlock>(ROWSPERBLOCK));
+            }
+            storedRows += count;
+        } else {
+            int oldStoredRows = storedRows;
+            setStoredRows(storedRows + count, Row{});
+            for (int r = oldStoredRows - 1; r >= at; --r) {
+                Row moved = std::move(writableRow(r));
+                writableRow(r + count) = std::move(moved);
+            }
+            for (int r = at; r < at + count; ++r) {
+                writableRow(r) = Row{};
+            }
+        }
+    }
+    rows += count;
+    if (referenceCells.built) {
+        referenceCells.moveRows(at, count);
+    }
+    if (columns) {
+        rebuildColumns(); // numeric columns are indexed by row
+    }
+    commitStructure();
+}
+
+/**
+ * @brief Erases whole blocks when the rows are block aligned; otherwise moves the rows below up one by one.
+ */
+void CellMatrix::deleteRows(int row, int count) {
+    int at = row - 1;
+    if (at < 0 || at >= rows || count <= 0) {
+        return;
+    }
+    count = std::min(count, rows - at);
+    if (at < storedRows) {
+        int removed = std::min(count, storedRows - at);
+        if (at % ROWSPERBLOCK == 0 && removed % ROWSPERBLOCK == 0) {
+            BlockTable& table = writableTable();
+            table.erase(table.begin() + at / ROWSPERBLOCK, table.begin() + (at + removed) / ROWSPERBLOCK);
+            storedRows -= removed;
+        } else {
+            for (int r = at; r + removed < storedRows; ++r) {
+                Row moved = std::move(writableRow(r + removed));
+                writableRow(r) = std::move(moved);
+            }
+            setStoredRows(storedRows - removed, Row{});
+        }
+    }
+    rows -= count;
+    if (referenceCells.built) {
+        referenceCells.deleteRows(at, count);
+    }
+    if (columns) {
+        rebuildColumns();
+    }
+    commitStructure();
+}
+
+/**
+ * @brief Only rows reaching the column are touched; spilled blocks narrower than it are not read back.
+ */
+void CellMatrix::insertColumns(int col, int count) {
+    int at = col - 1;
+    if (at < 0 || at >= cols || count <= 0) {
+        return;
+    }
+    for (int r = 0; r < storedRows; ++r) {
+        const BlockEntry& entry = (*blocks)[r / ROWSPERBLOCK];
+        if (!entry.resident.load(std::memory_order_acquire) && entry.maxWidth <= at) {
+            r += ROWSPERBLOCK - 1;
+            continue;
+        }
+        if (static_cast<int>(findRow(r)->size()) > at) {
+            Row& cells = writableRow(r);
+            cells.insert(cells.begin() + at, count, StringPool::empty());
+        }
+    }
+    cols += count;
+    if (referenceCells.built) {
+        referenceCells.moveColumns(at, count);
+    }
+    if (columns && static_cast<int>(columns->size()) > at) {
+        columns = std::make_shared<ColumnTable>(*columns); // the moved columns are shared, not copied
+        columns->insert(columns->begin() + at, count, nullptr);
+    }
+    commitStructure();
+}
+
+void CellMatrix::deleteColumns(int col, int count) {
+    int at = col - 1;
+    if (at < 0 || at >= cols || count <= 0) {
+        return;
+    }
+    count = std::min(count, cols - at);
+    for (int r = 0; r < storedRows; ++r) {
+        const BlockEntry& entry = (*blocks)[r / ROWSPERBLOCK];
+        if (!entry.resident.load(std::memory_order_acquire) && entry.maxWidth <= at) {
+            r += ROWSPERBLOCK - 1;
+            continue;
+        }
+        int width = static_cast<int>(findRow(r)->size());
+        if (width > at) {
+            Row& cells = writableRow(r);
+            cells.erase(cells.begin() + at, cells.begin() + std::min(width, at + count));
+        }
+    }
+    cols -= count;
+    if (referenceCells.built) {
+        referenceCells.deleteColumns(at, count);
+    }
+    if (columns && static_cast<int>(columns->size()) > at) {
+        columns = std::make_shared<ColumnTable>(*columns);
+        columns->erase(columns->begin() + at, columns->begin() + std::min(static_cast<int>(columns->size()), at + count));
+    }
+    commitStructure();
+}
+
+void CellMatrix::commitStructure() {
+    lookups = std::make_shared<LookupCache>();
+    ++version;
+    resetChangeLog(); // cells moved, so earlier positions no longer name them
+    enforceMemoryBudget();
+}
+
+/**
+ * @brief Collects the changed cells first, as writing them updates the tracked positions.
+ */
+std::size_t CellMatrix::rewriteReferences(const std::function<std::string(const std::string&)>& rewrite) {
+    if (!referenceCells.built) {
+        for (int r = 0; r < storedRows; ++r) {
+            const Row& cells = *findRow(r);
+            for (std::size_t c = 0; c < cells.size(); ++c) {
+                if (StringPool::mayReference(cells[c])) {
+                    referenceCells.add(r, static_cast<int>(c));
+                }
+            }
+        }
+        referenceCells.built = true;
+    }
+
+    std::unordered_map<const std::string*, std::string> rewritten;
+    std::vector<std::pair<int, int>> changed;
+    std::vector<std::string> texts;
+    for (const auto& tracked : referenceCells.rows) {
+        const Row& cells = *findRow(tracked.first);
+        for (int c : tracked.second) {
+            auto found = rewritten.find(cells[c]);
+            if (found == rewritten.end()) {
+                found = rewritten.emplace(cells[c], rewrite(*cells[c])).first;
+            }
+            if (found->second != *cells[c]) {
+                changed.emplace_back(tracked.first, c);
+                texts.push_back(found->second);
+            }
+        }
+    }
+    if (changed.empty()) {
+        return 0;
+    }
+
+    Row* cells = nullptr;
+    for (std::size_t i = 0; i < changed.size(); ++i) {
+        if (i == 0 || changed[i].first != changed[i - 1].first) {
+            cells = &writableRow(changed[i].first);
+        }
+        writeCell(*cells, changed[i].first, changed[i].second, texts[i]);
+    }
+    commitCells(changed, rows, cols);
+    return changed.size();
+}
+
+void CellMatrix::ReferenceCells::remove(int row, int col) {
+    auto found = rows.find(row);
+    if (found == rows.end()) {
+        return;
+    }
+    std::vector<int>& tracked = found->second;
+    auto position = std::find(tracked.begin(), tracked.end(), col);
+    if (position != tracked.end()) {
+        *position = tracked.back();
+        tracked.pop_back();
+    }
+    if (tracked.empty()) {
+        rows.erase(found);
+    }
+}
+
+/**
+ * @brief Adds count to every tracked row at or below row.
+ */
+void CellMatrix::ReferenceCells::moveRows(int row, int count) {
+    std::map<int, std::vector<int>> moved;
+    for (auto entry = rows.lower_bound(row); entry != rows.end(); ++entry) {
+        moved.emplace_hint(moved.end(), entry->first + count, std::move(entry->second));
+    }
+    rows.erase(rows.lower_bound(row), rows.end());
+    rows.insert(moved.begin(), moved.end());
+}
+
+/**
+ * @brief Forgets the rows [row, row + count) and moves the ones below up.
+ */
+void CellMatrix::ReferenceCells::deleteRows(int row, int count) {
+    rows.erase(rows.lower_bound(row), rows.lower_bound(row + count));
+    moveRows(row + count, -count);
+}
 
-        // Assign the filtered value to the cell
-        data[row - 1][col - 1] = filteredValue; // 0-based indexing internally
+/**
+ * @brief Adds count to every tracked column at or right of col.
+ */
+void CellMatrix::ReferenceCells::moveColumns(int col, int count) {
+    for (auto& entry : rows) {
+        for (int& tracked : entry.second) {
+            if (tracked >= col) {
+                tracked += count;
+            }
+        }
     }
 }
+
+/**
+ * @brief Forgets the columns [col, col + count) and moves the ones right of them left.
+ */
+void CellMatrix::ReferenceCells::deleteColumns(int col, int count) {
+    for (auto entry = rows.begin(); entry != rows.end();) {
+        std::vector<int>& tracked = entry->second;
+        tracked.erase(std::remove_if(tracked.begin(), tracked.end(), [&](int c) { return c >= col && c < col + count; }),
+                      tracked.end());
+        for (int& c : tracked) {
+            if (c >= col + count) {
+                c -= count;
+            }
+        }
+        entry = tracked.empty() ? rows.erase(entry) : std::next(entry);
+    }
+}
+
 /**
  * @brief Resizes the matrix to the specified dimensions.
  * @param newRows The new number of rows.
@@ -106,12 +560,486 @@ void CellMatrix::resize(int newRows, int newCols) {
     if (newRows > MAXROWSIZE || newCols > MAXCOLUMNSIZE) {
         throw std::out_of_range("Resize exceeds maximum allowed dimensions.");
     }
-    data.resize(newRows);
-    for (auto& row : data) {
-        row.resize(newCols, "");
+    setStoredRows(newRows, Row(newCols, StringPool::empty()));
+    for (int r = 0; r < storedRows; ++r) {
+        const BlockEntry& entry = (*blocks)[r / ROWSPERBLOCK];
+        if (!entry.resident.load(std::memory_order_acquire) && entry.minWidth == newCols && entry.maxWidth == newCols) {
+            r += ROWSPERBLOCK - 1; // a spilled block of the right width is not read back
+            continue;
+        }
+        if (static_cast<int>(findRow(r)->size()) != newCols) {
+            writableRow(r).resize(newCols, StringPool::empty());
+        }
     }
     rows = newRows;
     cols = newCols;
+    rebuildColumns();
+    lookups = std::make_shared<LookupCache>();
+    referenceCells.reset();
+    ++version;
+    resetChangeLog();
+    enforceMemoryBudget();
+}
+
+/**
+ * @brief Lists the cells modified after a given version.
+ */
+bool CellMatrix::changesSince(std::uint64_t sinceVersion, std::vector<std::pair<int, int>>& cells) const {
+    cells.clear();
+    if (sinceVersion < changeLogStart || sinceVersion > version) {
+        return false;
+    }
+    for (const auto& change : *changeLog) {
+        if (change.version > sinceVersion) {
+            cells.emplace_back(change.row, change.col);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Marks the whole content as replaced.
+ */
+void CellMatrix::resetChangeLog() {
+    changeLog = std::make_shared<std::vector<CellChange>>();
+    changeLogStart = version;
+}
+
+const CellMatrix::Row* CellMatrix::findRow(int row) const {
+    if (row < 0 || row >= storedRows) {
+        return nullptr;
+    }
+    const BlockEntry& entry = (*blocks)[row / ROWSPERBLOCK];
+    const RowBlock* block = entry.resident.load(std::memory_order_acquire);
+    if (spill) {
+        // Stamp the block once per epoch; a hit is counted with the stamp, a fault when read back
+        std::uint64_t epoch = spill->getEpoch();
+        if (entry.lastUse.load(std::memory_order_relaxed) != epoch) {
+            entry.lastUse.store(epoch, std::memory_order_relaxed);
+            if (block) {
+                spill->countHit();
+            }
+        }
+    }
+    if (!block) {
+        block = &faultIn(entry);
+    }
+    return &(*block)[row % ROWSPERBLOCK];
+}
+
+CellMatrix::BlockEntry& CellMatrix::BlockEntry::operator=(const BlockEntry& other) {
+    // A fault may be filling other.block right now; it is only read once published
+    const RowBlock* rows = other.resident.load(std::memory_order_acquire);
+    block = rows ? other.block : nullptr;
+    resident.store(rows, std::memory_order_release);
+    store = other.store;
+    slot = other.slot;
+    lastUse.store(other.lastUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bytes = other.bytes;
+    minWidth = other.minWidth;
+    maxWidth = other.maxWidth;
+    return *this;
+}
+
+void CellMatrix::BlockEntry::assign(std::shared_ptr<RowBlock> rows) {
+    block = std::move(rows);
+    resident.store(block.get(), std::memory_order_release);
+}
+
+/**
+ * @brief Serialized with the other faults of the store, so a block is read back once however many threads need it.
+ */
+const CellMatrix::RowBlock& CellMatrix::faultIn(const BlockEntry& entry) const {
+    std::lock_guard<std::mutex> lock(entry.store->faultMutex());
+    if (const RowBlock* block = entry.resident.load(std::memory_order_acquire)) {
+        return *block;
+    }
+    std::vector<std::vector<std::string>> texts;
+    if (!entry.store->read(entry.slot, texts)) {
+        throw std::runtime_error("Unable to read a spilled cell block.");
+    }
+    std::shared_ptr<RowBlock> block = std::make_shared<RowBlock>();
+    block->reserve(texts.size());
+    for (const auto& rowTexts : texts) {
+        Row row;
+        row.reserve(rowTexts.size());
+        for (const auto& text : rowTexts) {
+            row.push_back(strings->intern(text));
+        }
+        block->push_back(std::move(row));
+    }
+    if (spill) {
+        spill->countFault();
+    }
+    entry.block = block;
+    entry.resident.store(block.get(), std::memory_order_release);
+    return *block;
+}
+
+CellMatrix::Row& CellMatrix::writableRow(int row) {
+    return writableBlock(row / ROWSPERBLOCK)[row % ROWSPERBLOCK];
+}
+
+/**
+ * @brief Copies the block table before its first change while a snapshot shares it.
+ */
+CellMatrix::BlockTable& CellMatrix::writableTable() {
+    // Only this matrix can add owners, so a count of one cannot grow behind our back
+    if (blocks.use_count() > 1) {
+        blocks = std::make_shared<BlockTable>(*blocks);
+    }
+    return *blocks;
+}
+
+/**
+ * @brief Copies a block before its first change while a snapshot shares it.
+ */
+CellMatrix::RowBlock& CellMatrix::writableBlock(std::size_t block) {
+    BlockTable& table = writableTable();
+    BlockEntry& entry = table[block];
+    if (!entry.block) {
+        faultIn(entry);
+    }
+    if (entry.block.use_count() > 1) {
+        entry.assign(std::make_shared<RowBlock>(*entry.block));
+    }
+    entry.store.reset(); // the spilled copy no longer matches
+    entry.bytes = 0;
+    return *entry.block;
+}
+
+/**
+ * @brief Block b holds min(ROWSPERBLOCK, storedRows - b * ROWSPERBLOCK) rows, so only blocks changing size are read.
+ */
+void CellMatrix::setStoredRows(int count, const Row& fill) {
+    BlockTable& table = writableTable();
+    std::size_t oldCount = table.size();
+    std::size_t blockCount = (static_cast<std::size_t>(count) + ROWSPERBLOCK - 1) / ROWSPERBLOCK;
+    table.resize(blockCount);
+    for (std::size_t block = 0; block < blockCount; ++block) {
+        std::size_t wanted = std::min<std::size_t>(ROWSPERBLOCK, count - block * ROWSPERBLOCK);
+        std::size_t held = block < oldCount ? std::min<std::size_t>(ROWSPERBLOCK, std::max<std::ptrdiff_t>(0,
+                           static_cast<std::ptrdiff_t>(storedRows) - static_cast<std::ptrdiff_t>(block * ROWSPERBLOCK))) : 0;
+        if (block >= oldCount) {
+            table[block].assign(std::make_shared<RowBlock>());
+        }
+        if (held != wanted) {
+            writableBlock(block).resize(wanted, fill);
+        }
+    }
+    storedRows = count;
+}
+
+/**
+ * @brief Interns the rows into fresh blocks and a fresh pool; snapshots keep the previous content.
+ */
+void CellMatrix::assignRows(const std::vector<std::vector<std::string>>& newRows) {
+    blocks = std::make_shared<BlockTable>();
+    strings = std::make_shared<StringPool>();
+    storedRows = static_cast<int>(newRows.size());
+    blocks->reserve((newRows.size() + ROWSPERBLOCK - 1) / ROWSPERBLOCK);
+    for (std::size_t first = 0; first < newRows.size(); first += ROWSPERBLOCK) {
+        std::size_t last = std::min(newRows.size(), first + ROWSPERBLOCK);
+        std::shared_ptr<RowBlock> block = std::make_shared<RowBlock>();
+        block->reserve(last - first);
+        for (std::size_t r = first; r < last; ++r) {
+            Row row;
+            row.reserve(newRows[r].size());
+            for (const auto& text : newRows[r]) {
+                row.push_back(strings->intern(text));
+            }
+            block->push_back(std::move(row));
+        }
+        blocks->emplace_back();
+        blocks->back().assign(block);
+    }
+    rebuildColumns();
+    lookups = std::make_shared<LookupCache>();
+    referenceCells.reset();
+    enforceMemoryBudget();
+}
+
+/**
+ * @brief Copies a numeric column before its first change while a snapshot shares it.
+ */
+NumericColumn& CellMatrix::writableColumn(int col) {
+    if (columns.use_count() > 1) {
+        columns = std::make_shared<ColumnTable>(*columns);
+    }
+    ColumnTable& table = *columns;
+    if (static_cast<int>(table.size()) <= col) {
+        table.resize(col + 1);
+    }
+    if (!table[col]) {
+        table[col] = std::make_shared<NumericColumn>();
+    } else if (table[col].use_count() > 1) {
+        table[col] = std::make_shared<NumericColumn>(*table[col]);
+    }
+    return *table[col];
+}
+
+/**
+ * @brief Parses every stored cell into fresh columns; snapshots keep the previous ones.
+ */
+void CellMatrix::rebuildColumns() {
+    if (layout != CellLayout::ColumnMajor) {
+        columns.reset();
+        return;
+    }
+    std::shared_ptr<ColumnTable> table = std::make_shared<ColumnTable>();
+    for (int r = 0; r < storedRows; ++r) {
+        const Row& row = *findRow(r);
+        if (table->size() < row.size()) {
+            table->resize(row.size());
+        }
+        for (std::size_t c = 0; c < row.size(); ++c) {
+            if (!(*table)[c]) {
+                (*table)[c] = std::make_shared<NumericColumn>();
+            }
+            (*table)[c]->set(r, StringPool::numberOf(row[c]));
+        }
+    }
+    columns = table;
+}
+
+void CellMatrix::setLayout(CellLayout newLayout) {
+    if (newLayout != layout) {
+        layout = newLayout;
+        rebuildColumns();
+    }
+}
+
+const NumericColumn* CellMatrix::findNumericColumn(int col) const {
+    if (!columns || col < 0 || col >= static_cast<int>(columns->size())) {
+        return nullptr;
+    }
+    return (*columns)[col].get();
+}
+
+/**
+ * @brief Indexes the column bottom-up outside the lock; a concurrent builder's identical index may win.
+ */
+std::shared_ptr<const LookupIndex> CellMatrix::getLookupIndex(int col) const {
+    std::shared_ptr<LookupCache> cache = lookups;
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        if (col < static_cast<int>(cache->columns.size()) && cache->columns[col]) {
+            return cache->columns[col];
+        }
+    }
+
+    std::shared_ptr<LookupIndex> index = std::make_shared<LookupIndex>();
+    for (int r = storedRows - 1; r >= 0; --r) {
+        const Row& row = *findRow(r);
+        if (col < static_cast<int>(row.size())) {
+            index->add(r, *row[col]);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    if (static_cast<int>(cache->columns.size()) <= col) {
+        cache->columns.resize(col + 1);
+    }
+    if (!cache->columns[col]) {
+        cache->columns[col] = index;
+    }
+    return cache->columns[col];
+}
+
+void CellMatrix::invalidateLookup(int col) {
+    std::shared_ptr<LookupCache> cache = lookups; // keeps the locked mutex alive if we drop the cache
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    if (col >= static_cast<int>(cache->columns.size()) || !cache->columns[col]) {
+        return;
+    }
+    if (cache.use_count() > 2) {
+        // Snapshots keep indexing the old content
+        std::shared_ptr<LookupCache> copy = std::make_shared<LookupCache>();
+        copy->columns = cache->columns;
+        copy->columns[col].reset();
+        lookups = copy;
+        return;
+    }
+    cache->columns[col].reset();
+}
+
+/**
+ * @brief Re-interns every cell into a new pool; snapshots keep the old pool alive.
+ */
+void CellMatrix::compactStrings() {
+    std::shared_ptr<StringPool> compacted = std::make_shared<StringPool>();
+    for (BlockEntry& entry : writableTable()) {
+        if (!entry.block) {
+            continue; // spilled texts are interned again when read back
+        }
+        // The texts do not change, so the spilled copy of the block stays valid
+        std::shared_ptr<RowBlock> block = entry.block.use_count() > 1 ? std::make_shared<RowBlock>(*entry.block) : entry.block;
+        for (Row& row : *block) {
+            for (const std::string*& text : row) {
+                text = compacted->intern(*text);
+            }
+        }
+        entry.assign(block);
+    }
+    strings = compacted;
+}
+
+std::size_t CellMatrix::blockBytes(const RowBlock& block) {
+    std::size_t bytes = sizeof(RowBlock) + block.capacity() * sizeof(Row);
+    for (const Row& row : block) {
+        bytes += row.capacity() * sizeof(const std::string*);
+        for (const std::string* text : row) {
+            bytes += text->size();
+        }
+    }
+    return bytes;
+}
+
+void CellMatrix::setMemoryBudget(std::size_t bytes) {
+    memoryBudget = bytes;
+    if (bytes > 0 && !spill) {
+        spill = std::make_shared<SpillStore>();
+    }
+    enforceMemoryBudget();
+}
+
+/**
+ * @brief Evicts the blocks with the oldest stamps first, writing only those without a valid spilled copy.
+ *
+ * Evicting down to 3/4 of the budget leaves room for edits and read-backs,
+ * so the pool compaction releasing the evicted texts runs only now and then.
+ */
+void CellMatrix::enforceMemoryBudget() {
+    if (memoryBudget == 0) {
+        return;
+    }
+    // Measure on the table as it is: a snapshot sharing it is only copied away from when a block is evicted
+    bool owned = blocks.use_count() == 1;
+    std::size_t residentBytes = 0;
+    std::vector<std::size_t> resident;
+    std::vector<std::size_t> bytes(blocks->size(), 0);
+    for (std::size_t b = 0; b < blocks->size(); ++b) {
+        BlockEntry& entry = (*blocks)[b];
+        if (const RowBlock* rows = entry.resident.load(std::memory_order_acquire)) {
+            bytes[b] = entry.bytes != 0 ? entry.bytes : blockBytes(*rows);
+            if (owned) {
+                entry.bytes = bytes[b];
+            }
+            residentBytes += bytes[b];
+            resident.push_back(b);
+        }
+    }
+    spill->nextEpoch();
+    if (residentBytes <= memoryBudget) {
+        return;
+    }
+
+    BlockTable& table = writableTable();
+    std::stable_sort(resident.begin(), resident.end(), [&](std::size_t a, std::size_t b) {
+        return table[a].lastUse.load(std::memory_order_relaxed) < table[b].lastUse.load(std::memory_order_relaxed);
+    });
+    std::size_t target = memoryBudget / 4 * 3;
+    for (std::size_t b : resident) {
+        if (residentBytes <= target) {
+            break;
+        }
+        BlockEntry& entry = table[b];
+        entry.bytes = bytes[b];
+        if (!entry.store) {
+            if (!spill->write(*entry.block, entry.slot)) {
+                break; // no temporary file: keep the rest in memory
+            }
+            entry.store = spill;
+        }
+        entry.minWidth = entry.block->empty() ? 0 : static_cast<int>(entry.block->front().size());
+        entry.maxWidth = entry.minWidth;
+        for (const Row& row : *entry.block) {
+            entry.minWidth = std::min(entry.minWidth, static_cast<int>(row.size()));
+            entry.maxWidth = std::max(entry.maxWidth, static_cast<int>(row.size()));
+        }
+        residentBytes -= bytes[b];
+        entry.assign(nullptr);
+    }
+    compactStrings();
+}
+
+CellMatrix::SpillStats CellMatrix::getSpillStats() const {
+    SpillStats stats = {};
+    for (const BlockEntry& entry : *blocks) {
+        if (const RowBlock* block = entry.resident.load(std::memory_order_acquire)) {
+            ++stats.residentBlocks;
+            stats.residentBytes += blockBytes(*block);
+        } else {
+            ++stats.spilledBlocks;
+        }
+    }
+    if (spill) {
+        stats.io = spill->getStats();
+    }
+    return stats;
+}
+
+/**
+ * @brief Counts cells and pool usage, and what one std::string per cell would cost instead.
+ */
+CellMatrix::MemoryUsage CellMatrix::getMemoryUsage() const {
+    MemoryUsage usage = {};
+    usage.cellBytes = sizeof(BlockTable) + blocks->capacity() * sizeof(BlockEntry);
+    for (const BlockEntry& entry : *blocks) {
+        const RowBlock* block = entry.resident.load(std::memory_order_acquire);
+        if (!block) {
+            continue; // spilled: see getSpillStats
+        }
+        usage.cellBytes += sizeof(RowBlock) + block->capacity() * sizeof(Row);
+        for (const Row& row : *block) {
+            usage.cellBytes += row.capacity() * sizeof(const std::string*);
+            usage.cells += row.size();
+            for (const std::string* text : row) {
+                if (!text->empty()) {
+                    ++usage.nonEmptyCells;
+                }
+                // A private std::string has its own buffer once the text exceeds the inline capacity
+                std::string copy(*text);
+                const char* inlineStart = reinterpret_cast<const char*>(&copy);
+                bool onHeap = copy.data() < inlineStart || copy.data() >= inlineStart + sizeof(std::string);
+                usage.unpooledBytes += sizeof(std::string) + (onHeap ? copy.capacity() + 1 : 0);
+            }
+        }
+    }
+    usage.distinctTexts = strings->size();
+    usage.poolBytes = strings->getMemoryUsage();
+    if (columns) {
+        usage.columnBytes = sizeof(ColumnTable) + columns->capacity() * sizeof(std::shared_ptr<NumericColumn>);
+        for (const auto& column : *columns) {
+            usage.columnBytes += column ? column->getMemoryUsage() : 0;
+        }
+    }
+    return usage;
+}
+
+void CellMatrix::writeMemoryReport(std::ostream& out) const {
+    MemoryUsage usage = getMemoryUsage();
+    std::size_t pooled = usage.cellBytes + usage.poolBytes + usage.columnBytes;
+    double cells = static_cast<double>(std::max<std::size_t>(usage.cells, 1));
+    out << "cells," << usage.cells << "\n"
+        << "non-empty cells," << usage.nonEmptyCells << "\n"
+        << "distinct texts," << usage.distinctTexts << "\n"
+        << "cell storage bytes," << usage.cellBytes << "\n"
+        << "string pool bytes," << usage.poolBytes << "\n"
+        << "numeric column bytes," << usage.columnBytes << "\n"
+        << "bytes per cell (pooled)," << pooled / cells << "\n"
+        << "bytes per cell (one std::string per cell)," << usage.unpooledBytes / cells << "\n";
+    if (memoryBudget > 0) {
+        SpillStats spilled = getSpillStats();
+        std::uint64_t accesses = spilled.io.hits + spilled.io.faults;
+        out << "memory budget bytes," << memoryBudget << "\n"
+            << "resident blocks," << spilled.residentBlocks << "\n"
+            << "spilled blocks," << spilled.spilledBlocks << "\n"
+            << "resident block bytes," << spilled.residentBytes << "\n"
+            << "block hit rate," << (accesses ? static_cast<double>(spilled.io.hits) / accesses : 1.0) << "\n"
+            << "spill writes," << spilled.io.blocksWritten << " blocks, " << spilled.io.bytesWritten << " bytes\n"
+            << "spill reads," << spilled.io.blocksRead << " blocks, " << spilled.io.bytesRead << " bytes\n";
+    }
 }
 /**
  * @brief Gets the current number of rows in the matrix.
@@ -152,11 +1080,8 @@ void CellMatrix::resizeToFit(int newRows, int newCols) {
 }
 ///@brief: Clears the contents of all cells in the matrix.
 void CellMatrix::clear() {
-    for (auto& row : data) {
-        for (auto& cell : row) {
-            cell.clear();
-        }
-    }
+    // Start from empty blocks and pool; snapshots sharing the old ones are unaffected
+    assignRows(std::vector<std::vector<std::string>>());
     resize(1, 1); // Reset the matrix to 1x1 size
 
 }
@@ -166,50 +1091,73 @@ void CellMatrix::clear() {
  * @return True if the file was loaded successfully, false otherwise.
  */
 bool CellMatrix::loadFromFile(const std::string& filename) {
-std::ifstream file(filename);
-if (!file.is_open()) {
-    std::cerr << "Error: Unable to open file for reading: " << filename << "\n";
-    return false;
+    IoProgress progress;
+    return loadFromFile(filename, progress);
 }
 
-std::vector<std::vector<std::string>> tempData;
-std::string line;
-
-while (std::getline(file, line)) {
-    if (line.empty()) {
-        continue; // skipempty lines
+/**
+ * @brief Parses the file line by line, publishing counters and the first rows on the way.
+ */
+bool CellMatrix::loadFromFile(const std::string& filename, IoProgress& progress) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file for reading: " << filename << "\n";
+        return false;
     }
+    file.seekg(0, std::ios::end);
+    progress.bytesTotal = static_cast<std::uint64_t>(std::max<std::streamoff>(0, file.tellg()));
+    file.seekg(0, std::ios::beg);
 
-    std::stringstream ss(line);
-    std::string cell;
-    std::vector<std::string> row;
+    std::vector<std::vector<std::string>> tempData;
+    std::string line;
+    std::uint64_t bytesRead = 0;
+    std::size_t maxColNumber = 0;
 
-    while (std::getline(ss, cell, ',')) {
-        row.push_back(cell);
-    }
+    while (std::getline(file, line)) {
+        if (progress.cancelled) {
+            return false;
+        }
+        bytesRead += line.size() + 1;
+        progress.bytesDone = bytesRead;
+        if (line.empty()) {
+            continue; // skipempty lines
+        }
 
-    if (!row.empty()) {
-        tempData.push_back(row);
-    }
-}
+        std::stringstream ss(line);
+        std::string cell;
+        std::vector<std::string> row;
 
-file.close();
+        while (std::getline(ss, cell, ',')) {
+            row.push_back(cell);
+        }
 
-// Update the matrix dimensions and data
-rows = tempData.size();
-int maxColNumber=0;
-for(auto& rowdata : tempData)
-{
-    if(rowdata.size()>maxColNumber)
-    {
-        maxColNumber=rowdata.size();
+        if (!row.empty()) {
+            maxColNumber = std::max(maxColNumber, row.size());
+            tempData.push_back(row);
+            progress.rowsDone = static_cast<int>(tempData.size());
+
+            if (static_cast<int>(tempData.size()) == progress.previewRows) {
+                // Hand out the first screen while the rest is still being parsed
+                std::shared_ptr<CellMatrix> preview = std::make_shared<CellMatrix>(0, 0);
+                preview->assignRows(tempData);
+                preview->rows = static_cast<int>(tempData.size());
+                preview->cols = static_cast<int>(maxColNumber);
+                progress.setPreview(preview);
+            }
+        }
     }
-}
-cols = rows > 0 ? maxColNumber : 0;
-data = std::move(tempData);
 
-return true;
+    file.close();
+    applyChangeFile(filename, tempData, maxColNumber);
+
+    // Update the matrix dimensions and data
+    rows = tempData.size();
+    cols = rows > 0 ? static_cast<int>(maxColNumber) : 0;
+    assignRows(tempData);
+    ++version;
+    resetChangeLog();
 
+    return true;
 }
 
 /**
@@ -217,22 +1165,149 @@ return true;
  * @return True if the file was saved successfully, false otherwise.
  */
 bool CellMatrix::saveToFile(const std::string& filename) const {
-    std::ofstream file(filename);
+    IoProgress progress;
+    return saveToFile(filename, progress);
+}
+
+/**
+ * @brief Writes to a temporary file and renames it over the target once complete.
+ */
+bool CellMatrix::saveToFile(const std::string& filename, IoProgress& progress) const {
+    // The output size is known up front: every cell, the separators and one newline per row
+    std::uint64_t totalBytes = 0;
+    for (int r = 0; r < storedRows; ++r) {
+        const Row& row = *findRow(r);
+        for (const std::string* cell : row) {
+            totalBytes += cell->size() + 1;
+        }
+        totalBytes += row.empty() ? 1 : 0;
+    }
+    progress.bytesTotal = totalBytes;
+
+    std::string partName = filename + ".part";
+    std::ofstream file(partName, std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "Error: Unable to open file for writing: " << filename << "\n";
         return false;
     }
 
-    for (const auto& row : data) {
+    std::uint64_t bytesWritten = 0;
+    for (int r = 0; r < storedRows; ++r) {
+        if (progress.cancelled) {
+            file.close();
+            std::remove(partName.c_str());
+            return false;
+        }
+        const Row& row = *findRow(r);
         for (size_t i = 0; i < row.size(); ++i) {
-            file << row[i];
+            file << *row[i];
             if (i < row.size() - 1) {
                 file << ",";
             }
+            bytesWritten += row[i]->size() + 1;
         }
         file << "\n";
+        bytesWritten += row.empty() ? 1 : 0;
+        progress.bytesDone = bytesWritten;
+        progress.rowsDone = r + 1;
     }
 
     file.close();
+    if (!file || std::rename(partName.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Error: Unable to write file: " << filename << "\n";
+        std::remove(partName.c_str());
+        return false;
+    }
+    // The file holds every edit now; a leftover change log would no longer match its size anyway
+    std::remove(getChangeFileName(filename).c_str());
+    return true;
+}
+
+/**
+ * @brief Appends the newest content of each edited cell as one committed block, or compacts.
+ */
+bool CellMatrix::saveChangesToFile(const std::string& filename, std::uint64_t baseVersion, IoProgress& progress) const {
+    std::vector<std::pair<int, int>> changes;
+    std::string changeFile = getChangeFileName(filename);
+    long long csvSize = fileSize(filename);
+    long long logSize = fileSize(changeFile);
+    if (csvSize < 0 || !changesSince(baseVersion, changes) ||
+        logSize > csvSize / MAXCHANGEFILEFRACTION) {
+        return saveToFile(filename, progress); // rewrite everything, dropping the change log
+    }
+
+    // A cell typed into several times is written once, with its current content
+    std::vector<std::pair<int, int>> cells;
+    std::set<std::pair<int, int>> seen;
+    for (auto change = changes.rbegin(); change != changes.rend(); ++change) {
+        if (seen.insert(*change).second) {
+            cells.push_back(*change);
+        }
+    }
+    if (cells.empty()) {
+        return true;
+    }
+
+    // The block is written with a single append so a cancelled save leaves no partial records
+    std::string block;
+    if (logSize <= 0) {
+        block += "@" + std::to_string(csvSize) + "\n";
+    }
+    for (auto cell = cells.rbegin(); cell != cells.rend(); ++cell) {
+        if (progress.cancelled) {
+            return false;
+        }
+        block += std::to_string(cell->first + 1) + "," + std::to_string(cell->second + 1) + "," +
+                 (*this)(cell->first, cell->second) + "\n";
+        progress.rowsDone = progress.rowsDone + 1;
+    }
+    block += "=" + std::to_string(cells.size()) + "\n";
+    progress.bytesTotal = block.size();
+
+    std::ofstream log(changeFile, std::ios::binary | std::ios::app);
+    if (!log.is_open()) {
+        std::cerr << "Error: Unable to open file for writing: " << changeFile << "\n";
+        return false;
+    }
+    log << block;
+    log.close();
+    if (!log) {
+        std::cerr << "Error: Unable to write file: " << changeFile << "\n";
+        return false;
+    }
+    progress.bytesDone = block.size();
     return true;
-}
\ No newline at end of file
+}
+
+void CellMatrix::setRows(const std::vector<std::vector<std::string>>& newRows) {
+    std::size_t width = 0;
+    for (const auto& row : newRows) {
+        width = std::max(width, row.size());
+    }
+    rows = static_cast<int>(newRows.size());
+    cols = rows > 0 ? static_cast<int>(width) : 0;
+    assignRows(newRows);
+    ++version;
+    resetChangeLog();
+}
+
+/**
+ * @brief Shares the other matrix's blocks and counts as a whole-content change.
+ */
+void CellMatrix::replaceWith(const CellMatrix& other) {
+    rows = other.rows;
+    cols = other.cols;
+    blocks = other.blocks;
+    strings = other.strings;
+    storedRows = other.storedRows;
+    lookups = other.lookups;
+    referenceCells.reset();
+    if (other.layout == layout) {
+        columns = other.columns;
+    } else {
+        rebuildColumns(); // keep this sheet's layout
+    }
+    ++version;
+    resetChangeLog();
+    enforceMemoryBudget(); // keeps this sheet's budget
+}
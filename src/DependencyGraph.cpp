@@ -0,0 +1,318 @@
+#include "DependencyGraph.h"
+#include "LexicalAnalysis.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+/**
+ * @brief Tokenizes every cell and collects its precedents, rows shared among the pool threads.
+ */
+void DependencyGraph::build(const Workbook& book, const Tokenizer& tokenizer, ThreadPool& pool) {
+    sheetRows.clear();
+    sheetCols.clear();
+    sheetStart.assign(1, 0);
+    for (int sheet = 0; sheet < book.getSheetCount(); ++sheet) {
+        const CellMatrix& data = book.getSheet(sheet);
+        sheetRows.push_back(data.getRows());
+        sheetCols.push_back(data.getCols());
+        sheetStart.push_back(sheetStart.back() + static_cast<std::size_t>(data.getRows()) * data.getCols());
+    }
+    std::size_t cellCount = sheetStart.back();
+    tokens.assign(cellCount, std::vector<Token>());
+    precedents.assign(cellCount, std::vector<std::size_t>());
+    ranges.assign(cellCount, std::vector<CellRange>());
+    dependents.assign(cellCount, std::vector<std::size_t>());
+    rangeIndex.clear();
+
+    pool.parallelFor(cellCount, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t cell = begin; cell < end; ++cell) {
+            analyzeCell(book, tokenizer, cell);
+        }
+    });
+
+    for (std::size_t cell = 0; cell < cellCount; ++cell) {
+        linkCell(cell, true);
+    }
+    rangeIndex.refresh();
+}
+
+void DependencyGraph::updateCells(const Workbook& book, const Tokenizer& tokenizer, const std::vector<std::size_t>& cells) {
+    for (std::size_t cell : cells) {
+        updateCell(book, tokenizer, cell);
+    }
+    rangeIndex.refresh();
+}
+
+void DependencyGraph::updateCell(const Workbook& book, const Tokenizer& tokenizer, std::size_t cell) {
+    linkCell(cell, false);
+    tokens[cell].clear();
+    precedents[cell].clear();
+    ranges[cell].clear();
+    analyzeCell(book, tokenizer, cell);
+    linkCell(cell, true);
+}
+
+/**
+ * @brief Registers a cell as dependent of its precedents and as reader of its ranges, or removes it.
+ */
+void DependencyGraph::linkCell(std::size_t cell, bool add) {
+    for (std::size_t precedent : precedents[cell]) {
+        std::vector<std::size_t>& readers = dependents[precedent];
+        if (add) {
+            readers.push_back(cell);
+        } else {
+            auto found = std::find(readers.begin(), readers.end(), cell);
+            if (found != readers.end()) {
+                readers.erase(found);
+            }
+        }
+    }
+    for (const auto& range : ranges[cell]) {
+        if (add) {
+            rangeIndex.add(range, cell);
+        } else {
+            rangeIndex.remove(range, cell);
+        }
+    }
+}
+
+/**
+ * @brief Collects the edited cells, the ranges covering them and everything downstream.
+ */
+std::vector<std::size_t> DependencyGraph::affectedBy(const std::vector<std::size_t>& edited) const {
+    std::vector<std::size_t> affected;
+    std::unordered_set<std::size_t> seen;
+    auto visit = [&](std::size_t cell) {
+        if (seen.insert(cell).second) {
+            affected.push_back(cell);
+        }
+    };
+
+    for (std::size_t cell : edited) {
+        visit(cell);
+    }
+    // Range functions read the raw content, so only the edited cells themselves matter here
+    std::vector<std::size_t> readers;
+    for (std::size_t cell : edited) {
+        int sheet = sheetOf(cell);
+        std::size_t position = cell - sheetStart[sheet];
+        rangeIndex.findCovering(sheet, static_cast<int>(position / sheetCols[sheet]),
+                                static_cast<int>(position % sheetCols[sheet]), readers);
+    }
+    for (std::size_t reader : readers) {
+        visit(reader);
+    }
+    // Direct references propagate value changes transitively
+    for (std::size_t i = 0; i < affected.size(); ++i) {
+        for (std::size_t dependent : dependents[affected[i]]) {
+            visit(dependent);
+        }
+    }
+    return affected;
+}
+
+/**
+ * @brief Tokenizes one cell, folds its constants and records the cells and ranges it reads.
+ */
+void DependencyGraph::analyzeCell(const Workbook& book, const Tokenizer& tokenizer, std::size_t cell) {
+    int sheet = sheetOf(cell);
+    const int cols = sheetCols[sheet];
+    std::size_t position = cell - sheetStart[sheet];
+    const CellMatrix& data = book.getSheet(sheet);
+    const std::string& content = data(static_cast<int>(position / cols), static_cast<int>(position % cols));
+    if (content.empty()) {
+        return;
+    }
+    tokens[cell] = tokenizer.tokenize(content);
+    LexicalAnalysis(tokenizer, data).foldConstants(tokens[cell]);
+
+    // A reference without a sheet name points into the cell's own sheet; unknown sheets evaluate to an error
+    auto sheetIndex = [&](const std::string& reference, std::string& local) {
+        std::string sheetName;
+        return LexicalAnalysis::splitSheetName(reference, sheetName, local) ? book.findSheet(sheetName) : sheet;
+    };
+    auto addReference = [&](const std::string& reference) {
+        std::string local;
+        int target = sheetIndex(reference, local);
+        int row = 0;
+        int col = 0;
+        // References outside the sheet evaluate to an error and need no ordering
+        if (target >= 0 && LexicalAnalysis::parseCellReference(local, row, col) &&
+            row >= 0 && row < sheetRows[target] && col >= 0 && col < sheetCols[target]) {
+            precedents[cell].push_back(sheetStart[target] + static_cast<std::size_t>(row) * sheetCols[target] + col);
+        }
+    };
+    auto addRange = [&](const std::string& startCell, const std::string& endCell) {
+        std::string local;
+        CellRange range;
+        range.sheet = sheetIndex(startCell, local);
+        if (range.sheet >= 0 && parseRange(local, endCell, range)) {
+            ranges[cell].push_back(range);
+        }
+    };
+
+    auto addValueRange = [&](const std::string& startCell, const std::string& endCell) {
+        std::string local;
+        CellRange range;
+        range.sheet = sheetIndex(startCell, local);
+        if (range.sheet < 0 || !parseRange(local, endCell, range)) {
+            return;
+        }
+        // Only the part inside the sheet has cells to wait for
+        const int target = range.sheet;
+        for (int row = std::max(range.startRow, 0); row <= std::min(range.endRow, sheetRows[target] - 1); ++row) {
+            for (int col = std::max(range.startCol, 0); col <= std::min(range.endCol, sheetCols[target] - 1); ++col) {
+                precedents[cell].push_back(sheetStart[target] + static_cast<std::size_t>(row) * sheetCols[target] + col);
+            }
+        }
+    };
+
+    scanReferences(tokens[cell], addReference, addRange, addValueRange);
+}
+
+void DependencyGraph::scanReferences(const std::vector<Token>& tokens, const std::function<void(const std::string&)>& reference,
+                                     const std::function<void(const std::string&, const std::string&)>& range,
+                                     const std::function<void(const std::string&, const std::string&)>& valueRange) {
+    for (const auto& token : tokens) {
+        if (token.type == TokenType::MatrixReference) {
+            reference(token.value);
+        } else if (token.type == TokenType::Formula) {
+            LookupCall lookup;
+            ConditionalCall conditional;
+            std::string label, startCell, endCell;
+            if (LexicalAnalysis::parseLookup(token.value, lookup)) {
+                // The key column is read raw, the result cell by value; a key given as a reference is evaluated first
+                reference(lookup.key);
+                range(lookup.keyStart, lookup.keyEnd);
+                if (!lookup.resultStart.empty()) {
+                    valueRange(lookup.resultStart, lookup.resultEnd);
+                }
+            } else if (LexicalAnalysis::parseConditional(token.value, conditional)) {
+                range(conditional.testStart, conditional.testEnd);
+                if (!conditional.valueStart.empty()) {
+                    range(conditional.valueStart, conditional.valueEnd);
+                }
+            } else if (LexicalAnalysis::parseRangeFunction(token.value, label, startCell, endCell)) {
+                range(startCell, endCell);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Finds the last sheet starting at or before the cell, skipping sheets without cells.
+ */
+int DependencyGraph::sheetOf(std::size_t cell) const {
+    return static_cast<int>(std::upper_bound(sheetStart.begin(), sheetStart.end(), cell) - sheetStart.begin()) - 1;
+}
+
+/**
+ * @brief Parses both corners and orders them so the range is never empty.
+ */
+bool DependencyGraph::parseRange(const std::string& startCell, const std::string& endCell, CellRange& range) {
+    if (!LexicalAnalysis::parseCellReference(startCell, range.startRow, range.startCol) ||
+        !LexicalAnalysis::parseCellReference(endCell, range.endRow, range.endCol)) {
+        return false;
+    }
+    if (range.startRow > range.endRow) std::swap(range.startRow, range.endRow);
+    if (range.startCol > range.endCol) std::swap(range.startCol, range.endCol);
+    return true;
+}
+
+/**
+ * @brief Kahn's algorithm processed one frontier at a time, each frontier being a level.
+ */
+std::vector<std::vector<std::size_t>> DependencyGraph::computeLevels(std::vector<std::size_t>& cyclic) const {
+    std::size_t cellCount = precedents.size();
+    std::vector<unsigned> pending(cellCount, 0);
+    for (std::size_t cell = 0; cell < cellCount; ++cell) {
+        pending[cell] = static_cast<unsigned>(precedents[cell].size());
+    }
+
+    std::vector<std::vector<std::size_t>> levels;
+    std::vector<std::size_t> frontier;
+    for (std::size_t cell = 0; cell < cellCount; ++cell) {
+        if (pending[cell] == 0) {
+            frontier.push_back(cell);
+        }
+    }
+
+    std::size_t scheduled = 0;
+    while (!frontier.empty()) {
+        std::vector<std::size_t> next;
+        for (std::size_t cell : frontier) {
+            for (std::size_t dependent : dependents[cell]) {
+                if (--pending[dependent] == 0) {
+                    next.push_back(dependent);
+                }
+            }
+        }
+        scheduled += frontier.size();
+        levels.push_back(std::move(frontier));
+        frontier = std::move(next);
+    }
+
+    // Whatever was never released waits on a cycle
+    cyclic.clear();
+    if (scheduled != cellCount) {
+        for (std::size_t cell = 0; cell < cellCount; ++cell) {
+            if (pending[cell] != 0) {
+                cyclic.push_back(cell);
+            }
+        }
+    }
+    return levels;
+}
+
+/**
+ * @brief Kahn's algorithm over a subset; precedents outside the subset count as complete.
+ */
+std::vector<std::vector<std::size_t>> DependencyGraph::computeLevels(const std::vector<std::size_t>& cells,
+                                                                     std::vector<std::size_t>& cyclic) const {
+    std::unordered_map<std::size_t, unsigned> pending;
+    pending.reserve(cells.size());
+    for (std::size_t cell : cells) {
+        pending[cell] = 0;
+    }
+    for (std::size_t cell : cells) {
+        for (std::size_t precedent : precedents[cell]) {
+            if (pending.count(precedent)) {
+                pending[cell]++;
+            }
+        }
+    }
+
+    std::vector<std::vector<std::size_t>> levels;
+    std::vector<std::size_t> frontier;
+    for (std::size_t cell : cells) {
+        if (pending[cell] == 0) {
+            frontier.push_back(cell);
+        }
+    }
+
+    std::size_t scheduled = 0;
+    while (!frontier.empty()) {
+        std::vector<std::size_t> next;
+        for (std::size_t cell : frontier) {
+            for (std::size_t dependent : dependents[cell]) {
+                auto found = pending.find(dependent);
+                if (found != pending.end() && --found->second == 0) {
+                    next.push_back(dependent);
+                }
+            }
+        }
+        scheduled += frontier.size();
+        levels.push_back(std::move(frontier));
+        frontier = std::move(next);
+    }
+
+    cyclic.clear();
+    if (scheduled != cells.size()) {
+        for (std::size_t cell : cells) {
+            if (pending[cell] != 0) {
+                cyclic.push_back(cell);
+            }
+        }
+    }
+    return levels;
+}
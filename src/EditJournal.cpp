@@ -0,0 +1,100 @@
+#include "EditJournal.h"
+
+EditJournal::EditJournal(std::size_t maxBytes) : maxBytes(maxBytes), position(0) {}
+
+/**
+ * @brief Appends an edit, or extends the last one while the same cell is being typed into.
+ */
+void EditJournal::record(int row, int col, const std::string& oldValue, const std::string& newValue, bool continueEdit) {
+    if (position < records.size()) {
+        // A new edit after undo makes the undone edits unreachable
+        arena.resize(records[position].oldOffset);
+        records.resize(position);
+    }
+
+    if (continueEdit && !records.empty() && records.back().row == row && records.back().col == col) {
+        // The new text of the last record ends the arena, so it can be replaced in place
+        EditRecord& last = records.back();
+        arena.resize(last.newOffset);
+        arena += newValue;
+        last.newLength = newValue.size();
+    } else {
+        EditRecord edit;
+        edit.row = row;
+        edit.col = col;
+        edit.oldOffset = arena.size();
+        edit.oldLength = oldValue.size();
+        arena += oldValue;
+        edit.newOffset = arena.size();
+        edit.newLength = newValue.size();
+        arena += newValue;
+        records.push_back(edit);
+    }
+    position = records.size();
+
+    if (getMemoryUsage() > maxBytes) {
+        enforceBudget();
+    }
+}
+
+bool EditJournal::undo(int& row, int& col, std::string& value) {
+    if (position == 0) {
+        return false;
+    }
+    const EditRecord& edit = records[--position];
+    row = edit.row;
+    col = edit.col;
+    value.assign(arena, edit.oldOffset, edit.oldLength);
+    return true;
+}
+
+bool EditJournal::redo(int& row, int& col, std::string& value) {
+    if (position == records.size()) {
+        return false;
+    }
+    const EditRecord& edit = records[position++];
+    row = edit.row;
+    col = edit.col;
+    value.assign(arena, edit.newOffset, edit.newLength);
+    return true;
+}
+
+void EditJournal::clear() {
+    arena.clear();
+    records.clear();
+    position = 0;
+}
+
+std::size_t EditJournal::getMemoryUsage() const {
+    return arena.size() + records.size() * sizeof(EditRecord);
+}
+
+/**
+ * @brief Forgets the oldest edits and moves the remaining texts to the front of a fresh arena.
+ */
+void EditJournal::enforceBudget() {
+    std::size_t target = maxBytes / 4 * 3;
+    std::size_t used = getMemoryUsage();
+    std::size_t dropped = 0;
+    // The newest record is always kept so the edit just made can be undone
+    while (dropped + 1 < records.size() && used > target) {
+        const EditRecord& edit = records[dropped];
+        used -= edit.oldLength + edit.newLength + sizeof(EditRecord);
+        ++dropped;
+    }
+
+    std::string compacted;
+    compacted.reserve(used);
+    std::vector<EditRecord> kept(records.begin() + dropped, records.end());
+    for (EditRecord& edit : kept) {
+        std::size_t oldOffset = compacted.size();
+        compacted.append(arena, edit.oldOffset, edit.oldLength);
+        std::size_t newOffset = compacted.size();
+        compacted.append(arena, edit.newOffset, edit.newLength);
+        edit.oldOffset = oldOffset;
+        edit.newOffset = newOffset;
+    }
+    arena.swap(compacted);
+    records.swap(kept);
+    position = position > dropped ? position - dropped : 0;
+}
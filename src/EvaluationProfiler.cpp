@@ -0,0 +1,106 @@
+#include "EvaluationProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+/**
+ * @brief Starts timing of a cell evaluation.
+ */
+void EvaluationProfiler::beginCell(int row, int col) {
+    stack.push_back({ row, col, Clock::now(), 0.0, 0, 0 });
+}
+
+/**
+ * @brief Finishes the innermost cell evaluation and accumulates its measurements.
+ */
+void EvaluationProfiler::endCell() {
+    if (stack.empty()) {
+        return;
+    }
+    Frame frame = stack.back();
+    stack.pop_back();
+
+    double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - frame.start).count();
+
+    CellProfile& profile = cells[(static_cast<long long>(frame.row) << 32) | static_cast<unsigned>(frame.col)];
+    profile.row = frame.row;
+    profile.col = frame.col;
+    profile.evaluations++;
+    profile.totalNs += elapsed;
+    profile.selfNs += std::max(0.0, elapsed - frame.childNs);
+    profile.maxDepth = std::max(profile.maxDepth, frame.depthBelow);
+    profile.referencedCells = frame.references;
+
+    // Report the nested evaluation to the cell that referenced this one
+    if (!stack.empty()) {
+        stack.back().childNs += elapsed;
+        stack.back().depthBelow = std::max(stack.back().depthBelow, frame.depthBelow + 1);
+    }
+}
+
+/**
+ * @brief Adds referenced cells to the innermost cell being evaluated.
+ */
+void EvaluationProfiler::addReferences(long long count) {
+    if (!stack.empty()) {
+        stack.back().references += count;
+    }
+}
+
+void EvaluationProfiler::beginRecalculation() {
+    recalculationStart = Clock::now();
+}
+
+void EvaluationProfiler::endRecalculation() {
+    recalculationNs = std::chrono::duration<double, std::nano>(Clock::now() - recalculationStart).count();
+}
+
+void EvaluationProfiler::reset() {
+    stack.clear();
+    cells.clear();
+    recalculationNs = 0;
+}
+
+/**
+ * @brief Returns the most expensive cells ordered by self time.
+ */
+std::vector<CellProfile> EvaluationProfiler::topCells(std::size_t count) const {
+    std::vector<CellProfile> result;
+    result.reserve(cells.size());
+    for (const auto& entry : cells) {
+        result.push_back(entry.second);
+    }
+
+    count = std::min(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + count, result.end(),
+                      [](const CellProfile& a, const CellProfile& b) { return a.selfNs > b.selfNs; });
+    result.resize(count);
+    return result;
+}
+
+/**
+ * @brief Writes the top cells and total recalculation time as CSV.
+ */
+void EvaluationProfiler::writeReport(std::ostream& out, std::size_t count) const {
+    out << "recalculation_ms," << getRecalculationMs() << "\n";
+    out << "row,col,evaluations,self_us,total_us,max_depth,referenced_cells\n";
+    for (const auto& profile : topCells(count)) {
+        out << profile.row + 1 << "," << profile.col + 1 << "," << profile.evaluations << ","
+            << profile.selfNs / 1000 << "," << profile.totalNs / 1000 << ","
+            << profile.maxDepth << "," << profile.referencedCells << "\n";
+    }
+}
+
+/**
+ * @brief Writes the report to a file.
+ */
+bool EvaluationProfiler::exportToFile(const std::string& filename, std::size_t count) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file for writing: " << filename << "\n";
+        return false;
+    }
+    writeReport(file, count);
+    return true;
+}
@@ -0,0 +1,38 @@
+#include "FileTask.h"
+
+FileTask::FileTask(const std::string& filename, int previewRows)
+    : loading(true), incremental(false), baseVersion(0), data(0, 0), ok(false), finished(false) {
+    progress.previewRows = previewRows;
+    worker = std::thread(&FileTask::run, this, filename);
+}
+
+FileTask::FileTask(const std::string& filename, const CellMatrix& source)
+    : loading(false), incremental(false), baseVersion(0), data(source.snapshot()), ok(false), finished(false) {
+    worker = std::thread(&FileTask::run, this, filename);
+}
+
+FileTask::FileTask(const std::string& filename, const CellMatrix& source, std::uint64_t baseVersion)
+    : loading(false), incremental(true), baseVersion(baseVersion), data(source.snapshot()), ok(false), finished(false) {
+    worker = std::thread(&FileTask::run, this, filename);
+}
+
+FileTask::~FileTask() {
+    if (!finished) {
+        cancel();
+    }
+    worker.join();
+}
+
+/**
+ * @brief Runs the file operation on the worker thread.
+ */
+void FileTask::run(const std::string& filename) {
+    if (loading) {
+        ok = data.loadFromFile(filename, progress);
+    } else if (incremental) {
+        ok = data.saveChangesToFile(filename, baseVersion, progress);
+    } else {
+        ok = data.saveToFile(filename, progress);
+    }
+    finished = true;
+}
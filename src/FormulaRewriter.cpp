@@ -0,0 +1,160 @@
+#include "FormulaRewriter.h"
+#include "LexicalAnalysis.h"
+
+#include <cctype>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Checks for a cell name the grammar accepts inside a range: one or two capitals and up to seven digits.
+ */
+bool isCellName(const std::string& text) {
+    std::size_t letters = 0;
+    while (letters < text.size() && std::isupper(static_cast<unsigned char>(text[letters]))) {
+        ++letters;
+    }
+    std::size_t digits = text.size() - letters;
+    if (letters < 1 || letters > 2 || digits < 1 || digits > 7) {
+        return false;
+    }
+    for (std::size_t i = letters; i < text.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::string FormulaRewriter::shift(const std::string& content, int rowOffset, int colOffset) const {
+    if (rowOffset == 0 && colOffset == 0) {
+        return content;
+    }
+    return rewrite(content, [&](ReferenceArea& area) {
+        area.startRow += rowOffset;
+        area.endRow += rowOffset;
+        area.startCol += colOffset;
+        area.endCol += colOffset;
+        return true;
+    });
+}
+
+/**
+ * @brief Copies the text between the tokens unchanged and splices in the rewritten references.
+ */
+std::string FormulaRewriter::rewrite(const std::string& content, const Move& move) const {
+    std::vector<std::size_t> positions;
+    std::vector<Token> tokens = tokenizer.tokenize(content, positions);
+    for (const auto& token : tokens) {
+        if (token.type == TokenType::Unknown) {
+            return content; // shown as text, see LexicalAnalysis::evaluateCellValue
+        }
+    }
+
+    std::string result;
+    std::size_t copied = 0;
+    bool changed = false;
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        std::string replacement;
+        bool rewritten = false;
+        if (tokens[i].type == TokenType::MatrixReference) {
+            rewritten = rewriteArea(tokens[i].value, move, replacement);
+        } else if (tokens[i].type == TokenType::Formula) {
+            rewritten = rewriteCall(tokens[i].value, move, replacement);
+        }
+        if (rewritten) {
+            result.append(content, copied, positions[i] - copied);
+            result += replacement;
+            copied = positions[i] + tokens[i].value.size();
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return content;
+    }
+    result.append(content, copied, std::string::npos);
+    return result;
+}
+
+/**
+ * @brief Splits "LABEL(argument;...)" at ';'; the criterion of a conditional aggregate is not a reference.
+ */
+bool FormulaRewriter::rewriteCall(const std::string& call, const Move& move, std::string& result) const {
+    std::size_t open = call.find('(');
+    std::size_t close = call.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) {
+        return false;
+    }
+    std::string label = call.substr(call[0] == '@' ? 1 : 0, open - (call[0] == '@' ? 1 : 0));
+    bool conditional = label == "SUMIF" || label == "COUNTIF" || label == "AVERIF";
+
+    result = call.substr(0, open + 1);
+    bool rewritten = false;
+    std::size_t start = open + 1;
+    for (int argument = 0; start <= close; ++argument) {
+        std::size_t end = call.find(';', start);
+        if (end == std::string::npos || end > close) {
+            end = close;
+        }
+        std::string text = call.substr(start, end - start);
+        std::string moved;
+        if (!(conditional && argument == 1) && rewriteArea(text, move, moved)) {
+            result += moved;
+            rewritten = true;
+        } else {
+            result += text;
+        }
+        result += call[end];
+        start = end + 1;
+    }
+    result += call.substr(close + 1);
+    return rewritten;
+}
+
+bool FormulaRewriter::rewriteArea(const std::string& text, const Move& move, std::string& result) {
+    std::string sheet, cells;
+    LexicalAnalysis::splitSheetName(text, sheet, cells);
+    std::size_t dots = cells.find("..");
+    std::string first = cells.substr(0, dots);
+    std::string last = dots == std::string::npos ? first : cells.substr(dots + 2);
+
+    ReferenceArea area;
+    area.sheet = sheet;
+    if (!isCellName(first) || !isCellName(last) ||
+        !LexicalAnalysis::parseCellReference(first, area.startRow, area.startCol) ||
+        !LexicalAnalysis::parseCellReference(last, area.endRow, area.endCol)) {
+        return false;
+    }
+
+    std::string start, end;
+    if (move(area)) {
+        start = formatCell(area.startRow, area.startCol);
+        end = formatCell(area.endRow, area.endCol);
+    }
+    if (start.empty() || end.empty()) {
+        result = "#REF";
+    } else {
+        result = (area.sheet.empty() ? std::string() : area.sheet + "!") + start;
+        if (dots != std::string::npos) {
+            result += ".." + end;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Columns are numbered A..Z, AA..ZZ as in Spreadsheet::getColumnLabel.
+ */
+std::string FormulaRewriter::formatCell(int row, int col) {
+    if (row < 0 || row >= 9999999 || col < 0 || col >= 26 * 27) {
+        return std::string();
+    }
+    std::string name;
+    if (col >= 26) {
+        name += static_cast<char>('A' + col / 26 - 1);
+    }
+    name += static_cast<char>('A' + col % 26);
+    return name + std::to_string(row + 1);
+}
@@ -0,0 +1,303 @@
+#include "LazyEvaluator.h"
+#include "LexicalAnalysis.h"
+
+#include <algorithm>
+#include <utility>
+
+LazyEvaluator::LazyEvaluator(const Workbook& book)
+    : book(book), tokenizer(Tokenizer::createDefault()) {
+    reset();
+}
+
+void LazyEvaluator::reset() {
+    names.clear();
+    versions.clear();
+    sheetRows.clear();
+    sheetCols.clear();
+    sheetStart.assign(1, 0);
+    values.assign(book.getSheetCount(), CellValueCache());
+    for (int sheet = 0; sheet < book.getSheetCount(); ++sheet) {
+        const CellMatrix& data = book.getSheet(sheet);
+        names.push_back(book.getSheetName(sheet));
+        versions.push_back(data.getVersion());
+        sheetRows.push_back(data.getRows());
+        sheetCols.push_back(data.getCols());
+        sheetStart.push_back(sheetStart.back() + static_cast<std::size_t>(data.getRows()) * data.getCols());
+        values[sheet].reset(data.getRows(), data.getCols());
+    }
+    texts.clear();
+    reads.clear();
+    dependents.clear();
+    circular.clear();
+    rangeReaders.clear();
+}
+
+/**
+ * @brief Maps the change log of every sheet to cells as RecalcEngine does; anything else starts over.
+ */
+void LazyEvaluator::sync() {
+    if (book.getSheetCount() != static_cast<int>(names.size())) {
+        reset();
+        return;
+    }
+    std::vector<std::size_t> edited;
+    std::vector<std::pair<int, int>> changes;
+    for (int sheet = 0; sheet < book.getSheetCount(); ++sheet) {
+        const CellMatrix& data = book.getSheet(sheet);
+        if (data.getVersion() == versions[sheet]) {
+            continue;
+        }
+        if (book.getSheetName(sheet) != names[sheet] || data.getRows() != sheetRows[sheet] ||
+            data.getCols() != sheetCols[sheet] || !data.changesSince(versions[sheet], changes)) {
+            reset();
+            return;
+        }
+        for (const auto& change : changes) {
+            edited.push_back(sheetStart[sheet] + static_cast<std::size_t>(change.first) * sheetCols[sheet] + change.second);
+        }
+        changes.clear();
+        versions[sheet] = data.getVersion();
+    }
+    if (!edited.empty()) {
+        invalidate(std::move(edited));
+    }
+}
+
+/**
+ * @brief Collects the edited cells, the computed ranges covering them and their dependents, then forgets them.
+ */
+void LazyEvaluator::invalidate(std::vector<std::size_t> cells) {
+    rangeReaders.refresh();
+    std::vector<std::size_t> readers;
+    for (std::size_t cell : cells) {
+        std::size_t index;
+        int sheet = locate(cell, index);
+        rangeReaders.findCovering(sheet, static_cast<int>(index / sheetCols[sheet]),
+                                  static_cast<int>(index % sheetCols[sheet]), readers);
+    }
+    cells.insert(cells.end(), readers.begin(), readers.end());
+
+    std::unordered_set<std::size_t> seen(cells.begin(), cells.end());
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        std::size_t cell = cells[i];
+        auto found = dependents.find(cell);
+        if (found != dependents.end()) {
+            for (std::size_t dependent : found->second) {
+                if (seen.insert(dependent).second) {
+                    cells.push_back(dependent);
+                }
+            }
+        }
+    }
+
+    for (std::size_t cell : cells) {
+        std::size_t index;
+        int sheet = locate(cell, index);
+        values[sheet].ready[index] = 0;
+        texts.erase(cell);
+        circular.erase(cell);
+        auto cellReads = reads.find(cell);
+        if (cellReads == reads.end()) {
+            continue;
+        }
+        for (std::size_t precedent : cellReads->second.precedents) {
+            auto readersOf = dependents.find(precedent);
+            if (readersOf == dependents.end()) {
+                continue;
+            }
+            std::vector<std::size_t>& list = readersOf->second;
+            auto position = std::find(list.begin(), list.end(), cell);
+            if (position != list.end()) {
+                list.erase(position);
+            }
+            if (list.empty()) {
+                dependents.erase(readersOf);
+            }
+        }
+        for (const auto& range : cellReads->second.ranges) {
+            rangeReaders.remove(range, cell);
+        }
+        reads.erase(cellReads);
+    }
+    rangeReaders.refresh();
+}
+
+const std::string& LazyEvaluator::getValue(int sheet, int row, int col) {
+    static const std::string empty;
+    if (sheet < 0 || sheet >= static_cast<int>(values.size()) ||
+        row < 0 || row >= sheetRows[sheet] || col < 0 || col >= sheetCols[sheet]) {
+        return empty;
+    }
+    std::size_t index = values[sheet].index(row, col);
+    if (!values[sheet].ready[index]) {
+        compute(sheetStart[sheet] + index);
+    }
+    return values[sheet].values[index];
+}
+
+const std::string& LazyEvaluator::getDisplayText(int sheet, int row, int col) {
+    static const std::string empty;
+    if (sheet < 0 || sheet >= static_cast<int>(values.size()) ||
+        row < 0 || row >= sheetRows[sheet] || col < 0 || col >= sheetCols[sheet]) {
+        return empty;
+    }
+    std::size_t cell = sheetStart[sheet] + values[sheet].index(row, col);
+    if (!values[sheet].ready[cell - sheetStart[sheet]]) {
+        compute(cell);
+    }
+    auto text = texts.find(cell);
+    return text != texts.end() ? text->second : empty;
+}
+
+/**
+ * @brief Iterative depth-first search, so that long reference chains cannot exhaust the stack.
+ *
+ * A precedent found on the current path closes a cycle: every cell from it to
+ * the top of the path is on the cycle. Those cells, and every cell reading a
+ * cell of a cycle, get the error a full recalculation gives them.
+ */
+void LazyEvaluator::compute(std::size_t cell) {
+    struct Frame {
+        std::size_t cell;           ///< The cell to evaluate.
+        std::vector<Token> tokens;  ///< Its tokens, analyzed when it was reached.
+        std::size_t next;           ///< Its next precedent to visit.
+    };
+    std::vector<Frame> path;
+    std::unordered_set<std::size_t> onPath;
+    std::unordered_set<std::size_t> onCycle;
+    path.push_back({ cell, analyze(cell), 0 });
+    onPath.insert(cell);
+
+    while (!path.empty()) {
+        Frame& frame = path.back();
+        auto cellReads = reads.find(frame.cell);
+        const std::vector<std::size_t>* precedents = cellReads != reads.end() ? &cellReads->second.precedents : nullptr;
+        if (precedents && frame.next < precedents->size()) {
+            std::size_t precedent = (*precedents)[frame.next++];
+            std::size_t index;
+            int sheet = locate(precedent, index);
+            if (values[sheet].ready[index]) {
+                continue;
+            }
+            if (onPath.count(precedent)) {
+                for (auto member = path.rbegin(); member != path.rend(); ++member) {
+                    onCycle.insert(member->cell);
+                    if (member->cell == precedent) {
+                        break;
+                    }
+                }
+                continue;
+            }
+            path.push_back({ precedent, analyze(precedent), 0 });
+            onPath.insert(precedent);
+            continue;
+        }
+
+        std::size_t index;
+        int sheet = locate(frame.cell, index);
+        const int cols = sheetCols[sheet];
+        int row = static_cast<int>(index / cols);
+        int col = static_cast<int>(index % cols);
+        const CellMatrix& data = book.getSheet(sheet);
+        const std::string& content = data(row, col);
+        bool isCircular = onCycle.count(frame.cell) != 0;
+        if (precedents) {
+            for (std::size_t precedent : *precedents) {
+                isCircular = isCircular || circular.count(precedent) != 0;
+            }
+        }
+
+        if (isCircular) {
+            circular.insert(frame.cell);
+            values[sheet].store(index, "Error: Circular reference");
+        } else if (content.empty()) {
+            values[sheet].store(index, std::string());
+        } else {
+            LexicalAnalysis lexicalAnalyzer(tokenizer, data);
+            lexicalAnalyzer.setValueCache(&values[sheet]);
+            lexicalAnalyzer.setWorkbook(&book, &values);
+            values[sheet].store(index, lexicalAnalyzer.evaluateCellValue(row, col, content, frame.tokens));
+        }
+        if (!content.empty()) {
+            LexicalAnalysis(tokenizer, data).formatCellText(content, values[sheet].values[index], texts[frame.cell]);
+        }
+        ++evaluatedCount;
+        onPath.erase(frame.cell);
+        path.pop_back();
+    }
+}
+
+/**
+ * @brief Resolves references the way DependencyGraph::analyzeCell does, so both see the same precedents.
+ */
+std::vector<Token> LazyEvaluator::analyze(std::size_t cell) {
+    std::size_t index;
+    int sheet = locate(cell, index);
+    const CellMatrix& data = book.getSheet(sheet);
+    const std::string& content = data(static_cast<int>(index / sheetCols[sheet]), static_cast<int>(index % sheetCols[sheet]));
+    if (content.empty()) {
+        return {};
+    }
+    std::vector<Token> tokens = tokenizer.tokenize(content);
+    LexicalAnalysis(tokenizer, data).foldConstants(tokens);
+
+    Reads cellReads;
+    auto sheetIndex = [&](const std::string& reference, std::string& local) {
+        std::string sheetName;
+        return LexicalAnalysis::splitSheetName(reference, sheetName, local) ? book.findSheet(sheetName) : sheet;
+    };
+    auto addReference = [&](const std::string& reference) {
+        std::string local;
+        int target = sheetIndex(reference, local);
+        int row = 0;
+        int col = 0;
+        if (target >= 0 && LexicalAnalysis::parseCellReference(local, row, col) &&
+            row >= 0 && row < sheetRows[target] && col >= 0 && col < sheetCols[target]) {
+            cellReads.precedents.push_back(sheetStart[target] + static_cast<std::size_t>(row) * sheetCols[target] + col);
+        }
+    };
+    auto addRange = [&](const std::string& startCell, const std::string& endCell) {
+        std::string local;
+        CellRange range;
+        range.sheet = sheetIndex(startCell, local);
+        if (range.sheet >= 0 && DependencyGraph::parseRange(local, endCell, range)) {
+            cellReads.ranges.push_back(range);
+        }
+    };
+    auto addValueRange = [&](const std::string& startCell, const std::string& endCell) {
+        std::string local;
+        CellRange range;
+        range.sheet = sheetIndex(startCell, local);
+        if (range.sheet < 0 || !DependencyGraph::parseRange(local, endCell, range)) {
+            return;
+        }
+        const int target = range.sheet;
+        for (int row = std::max(range.startRow, 0); row <= std::min(range.endRow, sheetRows[target] - 1); ++row) {
+            for (int col = std::max(range.startCol, 0); col <= std::min(range.endCol, sheetCols[target] - 1); ++col) {
+                cellReads.precedents.push_back(sheetStart[target] + static_cast<std::size_t>(row) * sheetCols[target] + col);
+            }
+        }
+    };
+    DependencyGraph::scanReferences(tokens, addReference, addRange, addValueRange);
+
+    if (cellReads.precedents.empty() && cellReads.ranges.empty()) {
+        return tokens;
+    }
+    for (std::size_t precedent : cellReads.precedents) {
+        dependents[precedent].push_back(cell);
+    }
+    for (const auto& range : cellReads.ranges) {
+        rangeReaders.add(range, cell);
+    }
+    reads[cell] = std::move(cellReads);
+    return tokens;
+}
+
+/**
+ * @brief Finds the last sheet starting at or before the cell, skipping sheets without cells.
+ */
+int LazyEvaluator::locate(std::size_t cell, std::size_t& index) const {
+    int sheet = static_cast<int>(std::upper_bound(sheetStart.begin(), sheetStart.end(), cell) - sheetStart.begin()) - 1;
+    index = cell - sheetStart[sheet];
+    return sheet;
+}
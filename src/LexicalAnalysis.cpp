@@ -1,11 +1,57 @@
 #include "LexicalAnalysis.h"
+#include "NumberFormat.h"
+
+namespace {
+
+/**
+ * @brief The value of a computation reading a number that overflows or underflows a double.
+ */
+const char* const outOfRangeError = "Error: Number out of range";
+
+/**
+ * @brief Applies a comparison to two values of the same type.
+ */
+template <typename T>
+bool compareWith(Comparison comparison, const T& value, const T& constant) {
+    switch (comparison) {
+        case Comparison::Equal: return value == constant;
+        case Comparison::NotEqual: return !(value == constant);
+        case Comparison::Less: return value < constant;
+        case Comparison::LessEqual: return value <= constant;
+        case Comparison::Greater: return value > constant;
+        case Comparison::GreaterEqual: return value >= constant;
+    }
+    return false;
+}
+
+/**
+ * @brief Splits a criterion such as ">=5" into its comparison and constant; no operator means equality.
+ */
+Comparison parseCriterion(const std::string& criterion, std::string& constant) {
+    static const std::pair<const char*, Comparison> operators[] = {
+        { "<>", Comparison::NotEqual }, { "<=", Comparison::LessEqual }, { ">=", Comparison::GreaterEqual },
+        { "<", Comparison::Less }, { ">", Comparison::Greater }, { "=", Comparison::Equal }
+    };
+    for (const auto& [text, comparison] : operators) {
+        std::size_t length = std::char_traits<char>::length(text);
+        if (criterion.compare(0, length, text) == 0) {
+            constant = criterion.substr(length);
+            return comparison;
+        }
+    }
+    constant = criterion;
+    return Comparison::Equal;
+}
+
+} // namespace
 
 /**
  * @brief Constructor for the LexicalAnalysis class.
  * Initializes the tokenizer and data matrix.
  */
 LexicalAnalysis::LexicalAnalysis(const Tokenizer& tokenizer, const CellMatrix& datain)
-    : tokenizer(tokenizer), data(datain) {}
+    : tokenizer(tokenizer), data(datain), profiler(nullptr), valueCache(nullptr), rangeCache(nullptr),
+      workbook(nullptr), sheetValues(nullptr) {}
 
 /**
  * @brief Analyzes the input expression, tokenizes it, and evaluates the result.
@@ -25,6 +71,9 @@ void LexicalAnalysis::analyze(const std::string& input) {
 
 /**
  * @brief Evaluates a formula from tokens, operating on string values.
+ *
+ * Shunting-yard over + - * / ^ with parentheses. A '-' where an operand is
+ * expected is a unary minus, kept on the operator stack as '~'.
  * 
  * @param tokens The vector of tokens representing the formula.
  * @return std::string The result of the formula evaluation, or an error message.
@@ -32,34 +81,84 @@ void LexicalAnalysis::analyze(const std::string& input) {
 std::string LexicalAnalysis::evaluateFormula(const std::vector<Token>& tokens) {
     std::stack<std::string> values;
     std::stack<char> ops;
+    bool expectOperand = true; // at the start, after an operator and after '('
+
+    // Applies the operator on top of the stack; false if its operands are missing
+    auto reduce = [&]() {
+        char op = ops.top(); ops.pop();
+        if (op == '~') {
+            if (values.empty()) {
+                return false;
+            }
+            std::string val = values.top(); values.pop();
+            values.push(applyOp("0", val, '-'));
+            return true;
+        }
+        if (values.size() < 2) {
+            return false;
+        }
+        std::string val2 = values.top(); values.pop();
+        std::string val1 = values.top(); values.pop();
+        values.push(applyOp(val1, val2, op));
+        return true;
+    };
 
     for (const auto& token : tokens) {
         if (token.type == TokenType::Formula) {
-            std::string result = evaluateLabelFunction(token.value);
+            // The same range, in this formula or another one of the recalculation, is computed once
+            std::string result;
+            if (!rangeCache || !rangeCache->find(token.value, result)) {
+                result = evaluateLabelFunction(token.value);
+                if (rangeCache) rangeCache->store(token.value, result);
+            }
             if (result.find("Error") != std::string::npos) {
                 return result; // Return the error message directly
             }
             values.push(result);
+            expectOperand = false;
         } else if (token.type == TokenType::MatrixReference) {
+            if (profiler) profiler->addReferences(1);
             // Resolve the reference recursively
             std::string cellValue = getCellValue(token.value);
             if (cellValue.find("Error") != std::string::npos) {
                 return cellValue; // Return the error message directly
             }
             values.push(cellValue);
+            expectOperand = false;
         } else if (token.type == TokenType::Number) {
             values.push(token.value); // Push numeric tokens onto the values stack
+            expectOperand = false;
         } else if (token.type == TokenType::Operator) {
-            while (!ops.empty() && precedence(ops.top()) >= precedence(token.value[0])) {
-                if (values.size() < 2) {
-                    return "Error: Invalid expression"; // Not enough operands
+            char op = token.value[0];
+            if (op == '(') {
+                if (!expectOperand) {
+                    return "Error: Invalid expression"; // e.g. "2(3)"
+                }
+                ops.push(op);
+            } else if (op == ')') {
+                while (!ops.empty() && ops.top() != '(') {
+                    if (!reduce()) {
+                        return "Error: Invalid expression"; // Not enough operands
+                    }
+                }
+                if (ops.empty()) {
+                    return "Error: Mismatched parentheses";
                 }
-                std::string val2 = values.top(); values.pop();
-                std::string val1 = values.top(); values.pop();
-                char op = ops.top(); ops.pop();
-                values.push(applyOp(val1, val2, op));
+                ops.pop();
+                expectOperand = false;
+            } else if (op == '-' && expectOperand) {
+                ops.push('~'); // Unary minus applies to the operand that follows
+            } else {
+                // Equal precedence applies first, except for the right-associative '^'
+                while (!ops.empty() && ops.top() != '(' &&
+                       (precedence(ops.top()) > precedence(op) || (precedence(ops.top()) == precedence(op) && op != '^'))) {
+                    if (!reduce()) {
+                        return "Error: Invalid expression"; // Not enough operands
+                    }
+                }
+                ops.push(op);
+                expectOperand = true;
             }
-            ops.push(token.value[0]);
         } else {
             return "Error: Unknown token type";
         }
@@ -67,13 +166,12 @@ std::string LexicalAnalysis::evaluateFormula(const std::vector<Token>& tokens) {
 
     // Process remaining operators in the stack
     while (!ops.empty()) {
-        if (values.size() < 2) {
+        if (ops.top() == '(') {
+            return "Error: Mismatched parentheses";
+        }
+        if (!reduce()) {
             return "Error: Invalid expression"; // Not enough operands
         }
-        std::string val2 = values.top(); values.pop();
-        std::string val1 = values.top(); values.pop();
-        char op = ops.top(); ops.pop();
-        values.push(applyOp(val1, val2, op));
     }
 
     if (values.size() != 1) {
@@ -84,42 +182,363 @@ std::string LexicalAnalysis::evaluateFormula(const std::vector<Token>& tokens) {
 }
 
 /**
- * @brief Evaluates a function label expression such as SUM, @SUM, STDDEV, or @STDDEV.
+ * @brief Folds leading constant operands of each product chain, then leading constant terms of the sum.
+ *
+ * Formulas with parentheses or unary minus are left to the evaluator.
+ */
+void LexicalAnalysis::foldConstants(std::vector<Token>& tokens) {
+    // Only operand (operator operand)* sequences are rewritten; anything else is an error left to evaluateFormula
+    if (tokens.size() < 3 || tokens.size() % 2 == 0) {
+        return;
+    }
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        TokenType type = tokens[i].type;
+        bool valid = i % 2 == 0 ? type == TokenType::Number || type == TokenType::MatrixReference || type == TokenType::Formula
+                                : type == TokenType::Operator && tokens[i].value != "(" && tokens[i].value != ")";
+        if (!valid) {
+            return;
+        }
+    }
+
+    // Product chains are evaluated left to right before the + and - between them
+    bool singleTerm = true;
+    for (std::size_t i = 1; i < tokens.size(); i += 2) {
+        singleTerm = singleTerm && tokens[i].value != "+" && tokens[i].value != "-";
+    }
+    std::size_t term = 0;
+    while (term < tokens.size()) {
+        std::size_t end = term + 1;
+        while (end < tokens.size() && tokens[end].value != "+" && tokens[end].value != "-") {
+            end += 2;
+        }
+        std::size_t constantEnd = term;
+        // A number raised to a power is not constant unless its exponent is
+        while (constantEnd < end && tokens[constantEnd].type == TokenType::Number &&
+               (constantEnd + 1 == tokens.size() || tokens[constantEnd + 1].value != "^")) {
+            constantEnd += 2;
+        }
+        if (singleTerm && constantEnd > end) {
+            constantEnd -= 2; // keep the last operation of a constant formula
+        }
+        // Two or more constant operands: fold them and the operators between them
+        if (constantEnd >= term + 4 && foldRun(tokens, term, constantEnd - 1)) {
+            end -= constantEnd - term - 2;
+        }
+        term = end + 1;
+    }
+
+    // Terms are now single numbers when constant; fold the leading ones, keeping the last operation
+    std::size_t constantEnd = 0;
+    while (constantEnd < tokens.size() && tokens[constantEnd].type == TokenType::Number &&
+           (constantEnd + 1 == tokens.size() || tokens[constantEnd + 1].value == "+" || tokens[constantEnd + 1].value == "-")) {
+        constantEnd += 2;
+    }
+    if (constantEnd > tokens.size()) {
+        constantEnd -= 2;
+    }
+    if (constantEnd >= 4) {
+        foldRun(tokens, 0, constantEnd - 1);
+    }
+}
+
+/**
+ * @brief Evaluates the run as a formula of its own; its value is what the whole formula would compute for it.
+ */
+bool LexicalAnalysis::foldRun(std::vector<Token>& tokens, std::size_t first, std::size_t last) {
+    std::string value = evaluateFormula(std::vector<Token>(tokens.begin() + first, tokens.begin() + last));
+    if (value.find("Error") != std::string::npos) {
+        return false;
+    }
+    tokens[first] = { TokenType::Number, value };
+    tokens.erase(tokens.begin() + first + 1, tokens.begin() + last);
+    return true;
+}
+
+/**
+ * @brief Evaluates a cell the way it is shown in the spreadsheet view.
+ */
+std::string LexicalAnalysis::evaluateCellText(int row, int col) {
+    const std::string& cellContent = data(row, col);
+    if (cellContent.empty()) {
+        return cellContent;
+    }
+    return formatCellText(cellContent, evaluateCellValue(row, col, cellContent, tokenizer.tokenize(cellContent)));
+}
+
+/**
+ * @brief Evaluates a function label expression such as SUM, @SUM, STDDEV, @STDDEV or LOOKUP.
  */
 std::string LexicalAnalysis::evaluateLabelFunction(const std::string& labelExpression) {
-    std::regex labelRegex("(SUM|@SUM|STDDEV|@STDDEV|AVER|@AVER|MAX|@MAX|MIN|@MIN)\\(([A-Z]{1,2}[0-9]{1,3})\\.\\.([A-Z]{1,2}[0-9]{1,3})\\)");
+    LookupCall lookup;
+    if (parseLookup(labelExpression, lookup)) {
+        return calculateLookupFunction(lookup);
+    }
+
+    ConditionalCall conditional;
+    if (parseConditional(labelExpression, conditional)) {
+        return calculateConditionalFunction(conditional);
+    }
+
+    std::string label, startCell, endCell;
+    if (parseRangeFunction(labelExpression, label, startCell, endCell)) {
+        return calculateRangeFunction(label, startCell, endCell);
+    }
+
+    return "Error: Invalid formula label expression";
+}
+
+/**
+ * @brief Matches the range function syntax; the same regex is shared by every thread.
+ */
+bool LexicalAnalysis::parseRangeFunction(const std::string& expression, std::string& label, std::string& startCell, std::string& endCell) {
+    static const std::regex labelRegex("@?(SUM|STDDEV|AVER|MAX|MIN)\\(((?:[A-Za-z_]\\w*!)?[A-Z]{1,2}[0-9]{1,7})\\.\\.([A-Z]{1,2}[0-9]{1,7})\\)");
     std::smatch match;
+    if (!std::regex_match(expression, match, labelRegex)) {
+        return false;
+    }
+    label = match[1];     // Function label, without its '@'
+    startCell = match[2]; // Start cell, possibly on another sheet
+    endCell = match[3];   // End cell
+    return true;
+}
 
-    if (std::regex_match(labelExpression, match, labelRegex)) {
-        std::string label = match[1];      // Function label (SUM, @SUM, etc.)
-        std::string startCell = match[2]; // Start cell
-        std::string endCell = match[3];   // End cell
 
-        // Normalize the label to ignore "@" prefix for consistency
-        if (label[0] == '@') {
-            label = label.substr(1); // Remove '@'
+/**
+ * @brief Matches the LOOKUP and MATCH syntax; the same regex is shared by every thread.
+ */
+bool LexicalAnalysis::parseLookup(const std::string& expression, LookupCall& call) {
+    static const std::regex lookupRegex("@?(LOOKUP|MATCH)\\(((?:[A-Za-z_]\\w*!)?-?[\\w.]+);((?:[A-Za-z_]\\w*!)?[A-Z]{1,2}[0-9]{1,7})\\.\\.([A-Z]{1,2}[0-9]{1,7})"
+                                        "(;((?:[A-Za-z_]\\w*!)?[A-Z]{1,2}[0-9]{1,7})\\.\\.([A-Z]{1,2}[0-9]{1,7}))?\\)");
+    std::smatch match;
+    if (!std::regex_match(expression, match, lookupRegex)) {
+        return false;
+    }
+    call.label = match[1];
+    call.key = match[2];
+    call.keyStart = match[3];
+    call.keyEnd = match[4];
+    call.resultStart = match[6];
+    call.resultEnd = match[7];
+    // MATCH has no result column and LOOKUP needs one
+    return (call.label == "LOOKUP") == match[5].matched;
+}
+
+/**
+ * @brief Matches the SUMIF, COUNTIF and AVERIF syntax; the same regex is shared by every thread.
+ */
+bool LexicalAnalysis::parseConditional(const std::string& expression, ConditionalCall& call) {
+    static const std::regex conditionalRegex("@?(SUMIF|COUNTIF|AVERIF)\\(((?:[A-Za-z_]\\w*!)?[A-Z]{1,2}[0-9]{1,7})\\.\\.([A-Z]{1,2}[0-9]{1,7});([^;()]*)"
+                                             "(;((?:[A-Za-z_]\\w*!)?[A-Z]{1,2}[0-9]{1,7})\\.\\.([A-Z]{1,2}[0-9]{1,7}))?\\)");
+    std::smatch match;
+    if (!std::regex_match(expression, match, conditionalRegex)) {
+        return false;
+    }
+    call.label = match[1];
+    call.testStart = match[2];
+    call.testEnd = match[3];
+    call.criterion = match[4];
+    call.valueStart = match[6];
+    call.valueEnd = match[7];
+    // COUNTIF counts the tested cells themselves
+    return call.label != "COUNTIF" || !match[5].matched;
+}
+
+/**
+ * @brief Builds the mask of the tested cells satisfying the criterion, then reduces the aggregated cells through it.
+ */
+std::string LexicalAnalysis::calculateConditionalFunction(const ConditionalCall& call) {
+    std::string testStart, valueStart;
+    const CellMatrix* testCells = sheetOf(call.testStart, testStart);
+    int firstRow, firstCol, lastRow, lastCol;
+    if (!testCells || !parseCellReference(testStart, firstRow, firstCol) || !parseCellReference(call.testEnd, lastRow, lastCol) ||
+        firstRow < 0 || lastRow >= testCells->getRows() || firstCol < 0 || lastCol >= testCells->getCols() ||
+        firstRow > lastRow || firstCol > lastCol) {
+        return "Error: Invalid cell range " + call.testStart + " to " + call.testEnd;
+    }
+    if (firstRow != lastRow && firstCol != lastCol) {
+        return "Error: Function can only operate on the same column or row";
+    }
+    bool vertical = firstCol == lastCol;
+    std::size_t length = static_cast<std::size_t>(lastRow - firstRow + lastCol - firstCol + 1);
+
+    // The aggregated range has the shape of the tested one, on the sheet its first cell names
+    const CellMatrix* valueCells = testCells;
+    int valueRow = firstRow, valueCol = firstCol;
+    if (!call.valueStart.empty()) {
+        int endRow, endCol;
+        valueCells = sheetOf(call.valueStart, valueStart);
+        if (!valueCells || !parseCellReference(valueStart, valueRow, valueCol) || !parseCellReference(call.valueEnd, endRow, endCol) ||
+            valueRow < 0 || endRow >= valueCells->getRows() || valueCol < 0 || endCol >= valueCells->getCols()) {
+            return "Error: Invalid cell range " + call.valueStart + " to " + call.valueEnd;
+        }
+        if (endRow - valueRow != lastRow - firstRow || endCol - valueCol != lastCol - firstCol) {
+            return "Error: Aggregated range must have the shape of the tested range";
         }
+    }
+    if (profiler) profiler->addReferences(call.valueStart.empty() ? length : 2 * length);
+
+    std::string constant;
+    Comparison comparison = parseCriterion(call.criterion, constant);
+    TextNumber constantNumber = NumberFormat::parse(constant);
+    bool numericCriterion = constantNumber.numeric && !constantNumber.outOfRange;
+
+    // A numeric criterion on a typed column is tested 64 rows at a time
+    std::vector<std::uint64_t> mask;
+    const NumericColumn* tested = vertical && numericCriterion ? testCells->findNumericColumn(firstCol) : nullptr;
+    if (tested && tested->isExact(firstRow, lastRow)) {
+        tested->compare(firstRow, lastRow, comparison, constantNumber.value, mask);
+    } else {
+        mask.assign((length + 63) / 64, 0);
+        for (std::size_t i = 0; i < length; ++i) {
+            int row = vertical ? firstRow + static_cast<int>(i) : firstRow;
+            int col = vertical ? firstCol : firstCol + static_cast<int>(i);
+            const TextNumber& number = testCells->getNumber(row, col);
+            bool satisfied;
+            if (numericCriterion && number.outOfRange) {
+                return outOfRangeError;
+            }
+            if (numericCriterion) {
+                satisfied = number.numeric ? compareWith(comparison, number.value, constantNumber.value)
+                                           : comparison == Comparison::NotEqual;
+            } else if (number.numeric) {
+                satisfied = comparison == Comparison::NotEqual;
+            } else {
+                const std::string& text = (*testCells)(row, col);
+                bool blank = text.find_first_not_of(' ') == std::string::npos;
+                if (comparison == Comparison::Equal || comparison == Comparison::NotEqual) {
+                    satisfied = compareWith(comparison, blank ? std::string() : text, constant);
+                } else {
+                    satisfied = !blank && compareWith(comparison, text, constant);
+                }
+            }
+            if (satisfied) {
+                mask[i / 64] |= std::uint64_t(1) << (i % 64);
+            }
+        }
+    }
 
-        return calculateRangeFunction(label, startCell, endCell);
+    if (call.label == "COUNTIF") {
+        return std::to_string(NumericColumn::countSet(mask));
     }
 
-    return "Error: Invalid formula label expression";
+    double sum = 0.0;
+    std::size_t count = 0;
+    int valueEnd = valueRow + lastRow - firstRow;
+    const NumericColumn* values = vertical ? valueCells->findNumericColumn(valueCol) : nullptr;
+    if (values && values->isExact(valueRow, valueEnd)) {
+        sum = values->maskedSum(valueRow, mask);
+        count = values->maskedCount(valueRow, mask);
+    } else {
+        for (std::size_t i = 0; i < length; ++i) {
+            if (!((mask[i / 64] >> (i % 64)) & 1)) {
+                continue;
+            }
+            const TextNumber& number = vertical ? valueCells->getNumber(valueRow + static_cast<int>(i), valueCol)
+                                                : valueCells->getNumber(valueRow, valueCol + static_cast<int>(i));
+            if (number.outOfRange) {
+                return outOfRangeError;
+            }
+            if (number.numeric) {
+                sum += number.value;
+                ++count;
+            }
+        }
+    }
+
+    if (call.label == "SUMIF") {
+        return NumberFormat::toString(sum);
+    }
+    if (count == 0) {
+        return "Error: Division by zero";
+    }
+    return NumberFormat::toString(sum / count);
 }
 
+/**
+ * @brief Looks the key up in the column's index, then maps the row into the result column.
+ */
+std::string LexicalAnalysis::calculateLookupFunction(const LookupCall& call) {
+    // Each column is on the sheet its first cell names, this sheet by default
+    std::string keyStart, resultStart;
+    const CellMatrix* keyCells = sheetOf(call.keyStart, keyStart);
+    int keyStartRow, keyStartCol, keyEndRow, keyEndCol;
+    if (!keyCells || !parseCellReference(keyStart, keyStartRow, keyStartCol) || !parseCellReference(call.keyEnd, keyEndRow, keyEndCol) ||
+        keyStartRow < 0 || keyEndRow >= keyCells->getRows() || keyStartCol < 0 || keyStartCol >= keyCells->getCols() ||
+        keyStartRow > keyEndRow) {
+        return "Error: Invalid cell range " + call.keyStart + " to " + call.keyEnd;
+    }
+    if (keyStartCol != keyEndCol) {
+        return "Error: Lookup range must be a single column";
+    }
+
+    int resultStartRow = 0, resultCol = 0;
+    const CellMatrix* resultCells = &data;
+    if (call.label == "LOOKUP") {
+        int resultEndRow, resultEndCol;
+        resultCells = sheetOf(call.resultStart, resultStart);
+        if (!resultCells || !parseCellReference(resultStart, resultStartRow, resultCol) ||
+            !parseCellReference(call.resultEnd, resultEndRow, resultEndCol) ||
+            resultStartRow < 0 || resultEndRow >= resultCells->getRows() || resultCol < 0 || resultCol >= resultCells->getCols()) {
+            return "Error: Invalid cell range " + call.resultStart + " to " + call.resultEnd;
+        }
+        if (resultCol != resultEndCol || resultEndRow - resultStartRow != keyEndRow - keyStartRow) {
+            return "Error: Result range must be a single column as long as the lookup range";
+        }
+    }
+
+    // A reference is looked up by its value, anything else literally
+    std::string key = call.key;
+    std::string keySheet, keyCell;
+    int refRow, refCol;
+    splitSheetName(call.key, keySheet, keyCell);
+    if (parseCellReference(keyCell, refRow, refCol)) {
+        if (profiler) profiler->addReferences(1);
+        key = getCellValue(call.key);
+        if (key.find("Error") != std::string::npos) {
+            return key;
+        }
+    }
+
+    if (profiler) profiler->addReferences(1);
+    int row = keyCells->getLookupIndex(keyStartCol)->find(key, keyStartRow, keyEndRow);
+    if (row < 0) {
+        return "Error: Value not found " + key;
+    }
+    if (call.label == "MATCH") {
+        return std::to_string(row - keyStartRow + 1);
+    }
+    // The result cell is read by value, on the sheet the result column names
+    std::string resultSheet, resultCell;
+    splitSheetName(call.resultStart, resultSheet, resultCell);
+    std::string resultReference = call.resultStart.substr(0, call.resultStart.size() - resultCell.size()) +
+                                  resultCell.substr(0, resultCell.find_first_of("0123456789")) +
+                                  std::to_string(resultStartRow + row - keyStartRow + 1);
+    if (profiler) profiler->addReferences(1);
+    return getCellValue(resultReference);
+}
 
 /**
  * @brief Calculates a function over a specified range of cells.
  */
 std::string LexicalAnalysis::calculateRangeFunction(const std::string& label, const std::string& startCell, const std::string& endCell) {
+    // The range is on the sheet its start cell names; a named end cell must name the same sheet
+    std::string start, end;
+    const CellMatrix* sheet = sheetOf(startCell, start);
+    const CellMatrix* endSheet = sheetOf(endCell, end);
+    if (endCell.find('!') == std::string::npos) {
+        endSheet = sheet;
+    }
+
     // Hücrelerin satır ve sütun koordinatlarını al
-    int startCol = startCell[0] - 'A'; // Sütun
-    int startRow = std::stoi(startCell.substr(1)) - 1; // Satır
-    int endCol = endCell[0] - 'A'; // Sütun
-    int endRow = std::stoi(endCell.substr(1)) - 1; // Satır
+    int startRow, startCol, endRow, endCol;
+    if (!sheet || endSheet != sheet || !parseCellReference(start, startRow, startCol) || !parseCellReference(end, endRow, endCol)) {
+        return "Error: Invalid cell range " + startCell + " to " + endCell;
+    }
+    const CellMatrix& cells = *sheet;
 
     // Invalid cell range check
-    if (startRow < 0 || startRow >= data.getRows() || endRow < 0 || endRow >= data.getRows() ||
-        startCol < 0 || startCol >= data.getCols() || endCol < 0 || endCol >= data.getCols()) {
+    if (startRow < 0 || startRow >= cells.getRows() || endRow < 0 || endRow >= cells.getRows() ||
+        startCol < 0 || startCol >= cells.getCols() || endCol < 0 || endCol >= cells.getCols()) {
         return "Error: Invalid cell range " + startCell + " to " + endCell;
     }
 
@@ -128,42 +547,58 @@ std::string LexicalAnalysis::calculateRangeFunction(const std::string& label, co
         return "Error: Function can only operate on the same column or row";
     }
 
-    std::vector<std::string> values;
+    // Columns of a ColumnMajor sheet are aggregated from their numeric array
+    if (startCol == endCol) {
+        const NumericColumn* column = cells.findNumericColumn(startCol);
+        if (column && column->isExact(startRow, endRow) && column->count(startRow, endRow) > 0) {
+            if (profiler) profiler->addReferences(endRow - startRow + 1);
+            return calculateColumnFunction(label, *column, startRow, endRow);
+        }
+    }
+
+    // Numeric cells were classified when their text was stored, so no text is parsed here
+    std::size_t cellCount = 0;
+    bool outOfRange = false;
+    std::vector<double> doubleValues;
+    auto addCell = [&](int row, int col) {
+        const TextNumber& number = cells.getNumber(row, col);
+        if (number.numeric) {
+            doubleValues.push_back(number.value);
+            outOfRange = outOfRange || number.outOfRange;
+        }
+        ++cellCount;
+    };
 
     // Process cells in the same column
     if (startCol == endCol) {
         for (int row = startRow; row <= endRow; ++row) {
-            values.push_back(data(row,startCol));
+            addCell(row, startCol);
         }
     }
     // Process cells in the same row
     else if (startRow == endRow) {
         for (int col = startCol; col <= endCol; ++col) {
-            values.push_back(data(startRow,col));
+            addCell(startRow, col);
         }
     }
 
-    if (values.empty()) {
+    if (cellCount == 0) {
         return "Error: No valid cells in the specified range.";
     }
-
-    //Extract numeric values    
-    std::vector<double> doubleValues;
-    for (const auto& val : values) {
-        if (isNumeric(val)) {
-            doubleValues.push_back(std::stod(val));
-        }
+    if (outOfRange) {
+        return outOfRangeError;
     }
+    if (profiler) profiler->addReferences(cellCount);
 
     // Function calculation    
     if (label == "SUM") {
-        return std::to_string(std::accumulate(doubleValues.begin(), doubleValues.end(), 0.0));
+        return NumberFormat::toString(std::accumulate(doubleValues.begin(), doubleValues.end(), 0.0));
     } else if (label == "AVER") {
-        return std::to_string(std::accumulate(doubleValues.begin(), doubleValues.end(), 0.0) / doubleValues.size());
+        return NumberFormat::toString(std::accumulate(doubleValues.begin(), doubleValues.end(), 0.0) / doubleValues.size());
     } else if (label == "MAX") {
-        return std::to_string(*std::max_element(doubleValues.begin(), doubleValues.end()));
+        return NumberFormat::toString(*std::max_element(doubleValues.begin(), doubleValues.end()));
     } else if (label == "MIN") {
-        return std::to_string(*std::min_element(doubleValues.begin(), doubleValues.end()));
+        return NumberFormat::toString(*std::min_element(doubleValues.begin(), doubleValues.end()));
     } else if (label == "STDDEV") {
         //Calculate average        
         double mean = std::accumulate(doubleValues.begin(), doubleValues.end(), 0.0) / doubleValues.size();
@@ -176,7 +611,28 @@ std::string LexicalAnalysis::calculateRangeFunction(const std::string& label, co
         variance /= doubleValues.size();
 
         // Standard deviation (square root)
-        return std::to_string(std::sqrt(variance));
+        return NumberFormat::toString(std::sqrt(variance));
+    }
+
+    return "Error: Unknown function label " + label;
+}
+
+/**
+ * @brief Applies a range function to the numbers of a column, giving the same result as the text scan.
+ */
+std::string LexicalAnalysis::calculateColumnFunction(const std::string& label, const NumericColumn& column, int startRow, int endRow) {
+    double count = static_cast<double>(column.count(startRow, endRow));
+    if (label == "SUM") {
+        return NumberFormat::toString(column.sum(startRow, endRow));
+    } else if (label == "AVER") {
+        return NumberFormat::toString(column.sum(startRow, endRow) / count);
+    } else if (label == "MAX") {
+        return NumberFormat::toString(column.max(startRow, endRow));
+    } else if (label == "MIN") {
+        return NumberFormat::toString(column.min(startRow, endRow));
+    } else if (label == "STDDEV") {
+        double mean = column.sum(startRow, endRow) / count;
+        return NumberFormat::toString(std::sqrt(column.sumSquaredDeviations(startRow, endRow, mean) / count));
     }
 
     return "Error: Unknown function label " + label;
@@ -186,33 +642,58 @@ std::string LexicalAnalysis::calculateRangeFunction(const std::string& label, co
  * @brief Retrieves the value of a matrix cell based on its reference.
  */
 std::string LexicalAnalysis::getCellValue(const std::string& cell) {
-    int col = 0;
-    size_t rowIndex = 0;
-
-    // Calculate the column index (e.g., "A" -> 0, "AA" -> 26, "ZZ" -> 701)
-    while (rowIndex < cell.size() && isalpha(cell[rowIndex])) {
-        col = col * 26 + (cell[rowIndex] - 'A' + 1);
-        rowIndex++;
+    // A cell of another sheet is evaluated there, where its own references point
+    std::size_t bang = cell.find('!');
+    if (bang != std::string::npos) {
+        int sheet = workbook ? workbook->findSheet(cell.substr(0, bang)) : -1;
+        if (sheet < 0) {
+            return "Error: Invalid cell reference " + cell;
+        }
+        LexicalAnalysis sheetAnalysis(tokenizer, workbook->getSheet(sheet));
+        sheetAnalysis.setWorkbook(workbook, sheetValues);
+        sheetAnalysis.setValueCache(sheetValues ? &(*sheetValues)[sheet] : nullptr);
+        sheetAnalysis.setProfiler(profiler);
+        return sheetAnalysis.getCellValue(cell.substr(bang + 1));
     }
-    col--; // Convert to 0-based indexing
 
-    // Extract and calculate the row index
-    int row = std::stoi(cell.substr(rowIndex)) - 1;
+    int row = 0;
+    int col = 0;
 
     // Validate that the row and column are within matrix bounds
-    if (row < 0 || row >= data.getRows() || col < 0 || col >= data.getCols()) {
+    if (!parseCellReference(cell, row, col) || row < 0 || row >= data.getRows() || col < 0 || col >= data.getCols()) {
         return "Error: Invalid cell reference " + cell;
     }
 
+    // Cells computed earlier in this recalculation are not evaluated again
+    if (valueCache) {
+        if (const std::string* cached = valueCache->find(row, col)) {
+            return *cached;
+        }
+    }
+
+    EvaluationProfiler::Scope profileScope(profiler, row, col);
     std::string cellContent = data(row,col);
-    std::vector<Token> tokens = tokenizer.tokenize(cellContent);
-    for(int i=0;i<tokens.size();++i)
+    return evaluateCellValue(row, col, cellContent, tokenizer.tokenize(cellContent));
+}
+
+/**
+ * @brief Computes the value of a cell from its already tokenized content.
+ */
+std::string LexicalAnalysis::evaluateCellValue(int row, int col, const std::string& cellContent, const std::vector<Token>& tokens) {
+    for(size_t i=0;i<tokens.size();++i)
     {
         if(tokens[i].type == TokenType::Unknown)
             return cellContent;
     }
-    
-    if(cellContent!=cell)
+
+    // A cell holding its own name (e.g. "A1" in A1) is kept as text
+    int refRow = -1;
+    int refCol = -1;
+    bool selfReference = tokens.size() == 1 && tokens[0].type == TokenType::MatrixReference &&
+                         cellContent == tokens[0].value && parseCellReference(cellContent, refRow, refCol) &&
+                         refRow == row && refCol == col;
+
+    if(!selfReference)
     {
         // If the cell content is a formula or reference, process it recursively
         if (!tokens.empty() && tokens[0].type == TokenType::Formula) {
@@ -230,25 +711,115 @@ std::string LexicalAnalysis::getCellValue(const std::string& cell) {
     return cellContent; // Return raw value if it's not a formula or reference
 }
 
+/**
+ * @brief Derives the displayed text of a cell from its raw content and computed value.
+ */
+std::string LexicalAnalysis::formatCellText(const std::string& cellContent, const std::string& value) {
+    std::string text;
+    formatCellText(cellContent, value, text);
+    return text;
+}
+
+void LexicalAnalysis::formatCellText(const std::string& cellContent, const std::string& value, std::string& text) {
+    if (value.find("Error") != std::string::npos) {
+        text = cellContent; // Invalid formulas or references show their text
+    } else {
+        TextNumber number = NumberFormat::parse(value);
+        if (number.numeric && number.outOfRange) {
+            text = cellContent;
+        } else if (number.numeric) {
+            char buffer[NumberFormat::bufferSize];
+            text.assign(buffer, NumberFormat::writeDisplay(number.value, buffer));
+        } else {
+            text = value;
+        }
+    }
+}
+
+/**
+ * @brief Converts a cell reference such as "B12" to 0-based row and column indices.
+ */
+bool LexicalAnalysis::parseCellReference(const std::string& cell, int& row, int& col) {
+    col = 0;
+    size_t rowIndex = 0;
+
+    // Calculate the column index (e.g., "A" -> 0, "AA" -> 26, "ZZ" -> 701)
+    while (rowIndex < cell.size() && isalpha(cell[rowIndex])) {
+        col = col * 26 + (cell[rowIndex] - 'A' + 1);
+        rowIndex++;
+    }
+    col--; // Convert to 0-based indexing
+
+    if (rowIndex == 0 || rowIndex >= cell.size() || cell.size() - rowIndex > 9) {
+        return false;
+    }
+    for (size_t i = rowIndex; i < cell.size(); ++i) {
+        if (!isdigit(cell[i])) {
+            return false;
+        }
+    }
+
+    // Extract and calculate the row index
+    row = std::stoi(cell.substr(rowIndex)) - 1;
+    return true;
+}
+
+/**
+ * @brief Splits "Sheet2!A1" into "Sheet2" and "A1"; a reference without '!' has an empty sheet name.
+ */
+bool LexicalAnalysis::splitSheetName(const std::string& reference, std::string& sheetName, std::string& cell) {
+    std::size_t bang = reference.find('!');
+    if (bang == std::string::npos) {
+        sheetName.clear();
+        cell = reference;
+        return false;
+    }
+    sheetName = reference.substr(0, bang);
+    cell = reference.substr(bang + 1);
+    return true;
+}
+
+/**
+ * @brief Finds the cells a possibly sheet-qualified reference points into.
+ */
+const CellMatrix* LexicalAnalysis::sheetOf(const std::string& reference, std::string& cell) const {
+    std::string sheetName;
+    if (!splitSheetName(reference, sheetName, cell)) {
+        return &data;
+    }
+    int sheet = workbook ? workbook->findSheet(sheetName) : -1;
+    return sheet < 0 ? nullptr : &workbook->getSheet(sheet);
+}
+
 /**
  * @brief Applies an arithmetic operation to two string values.
  */
 
 std::string LexicalAnalysis::applyOp(const std::string& a, const std::string& b, char op) {
-    if (!isNumeric(a) || !isNumeric(b)) {
+    TextNumber numberA = NumberFormat::parse(a);
+    TextNumber numberB = NumberFormat::parse(b);
+    if (!numberA.numeric || !numberB.numeric) {
         return "Error: Non-numeric value in operation";
     }
 
-    double doubleA = std::stod(a);
-    double doubleB = std::stod(b);
+    if (numberA.outOfRange || numberB.outOfRange) {
+        return outOfRangeError;
+    }
+    double doubleA = numberA.value;
+    double doubleB = numberB.value;
 
     switch (op) {
-        case '+': return std::to_string(doubleA + doubleB);
-        case '-': return std::to_string(doubleA - doubleB);
-        case '*': return std::to_string(doubleA * doubleB);
+        case '+': return NumberFormat::toString(doubleA + doubleB);
+        case '-': return NumberFormat::toString(doubleA - doubleB);
+        case '*': return NumberFormat::toString(doubleA * doubleB);
         case '/':
             if (doubleB == 0) return "Error: Division by zero";
-            return std::to_string(doubleA / doubleB);
+            return NumberFormat::toString(doubleA / doubleB);
+        case '^': {
+            double power = std::pow(doubleA, doubleB);
+            if (std::isnan(power)) return "Error: Invalid power"; // e.g. a negative base with a fractional exponent
+            return NumberFormat::toString(power);
+        }
         default:
             return "Error: Unknown operator";
     }
@@ -258,7 +829,7 @@ std::string LexicalAnalysis::applyOp(const std::string& a, const std::string& b,
  * @brief Checks if a string represents a numeric value.
  */
 bool LexicalAnalysis::isNumeric(const std::string& str) {
-    return std::regex_match(str, std::regex("^-?\\d*\\.?\\d+([eE][-+]?\\d+)?$"));
+    return NumberFormat::parse(str).numeric;
 }
 
 /**
@@ -267,6 +838,8 @@ bool LexicalAnalysis::isNumeric(const std::string& str) {
 int LexicalAnalysis::precedence(char op) {
     if (op == '+' || op == '-') return 1;
     if (op == '*' || op == '/') return 2;
+    if (op == '~') return 3; // unary minus: -2*3 is (-2)*3 but -2^2 is -(2^2)
+    if (op == '^') return 4;
     return 0;
 }
 
@@ -274,19 +847,20 @@ int LexicalAnalysis::precedence(char op) {
  * @brief Formats a decimal string by trimming unnecessary trailing zeros and ensuring precision.
  */
 std::string LexicalAnalysis::formatDecimal(const std::string& number) {
-double value = std::stod(number); // Convert string to double
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(15) << value; // Format with maximum precision
-    std::string formatted = oss.str();
-
-    // Trim trailing zeros
-    size_t decimalPos = formatted.find('.');
-    if (decimalPos != std::string::npos) {
-        size_t end = formatted.find_last_not_of('0');
-        if (end == decimalPos) {
-            end--; // Remove the dot if no fractional part remains
-        }
-        formatted = formatted.substr(0, end + 1);
-    }
+    std::string formatted;
+    formatDecimal(number, formatted);
     return formatted;
 }
+
+/**
+ * @brief Formats into a stack buffer; only the assignment to the caller's string may allocate.
+ */
+void LexicalAnalysis::formatDecimal(const std::string& number, std::string& formatted) {
+    TextNumber parsed = NumberFormat::parse(number);
+    if (parsed.outOfRange) {
+        formatted = outOfRangeError;
+        return;
+    }
+    char buffer[NumberFormat::bufferSize];
+    formatted.assign(buffer, NumberFormat::writeDisplay(parsed.value, buffer));
+}
@@ -0,0 +1,50 @@
+#include "LookupIndex.h"
+#include "NumberFormat.h"
+
+#include <cstring>
+
+/**
+ * @brief Numbers become '#' and the bytes of their value; other texts get a ':' prefix.
+ */
+std::string LookupIndex::normalize(const std::string& text) {
+    TextNumber number = NumberFormat::parse(text);
+    if (number.numeric && !number.outOfRange) {
+        double value = number.value;
+        if (value == 0.0) {
+            value = 0.0; // -0 and 0 are the same key
+        }
+        std::string key(1 + sizeof(double), '#');
+        std::memcpy(&key[1], &value, sizeof(double));
+        return key;
+    }
+    return ":" + text;
+}
+
+/**
+ * @brief Puts the row in front of its key's chain, which keeps chains in row order when adding bottom-up.
+ */
+void LookupIndex::add(int row, const std::string& text) {
+    if (text.empty()) {
+        return;
+    }
+    if (static_cast<int>(nextRows.size()) <= row) {
+        nextRows.resize(row + 1, -1);
+    }
+    auto inserted = firstRows.emplace(normalize(text), row);
+    if (!inserted.second) {
+        nextRows[row] = inserted.first->second;
+        inserted.first->second = row;
+    }
+}
+
+int LookupIndex::find(const std::string& key, int firstRow, int lastRow) const {
+    auto found = firstRows.find(normalize(key));
+    if (found == firstRows.end()) {
+        return -1;
+    }
+    int row = found->second;
+    while (row != -1 && row < firstRow) {
+        row = nextRows[row];
+    }
+    return row != -1 && row <= lastRow ? row : -1;
+}
@@ -0,0 +1,119 @@
+#include "NumberFormat.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+
+/**
+ * @brief Powers of ten that are exact doubles.
+ */
+const double exactPowers[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                               1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') <= 9; }
+
+} // namespace
+
+/**
+ * @brief Matches the isNumeric pattern while accumulating the digits.
+ *
+ * Up to 19 significant digits are kept in an integer. When that integer and
+ * the power of ten are both exact doubles, one multiplication or division
+ * rounds correctly; any other number is converted by strtod.
+ */
+TextNumber NumberFormat::parse(const std::string& text) {
+    TextNumber number;
+    const char* p = text.c_str();
+    const char* end = p + text.size();
+    bool negative = p < end && *p == '-';
+    p += negative;
+
+    std::uint64_t mantissa = 0;
+    int significant = 0; // digits in mantissa, leading zeros excluded
+    int scale = 0;       // power of ten applied to mantissa
+    const char* digits = p;
+    for (; p < end && isDigit(*p); ++p) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            significant += mantissa != 0;
+        } else {
+            ++scale;
+            ++significant;
+        }
+    }
+    bool hasDigits = p != digits;
+    if (p < end && *p == '.') {
+        const char* fraction = ++p;
+        for (; p < end && isDigit(*p); ++p) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                significant += mantissa != 0;
+                --scale;
+            } else {
+                ++significant;
+            }
+        }
+        hasDigits = p != fraction; // "5." is not a number, ".5" is
+    }
+    if (!hasDigits) {
+        return number;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = p < end && *p == '-';
+        p += p < end && (*p == '-' || *p == '+');
+        const char* exponentDigits = p;
+        int exponent = 0;
+        for (; p < end && isDigit(*p); ++p) {
+            exponent = exponent < 100000 ? exponent * 10 + (*p - '0') : exponent;
+        }
+        if (p == exponentDigits) {
+            return number;
+        }
+        scale += negativeExponent ? -exponent : exponent;
+    }
+    if (p != end) {
+        return number;
+    }
+
+    number.numeric = true;
+    if (significant <= 19 && mantissa <= (std::uint64_t(1) << 53) && scale >= -22 && scale <= 22) {
+        double value = static_cast<double>(mantissa);
+        value = scale < 0 ? value / exactPowers[-scale] : value * exactPowers[scale];
+        number.value = negative ? -value : value;
+        return number;
+    }
+
+    // std::stod throws std::out_of_range exactly when strtod reports ERANGE
+    errno = 0;
+    double value = std::strtod(text.c_str(), nullptr);
+    number.outOfRange = errno == ERANGE;
+    number.value = value;
+    return number;
+}
+
+std::size_t NumberFormat::writeShortest(double value, char* buffer) {
+    return std::to_chars(buffer, buffer + bufferSize, value, std::chars_format::fixed).ptr - buffer;
+}
+
+std::size_t NumberFormat::writeDisplay(double value, char* buffer) {
+    std::size_t length = std::to_chars(buffer, buffer + bufferSize, value, std::chars_format::fixed, 15).ptr - buffer;
+
+    // Trim trailing zeros, and the point if no fraction remains; "inf" and "nan" have no point
+    std::size_t point = 0;
+    while (point < length && buffer[point] != '.') {
+        ++point;
+    }
+    if (point < length) {
+        while (buffer[length - 1] == '0') {
+            --length;
+        }
+        if (length - 1 == point) {
+            --length;
+        }
+    }
+    return length;
+}
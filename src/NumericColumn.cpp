@@ -0,0 +1,272 @@
+#include "NumericColumn.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Counts the bits set in a word.
+ */
+inline int countBits(std::uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int bits = 0;
+    for (; word; word &= word - 1) {
+        ++bits;
+    }
+    return bits;
+#endif
+}
+
+/**
+ * @brief Gets the index of the lowest bit set in a non-zero word.
+ */
+inline int lowestBit(std::uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & (std::uint64_t(1) << bit))) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * @brief Gets the bits of word `index` that fall inside rows first..last.
+ */
+inline std::uint64_t rangeMask(std::size_t index, int first, int last) {
+    std::uint64_t mask = ~std::uint64_t(0);
+    if (index == static_cast<std::size_t>(first) / 64) {
+        mask &= ~std::uint64_t(0) << (first % 64);
+    }
+    if (index == static_cast<std::size_t>(last) / 64) {
+        mask &= ~std::uint64_t(0) >> (63 - last % 64);
+    }
+    return mask;
+}
+
+} // namespace
+
+void NumericColumn::set(int row, const TextNumber& number) {
+    if (row >= size()) {
+        resize(row + 1);
+    }
+
+    std::uint64_t bit = std::uint64_t(1) << (row % 64);
+    std::uint64_t& validWord = valid[row / 64];
+    std::uint64_t& overflowWord = overflow[row / 64];
+    if (overflowWord & bit) {
+        --overflowCount;
+    }
+    validWord &= ~bit;
+    overflowWord &= ~bit;
+    values[row] = 0.0;
+
+    if (number.numeric && number.outOfRange) {
+        overflowWord |= bit;
+        ++overflowCount;
+    } else if (number.numeric) {
+        validWord |= bit;
+        values[row] = number.value;
+    }
+}
+
+void NumericColumn::resize(int rows) {
+    // Rows dropped by a shrink must not leave bits behind in the last word
+    for (int row = rows; row < size() && overflowCount > 0; ++row) {
+        if (overflow[row / 64] & (std::uint64_t(1) << (row % 64))) {
+            --overflowCount;
+        }
+    }
+    std::size_t words = (static_cast<std::size_t>(rows) + 63) / 64;
+    values.resize(rows, 0.0);
+    valid.resize(words, 0);
+    overflow.resize(words, 0);
+    if (rows % 64 != 0) {
+        std::uint64_t keep = ~std::uint64_t(0) >> (64 - rows % 64);
+        valid[words - 1] &= keep;
+        overflow[words - 1] &= keep;
+    }
+}
+
+bool NumericColumn::isExact(int first, int last) const {
+    if (overflowCount == 0) {
+        return true;
+    }
+    last = std::min(last, size() - 1);
+    for (int word = first / 64; first <= last && word <= last / 64; ++word) {
+        if (overflow[word] & rangeMask(word, first, last)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t NumericColumn::count(int first, int last) const {
+    last = std::min(last, size() - 1);
+    std::size_t numbers = 0;
+    for (int word = first / 64; first <= last && word <= last / 64; ++word) {
+        numbers += countBits(valid[word] & rangeMask(word, first, last));
+    }
+    return numbers;
+}
+
+/**
+ * @brief Null cells hold 0.0, which leaves a sum starting at 0.0 unchanged, so no bitmap test is needed.
+ */
+double NumericColumn::sum(int first, int last) const {
+    last = std::min(last, size() - 1);
+    double total = 0.0;
+    for (int row = first; row <= last; ++row) {
+        total += values[row];
+    }
+    return total;
+}
+
+template <typename Visit>
+void NumericColumn::forEachNumber(int first, int last, Visit visit) const {
+    last = std::min(last, size() - 1);
+    for (int word = first / 64; first <= last && word <= last / 64; ++word) {
+        for (std::uint64_t bits = valid[word] & rangeMask(word, first, last); bits; bits &= bits - 1) {
+            visit(values[word * 64 + lowestBit(bits)]);
+        }
+    }
+}
+
+/**
+ * @brief Keeps the first of equal extremes, like std::min_element.
+ */
+double NumericColumn::min(int first, int last) const {
+    bool found = false;
+    double best = 0.0;
+    forEachNumber(first, last, [&](double value) {
+        if (!found || value < best) {
+            best = value;
+            found = true;
+        }
+    });
+    return best;
+}
+
+/**
+ * @brief Keeps the first of equal extremes, like std::max_element.
+ */
+double NumericColumn::max(int first, int last) const {
+    bool found = false;
+    double best = 0.0;
+    forEachNumber(first, last, [&](double value) {
+        if (!found || best < value) {
+            best = value;
+            found = true;
+        }
+    });
+    return best;
+}
+
+double NumericColumn::sumSquaredDeviations(int first, int last, double mean) const {
+    double total = 0.0;
+    forEachNumber(first, last, [&](double value) { total += (value - mean) * (value - mean); });
+    return total;
+}
+
+std::uint64_t NumericColumn::bitsFrom(const std::vector<std::uint64_t>& words, int row) {
+    std::size_t index = static_cast<std::size_t>(row) / 64;
+    int shift = row % 64;
+    std::uint64_t bits = index < words.size() ? words[index] >> shift : 0;
+    if (shift != 0 && index + 1 < words.size()) {
+        bits |= words[index + 1] << (64 - shift);
+    }
+    return bits;
+}
+
+/**
+ * @brief Tests every value of a word without branching, then keeps the numeric rows of the range.
+ */
+template <typename Test>
+void NumericColumn::compareRange(int first, int last, bool negate, Test test, std::vector<std::uint64_t>& mask) const {
+    std::size_t length = static_cast<std::size_t>(last - first + 1);
+    mask.assign((length + 63) / 64, 0);
+    int stored = std::min(last, size() - 1); // rows past the column are null
+    for (std::size_t word = 0; word < mask.size(); ++word) {
+        int base = first + static_cast<int>(word * 64);
+        int count = std::min(64, stored - base + 1);
+        std::uint64_t bits = 0;
+        for (int bit = 0; bit < count; ++bit) {
+            bits |= static_cast<std::uint64_t>(test(values[base + bit])) << bit;
+        }
+        bits &= bitsFrom(valid, base);
+        if (negate) {
+            bits = ~bits;
+        }
+        if (word == mask.size() - 1 && length % 64 != 0) {
+            bits &= ~std::uint64_t(0) >> (64 - length % 64);
+        }
+        mask[word] = bits;
+    }
+}
+
+void NumericColumn::compare(int first, int last, Comparison comparison, double constant, std::vector<std::uint64_t>& mask) const {
+    switch (comparison) {
+        case Comparison::Equal:
+            compareRange(first, last, false, [constant](double value) { return value == constant; }, mask);
+            break;
+        case Comparison::NotEqual:
+            compareRange(first, last, true, [constant](double value) { return value == constant; }, mask);
+            break;
+        case Comparison::Less:
+            compareRange(first, last, false, [constant](double value) { return value < constant; }, mask);
+            break;
+        case Comparison::LessEqual:
+            compareRange(first, last, false, [constant](double value) { return value <= constant; }, mask);
+            break;
+        case Comparison::Greater:
+            compareRange(first, last, false, [constant](double value) { return value > constant; }, mask);
+            break;
+        case Comparison::GreaterEqual:
+            compareRange(first, last, false, [constant](double value) { return value >= constant; }, mask);
+            break;
+    }
+}
+
+/**
+ * @brief Selects instead of branching, so unset rows add 0.0 and the order of the additions stays the row order.
+ */
+double NumericColumn::maskedSum(int first, const std::vector<std::uint64_t>& mask) const {
+    double total = 0.0;
+    for (std::size_t word = 0; word < mask.size(); ++word) {
+        std::uint64_t bits = mask[word];
+        if (bits == 0) {
+            continue;
+        }
+        int base = first + static_cast<int>(word * 64);
+        int count = std::min(64, size() - base);
+        for (int bit = 0; bit < count; ++bit) {
+            total += (bits >> bit) & 1 ? values[base + bit] : 0.0;
+        }
+    }
+    return total;
+}
+
+std::size_t NumericColumn::maskedCount(int first, const std::vector<std::uint64_t>& mask) const {
+    std::size_t numbers = 0;
+    for (std::size_t word = 0; word < mask.size(); ++word) {
+        numbers += countBits(mask[word] & bitsFrom(valid, first + static_cast<int>(word * 64)));
+    }
+    return numbers;
+}
+
+std::size_t NumericColumn::countSet(const std::vector<std::uint64_t>& mask) {
+    std::size_t bits = 0;
+    for (std::uint64_t word : mask) {
+        bits += countBits(word);
+    }
+    return bits;
+}
+
+std::size_t NumericColumn::getMemoryUsage() const {
+    return sizeof(NumericColumn) + values.capacity() * sizeof(double) +
+           (valid.capacity() + overflow.capacity()) * sizeof(std::uint64_t);
+}
@@ -0,0 +1,354 @@
+#include "PivotTable.h"
+#include "LexicalAnalysis.h"
+#include "NumberFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <regex>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+/**
+ * @brief The typed content of one key cell.
+ */
+struct KeyPart {
+    double number;           ///< Value of a numeric text.
+    const std::string* text; ///< The text as stored, shown for the group.
+    unsigned char kind;      ///< 0 number, 1 text, 2 empty.
+};
+
+/**
+ * @brief Count, extremes and running mean and squared deviations of the numbers of a group.
+ */
+struct Accumulator {
+    std::size_t count = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double mean = 0.0;
+    double squares = 0.0; ///< Sum of squared deviations from the mean.
+
+    void add(double value) {
+        ++count;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        double delta = value - mean;
+        mean += delta / count;
+        squares += delta * (value - mean);
+    }
+
+    // Combines the deviations of two groups without revisiting their numbers
+    void merge(const Accumulator& other) {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        double total = static_cast<double>(count + other.count);
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        squares += other.squares + delta * delta * count * other.count / total;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        count += other.count;
+    }
+};
+
+std::uint64_t mix(std::uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    return hash ^ (hash >> 33);
+}
+
+std::uint64_t hashKey(const KeyPart* key, std::size_t keyCount) {
+    std::uint64_t hash = 0;
+    for (std::size_t k = 0; k < keyCount; ++k) {
+        std::uint64_t part = key[k].kind;
+        if (key[k].kind == 0) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &key[k].number, sizeof bits);
+            part ^= bits;
+        } else if (key[k].kind == 1) {
+            part ^= std::hash<std::string_view>()(*key[k].text);
+        }
+        hash = mix(hash ^ part) + k;
+    }
+    return mix(hash);
+}
+
+bool equalKeys(const KeyPart* a, const KeyPart* b, std::size_t keyCount) {
+    for (std::size_t k = 0; k < keyCount; ++k) {
+        if (a[k].kind != b[k].kind) {
+            return false;
+        }
+        if (a[k].kind == 0 && a[k].number != b[k].number) {
+            return false;
+        }
+        if (a[k].kind == 1 && a[k].text != b[k].text && *a[k].text != *b[k].text) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Numbers by value, then texts by their bytes, then the empty key
+int compareKeys(const KeyPart* a, const KeyPart* b, std::size_t keyCount) {
+    for (std::size_t k = 0; k < keyCount; ++k) {
+        if (a[k].kind != b[k].kind) {
+            return a[k].kind < b[k].kind ? -1 : 1;
+        }
+        if (a[k].kind == 0 && a[k].number != b[k].number) {
+            return a[k].number < b[k].number ? -1 : 1;
+        }
+        if (a[k].kind == 1) {
+            int order = a[k].text->compare(*b[k].text);
+            if (order != 0) {
+                return order;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Open-addressing hash table of groups, with the keys and accumulators of every group stored flat.
+ */
+class GroupTable {
+public:
+    GroupTable(std::size_t keyCount, std::size_t valueCount)
+        : keyCount(keyCount), valueCount(valueCount), slots(16, 0) {}
+
+    std::size_t size() const { return hashes.size(); }
+
+    const KeyPart* keyOf(std::size_t group) const { return &keys[group * keyCount]; }
+    Accumulator* valuesOf(std::size_t group) { return &values[group * valueCount]; }
+
+    // Gets the group of a key, adding it with empty accumulators on first use
+    std::size_t find(const KeyPart* key, std::uint64_t hash) {
+        if (2 * (size() + 1) > slots.size()) {
+            grow();
+        }
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            std::uint32_t entry = slots[slot];
+            if (entry == 0) {
+                slots[slot] = static_cast<std::uint32_t>(size() + 1);
+                keys.insert(keys.end(), key, key + keyCount);
+                hashes.push_back(hash);
+                values.resize(values.size() + valueCount);
+                return size() - 1;
+            }
+            if (hashes[entry - 1] == hash && equalKeys(keyOf(entry - 1), key, keyCount)) {
+                return entry - 1;
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> hashes; ///< Hash of the key of every group.
+
+private:
+    std::size_t keyCount;
+    std::size_t valueCount;
+    std::vector<KeyPart> keys;          ///< keyCount parts per group.
+    std::vector<Accumulator> values;    ///< valueCount accumulators per group.
+    std::vector<std::uint32_t> slots;   ///< Group index + 1, or 0 for a free slot.
+
+    void grow() {
+        std::vector<std::uint32_t> larger(slots.size() * 2, 0);
+        std::size_t mask = larger.size() - 1;
+        for (std::size_t group = 0; group < size(); ++group) {
+            std::size_t slot = hashes[group] & mask;
+            while (larger[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            larger[slot] = static_cast<std::uint32_t>(group + 1);
+        }
+        slots.swap(larger);
+    }
+};
+
+bool isBlank(const std::string& text) {
+    return text.find_first_not_of(' ') == std::string::npos;
+}
+
+// Splits "A, B" into "A" and "B"
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items(1);
+    for (char c : text) {
+        if (c == ',') {
+            items.emplace_back();
+        } else if (c != ' ') {
+            items.back() += c;
+        }
+    }
+    return items;
+}
+
+// "A" for 0, "AA" for 26, as column headers show them
+std::string columnLabel(int index) {
+    std::string label;
+    while (index >= 0) {
+        label = char('A' + index % 26) + label;
+        index = index / 26 - 1;
+    }
+    return label;
+}
+
+} // namespace
+
+PivotTable::PivotTable(std::vector<int> keyColumns, std::vector<PivotValue> values)
+    : keyColumns(std::move(keyColumns)), values(std::move(values)) {
+    if (this->keyColumns.empty()) {
+        throw std::invalid_argument("A pivot table needs at least one key column.");
+    }
+    for (const auto& value : this->values) {
+        if (value.function != "SUM" && value.function != "AVER" && value.function != "MAX" &&
+            value.function != "MIN" && value.function != "STDDEV") {
+            throw std::invalid_argument("Unknown pivot function " + value.function);
+        }
+    }
+}
+
+bool PivotTable::parseColumns(const std::string& text, std::vector<int>& columns) {
+    static const std::regex columnRegex("[A-Z]{1,2}");
+    columns.clear();
+    for (const auto& item : splitList(text)) {
+        int row, col;
+        if (!std::regex_match(item, columnRegex) || !LexicalAnalysis::parseCellReference(item + "1", row, col)) {
+            return false;
+        }
+        columns.push_back(col);
+    }
+    return !columns.empty();
+}
+
+bool PivotTable::parseValues(const std::string& text, std::vector<PivotValue>& values) {
+    static const std::regex valueRegex("(SUM|AVER|MAX|MIN|STDDEV)\\(([A-Z]{1,2})\\)");
+    values.clear();
+    for (const auto& item : splitList(text)) {
+        std::smatch match;
+        int row, col;
+        if (!std::regex_match(item, match, valueRegex) || !LexicalAnalysis::parseCellReference(match[2].str() + "1", row, col)) {
+            return false;
+        }
+        values.push_back({ col, match[1].str() });
+    }
+    return !values.empty();
+}
+
+/**
+ * @brief Aggregates chunks of rows into partitioned tables in parallel, merges each partition in parallel, then sorts the groups.
+ */
+void PivotTable::aggregate(const CellMatrix& data, int firstRow, int lastRow, ThreadPool& pool) {
+    rows.clear();
+    std::size_t keyCount = keyColumns.size();
+    std::size_t valueCount = values.size();
+    firstRow = std::max(firstRow, 0);
+    lastRow = std::min(lastRow, data.getRows() - 1);
+    std::size_t count = lastRow >= firstRow ? static_cast<std::size_t>(lastRow - firstRow + 1) : 0;
+
+    // One chunk per thread, each large enough to be worth a task; equal keys share a partition
+    std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(pool.size(), count / 4096));
+    std::size_t partitions = chunks == 1 ? 1 : pool.size();
+    std::vector<std::vector<GroupTable>> tables(chunks, std::vector<GroupTable>(partitions, GroupTable(keyCount, valueCount)));
+    pool.parallelFor(chunks, [&](std::size_t begin, std::size_t end) {
+        std::vector<KeyPart> key(keyCount);
+        for (std::size_t c = begin; c < end; ++c) {
+            int chunkFirst = firstRow + static_cast<int>(count * c / chunks);
+            int chunkLast = firstRow + static_cast<int>(count * (c + 1) / chunks);
+            for (int row = chunkFirst; row < chunkLast; ++row) {
+                for (std::size_t k = 0; k < keyCount; ++k) {
+                    const std::string& text = data(row, keyColumns[k]);
+                    const TextNumber& number = StringPool::numberOf(&text);
+                    key[k].text = &text;
+                    key[k].number = number.value + 0.0; // -0 and 0 are one group
+                    key[k].kind = number.numeric && !number.outOfRange ? 0 : isBlank(text) ? 2 : 1;
+                }
+                std::uint64_t hash = hashKey(key.data(), keyCount);
+                GroupTable& table = tables[c][(hash >> 40) % partitions];
+                Accumulator* accumulators = table.valuesOf(table.find(key.data(), hash));
+                for (std::size_t v = 0; v < valueCount; ++v) {
+                    const TextNumber& number = data.getNumber(row, values[v].column);
+                    if (number.numeric && !number.outOfRange) {
+                        accumulators[v].add(number.value);
+                    }
+                }
+            }
+        }
+    }, 1);
+
+    // Merging the chunks in row order keeps the texts of the first row of every group
+    pool.parallelFor(partitions, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            GroupTable& merged = tables[0][p];
+            for (std::size_t c = 1; c < chunks; ++c) {
+                GroupTable& table = tables[c][p];
+                for (std::size_t group = 0; group < table.size(); ++group) {
+                    Accumulator* target = merged.valuesOf(merged.find(table.keyOf(group), table.hashes[group]));
+                    const Accumulator* source = table.valuesOf(group);
+                    for (std::size_t v = 0; v < valueCount; ++v) {
+                        target[v].merge(source[v]);
+                    }
+                }
+                table = GroupTable(keyCount, valueCount);
+            }
+        }
+    }, 1);
+
+    std::vector<std::pair<std::size_t, std::size_t>> groups; // partition and group
+    for (std::size_t p = 0; p < partitions; ++p) {
+        for (std::size_t group = 0; group < tables[0][p].size(); ++group) {
+            groups.emplace_back(p, group);
+        }
+    }
+    std::sort(groups.begin(), groups.end(), [&](const auto& a, const auto& b) {
+        return compareKeys(tables[0][a.first].keyOf(a.second), tables[0][b.first].keyOf(b.second), keyCount) < 0;
+    });
+
+    rows.resize(groups.size() + 1);
+    for (std::size_t k = 0; k < keyCount; ++k) {
+        rows[0].push_back(columnLabel(keyColumns[k]));
+    }
+    for (const auto& value : values) {
+        rows[0].push_back(value.function + "(" + columnLabel(value.column) + ")");
+    }
+    pool.parallelFor(groups.size(), [&](std::size_t begin, std::size_t end) {
+        char buffer[NumberFormat::bufferSize];
+        for (std::size_t i = begin; i < end; ++i) {
+            GroupTable& table = tables[0][groups[i].first];
+            const KeyPart* key = table.keyOf(groups[i].second);
+            const Accumulator* accumulators = table.valuesOf(groups[i].second);
+            std::vector<std::string>& row = rows[i + 1];
+            row.reserve(keyCount + valueCount);
+            for (std::size_t k = 0; k < keyCount; ++k) {
+                row.push_back(key[k].kind == 2 ? std::string() : *key[k].text);
+            }
+            for (std::size_t v = 0; v < valueCount; ++v) {
+                const Accumulator& total = accumulators[v];
+                const std::string& function = values[v].function;
+                if (total.count == 0) {
+                    row.push_back(function == "SUM" ? "0" : "");
+                    continue;
+                }
+                double result = function == "SUM" ? total.sum
+                              : function == "AVER" ? total.sum / total.count
+                              : function == "MAX" ? total.max
+                              : function == "MIN" ? total.min
+                              : std::sqrt(total.squares / total.count);
+                row.emplace_back(buffer, NumberFormat::writeShortest(result, buffer));
+            }
+        }
+    }, 1024);
+}
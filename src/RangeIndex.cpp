@@ -0,0 +1,160 @@
+#include "RangeIndex.h"
+#include "DependencyGraph.h"
+
+#include <algorithm>
+#include <tuple>
+
+/**
+ * @brief A single column is indexed by its rows, a single row by its columns, a rectangle by each of its columns.
+ */
+template <typename Visit>
+void RangeIndex::forEachLine(const CellRange& range, Visit visit) {
+    if (range.startCol != range.endCol && range.startRow == range.endRow) {
+        visit(key(range.sheet, true, range.startRow), range.startCol, range.endCol);
+        return;
+    }
+    for (int col = range.startCol; col <= range.endCol; ++col) {
+        visit(key(range.sheet, false, col), range.startRow, range.endRow);
+    }
+}
+
+void RangeIndex::add(const CellRange& range, std::size_t reader) {
+    forEachLine(range, [&](std::uint64_t line, int start, int end) {
+        Line& target = lines[line];
+        target.intervals.push_back({ start, end, end, reader });
+        if (!target.changed) {
+            target.changed = true;
+            changedLines.push_back(line);
+        }
+    });
+}
+
+void RangeIndex::remove(const CellRange& range, std::size_t reader) {
+    forEachLine(range, [&](std::uint64_t line, int start, int end) {
+        auto found = lines.find(line);
+        if (found == lines.end()) {
+            return;
+        }
+        found->second.removed.push_back({ start, end, end, reader });
+        if (!found->second.changed) {
+            found->second.changed = true;
+            changedLines.push_back(line);
+        }
+    });
+}
+
+/**
+ * @brief Sorts the added intervals and merges them into the sorted ones, then augments the whole line.
+ */
+void RangeIndex::refresh() {
+    auto byStart = [](const Interval& a, const Interval& b) { return a.start < b.start; };
+    for (std::uint64_t line : changedLines) {
+        auto found = lines.find(line);
+        if (found == lines.end()) {
+            continue;
+        }
+        Line& target = found->second;
+        dropRemoved(target);
+        std::vector<Interval>& intervals = target.intervals;
+        if (intervals.empty()) {
+            lines.erase(found);
+            continue;
+        }
+        std::sort(intervals.begin() + target.sorted, intervals.end(), byStart);
+        std::inplace_merge(intervals.begin(), intervals.begin() + target.sorted, intervals.end(), byStart);
+        augment(intervals, 0, intervals.size());
+        target.sorted = intervals.size();
+        target.changed = false;
+    }
+    changedLines.clear();
+}
+
+/**
+ * @brief Looks every interval up in the sorted removals; each removal drops one matching interval.
+ */
+void RangeIndex::dropRemoved(Line& line) {
+    if (line.removed.empty()) {
+        return;
+    }
+    auto order = [](const Interval& a, const Interval& b) {
+        return std::tie(a.reader, a.start, a.end) < std::tie(b.reader, b.start, b.end);
+    };
+    std::vector<Interval>& removed = line.removed;
+    std::sort(removed.begin(), removed.end(), order);
+    std::vector<char> used(removed.size(), 0);
+    std::vector<Interval>& intervals = line.intervals;
+    std::size_t kept = 0;
+    std::size_t keptSorted = 0;
+    for (std::size_t i = 0; i < intervals.size(); ++i) {
+        auto match = std::lower_bound(removed.begin(), removed.end(), intervals[i], order);
+        while (match != removed.end() && !order(intervals[i], *match) && used[match - removed.begin()]) {
+            ++match; // the same range read twice by one cell is removed twice
+        }
+        if (match != removed.end() && !order(intervals[i], *match)) {
+            used[match - removed.begin()] = 1;
+            continue;
+        }
+        keptSorted += i < line.sorted ? 1 : 0;
+        intervals[kept++] = intervals[i];
+    }
+    intervals.resize(kept);
+    line.sorted = keptSorted;
+    removed.clear();
+}
+
+/**
+ * @brief The middle interval of [begin, end) is the root of its subtree, as in a binary search.
+ */
+int RangeIndex::augment(std::vector<Interval>& intervals, std::size_t begin, std::size_t end) {
+    std::size_t middle = begin + (end - begin) / 2;
+    Interval& root = intervals[middle];
+    root.maxEnd = root.end;
+    if (begin < middle) {
+        root.maxEnd = std::max(root.maxEnd, augment(intervals, begin, middle));
+    }
+    if (middle + 1 < end) {
+        root.maxEnd = std::max(root.maxEnd, augment(intervals, middle + 1, end));
+    }
+    return root.maxEnd;
+}
+
+/**
+ * @brief Skips subtrees ending before the position and, right of a root starting after it, everything.
+ */
+void RangeIndex::stab(const std::vector<Interval>& intervals, std::size_t begin, std::size_t end, int position,
+                      std::vector<std::size_t>& readers) {
+    while (begin < end) {
+        std::size_t middle = begin + (end - begin) / 2;
+        const Interval& root = intervals[middle];
+        if (root.maxEnd < position) {
+            return;
+        }
+        stab(intervals, begin, middle, position, readers);
+        if (root.start > position) {
+            return;
+        }
+        if (root.end >= position) {
+            readers.push_back(root.reader);
+        }
+        begin = middle + 1;
+    }
+}
+
+void RangeIndex::findCovering(int sheet, int row, int col, std::vector<std::size_t>& readers) const {
+    auto column = lines.find(key(sheet, false, col));
+    if (column != lines.end()) {
+        stab(column->second.intervals, 0, column->second.intervals.size(), row, readers);
+    }
+    auto cells = lines.find(key(sheet, true, row));
+    if (cells != lines.end()) {
+        stab(cells->second.intervals, 0, cells->second.intervals.size(), col, readers);
+    }
+}
+
+std::size_t RangeIndex::size() const {
+    std::size_t count = 0;
+    for (const auto& line : lines) {
+        count += line.second.intervals.size() - std::min(line.second.intervals.size(), line.second.removed.size());
+    }
+    return count;
+}
@@ -0,0 +1,238 @@
+#include "RecalcEngine.h"
+#include "LexicalAnalysis.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+RecalcEngine::RecalcEngine(unsigned threadCount)
+    : pool(threadCount), tokenizer(Tokenizer::createDefault()) {}
+
+/**
+ * @brief Recalculates incrementally when the sheets only changed cell by cell, fully otherwise.
+ */
+std::shared_ptr<ValueSnapshot> RecalcEngine::recalculate(const Workbook& book, const std::function<bool()>& cancelled) {
+    for (auto& results : rangeResults) {
+        results->clear(); // results of the previous version are stale
+    }
+    std::vector<std::size_t> edited;
+    bool incremental = hasComputed && collectEdits(book, edited);
+
+    if (incremental) {
+        // An abandoned incremental pass is simply repeated: the next change list still includes these edits
+        if (!recalculateCells(book, std::move(edited), cancelled)) {
+            return nullptr;
+        }
+    } else if (!recalculateAll(book, cancelled)) {
+        hasComputed = false;
+        return nullptr;
+    }
+    computedNames.clear();
+    computedVersions.clear();
+    for (int sheet = 0; sheet < book.getSheetCount(); ++sheet) {
+        computedNames.push_back(book.getSheetName(sheet));
+        computedVersions.push_back(book.getSheet(sheet).getVersion());
+    }
+    hasComputed = true;
+
+    std::shared_ptr<ValueSnapshot> snapshot = std::make_shared<ValueSnapshot>();
+    snapshot->version = book.getVersion();
+    snapshot->sheets.resize(graph.getSheetCount());
+    for (int sheet = 0; sheet < graph.getSheetCount(); ++sheet) {
+        ValueSnapshot::Sheet& sheetValues = snapshot->sheets[sheet];
+        sheetValues.rows = graph.getRows(sheet);
+        sheetValues.cols = graph.getCols(sheet);
+        sheetValues.blocks.assign(displayBlocks[sheet].begin(), displayBlocks[sheet].end());
+    }
+    return snapshot;
+}
+
+std::shared_ptr<ValueSnapshot> RecalcEngine::recalculate(const CellMatrix& data, const std::function<bool()>& cancelled) {
+    return recalculate(Workbook(data), cancelled);
+}
+
+/**
+ * @brief Maps the change log of every sheet to graph indices; any sheet that cannot be caught up forces a full pass.
+ */
+bool RecalcEngine::collectEdits(const Workbook& book, std::vector<std::size_t>& edited) const {
+    if (book.getSheetCount() != graph.getSheetCount()) {
+        return false;
+    }
+    std::vector<std::pair<int, int>> changes;
+    for (int sheet = 0; sheet < book.getSheetCount(); ++sheet) {
+        const CellMatrix& data = book.getSheet(sheet);
+        if (book.getSheetName(sheet) != computedNames[sheet] || data.getRows() != graph.getRows(sheet) ||
+            data.getCols() != graph.getCols(sheet) || !data.changesSince(computedVersions[sheet], changes)) {
+            return false;
+        }
+        for (const auto& change : changes) {
+            edited.push_back(graph.firstCell(sheet) + static_cast<std::size_t>(change.first) * graph.getCols(sheet) + change.second);
+        }
+        changes.clear();
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluates the whole workbook level by level; cells within a level run concurrently.
+ */
+bool RecalcEngine::recalculateAll(const Workbook& book, const std::function<bool()>& cancelled) {
+    graph.build(book, tokenizer, pool);
+    if (cancelled()) {
+        return false;
+    }
+
+    std::vector<std::size_t> cyclic;
+    std::vector<std::vector<std::size_t>> levels = graph.computeLevels(cyclic);
+
+    const int sheetCount = graph.getSheetCount();
+    values.assign(sheetCount, CellValueCache());
+    rangeResults.clear();
+    for (int sheet = 0; sheet < sheetCount; ++sheet) {
+        values[sheet].reset(graph.getRows(sheet), graph.getCols(sheet));
+        rangeResults.push_back(std::make_unique<RangeFunctionCache>());
+    }
+
+    // Circular references have no value; everything reading them reports the error
+    for (std::size_t cell : cyclic) {
+        std::size_t index;
+        int sheet = locate(cell, index);
+        values[sheet].store(index, "Error: Circular reference");
+    }
+    if (!evaluateLevels(book, levels, cancelled)) {
+        return false;
+    }
+    lastEvaluatedCount = graph.getCellCount();
+
+    displayBlocks.assign(sheetCount, {});
+    for (int sheet = 0; sheet < sheetCount; ++sheet) {
+        const CellMatrix& data = book.getSheet(sheet);
+        const CellValueCache& sheetValues = values[sheet];
+        const int cols = graph.getCols(sheet);
+        std::size_t cellCount = sheetValues.values.size();
+        std::vector<std::shared_ptr<std::vector<std::string>>>& blocks = displayBlocks[sheet];
+        blocks.assign((cellCount + ValueSnapshot::blockSize - 1) / ValueSnapshot::blockSize, nullptr);
+        pool.parallelFor(blocks.size(), [&](std::size_t begin, std::size_t end) {
+            LexicalAnalysis lexicalAnalyzer(tokenizer, data);
+            for (std::size_t block = begin; block < end; ++block) {
+                std::size_t first = block * ValueSnapshot::blockSize;
+                std::size_t last = std::min(cellCount, first + ValueSnapshot::blockSize);
+                auto texts = std::make_shared<std::vector<std::string>>(last - first);
+                for (std::size_t cell = first; cell < last; ++cell) {
+                    const std::string& content = data(static_cast<int>(cell / cols), static_cast<int>(cell % cols));
+                    if (!content.empty()) {
+                        lexicalAnalyzer.formatCellText(content, sheetValues.values[cell], (*texts)[cell - first]);
+                    }
+                }
+                blocks[block] = texts;
+            }
+        }, 1);
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluates only the edited cells and the cells reading them, directly or through ranges, on any sheet.
+ */
+bool RecalcEngine::recalculateCells(const Workbook& book, std::vector<std::size_t> edited,
+                                    const std::function<bool()>& cancelled) {
+    std::sort(edited.begin(), edited.end());
+    edited.erase(std::unique(edited.begin(), edited.end()), edited.end());
+
+    graph.updateCells(book, tokenizer, edited);
+
+    std::vector<std::size_t> affected = graph.affectedBy(edited);
+    for (std::size_t cell : affected) {
+        std::size_t index;
+        int sheet = locate(cell, index);
+        values[sheet].ready[index] = 0;
+    }
+
+    std::vector<std::size_t> cyclic;
+    std::vector<std::vector<std::size_t>> levels = graph.computeLevels(affected, cyclic);
+    for (std::size_t cell : cyclic) {
+        std::size_t index;
+        int sheet = locate(cell, index);
+        values[sheet].store(index, "Error: Circular reference");
+    }
+    if (!evaluateLevels(book, levels, cancelled)) {
+        return false;
+    }
+    lastEvaluatedCount = affected.size();
+
+    for (std::size_t cell : affected) {
+        std::size_t index;
+        int sheet = locate(cell, index);
+        const int cols = graph.getCols(sheet);
+        const CellMatrix& data = book.getSheet(sheet);
+        const std::string& content = data(static_cast<int>(index / cols), static_cast<int>(index % cols));
+        std::string& text = writableBlock(sheet, index / ValueSnapshot::blockSize)[index % ValueSnapshot::blockSize];
+        if (content.empty()) {
+            text.clear();
+        } else {
+            // reuses the previous value's buffer
+            LexicalAnalysis(tokenizer, data).formatCellText(content, values[sheet].values[index], text);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluates the levels in order; the cells of one level are shared among the pool threads.
+ */
+bool RecalcEngine::evaluateLevels(const Workbook& book, const std::vector<std::vector<std::size_t>>& levels,
+                                  const std::function<bool()>& cancelled) {
+    std::atomic<bool> abandoned(false);
+    for (const auto& level : levels) {
+        pool.parallelFor(level.size(), [&](std::size_t begin, std::size_t end) {
+            if (abandoned || cancelled()) {
+                abandoned = true;
+                return;
+            }
+            // One analysis per sheet, each resolving its references from the values of every sheet
+            std::vector<LexicalAnalysis> lexicalAnalyzers;
+            lexicalAnalyzers.reserve(book.getSheetCount());
+            for (int sheet = 0; sheet < book.getSheetCount(); ++sheet) {
+                lexicalAnalyzers.emplace_back(tokenizer, book.getSheet(sheet));
+                lexicalAnalyzers.back().setValueCache(&values[sheet]);
+                lexicalAnalyzers.back().setRangeCache(rangeResults[sheet].get());
+                lexicalAnalyzers.back().setWorkbook(&book, &values);
+            }
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t index;
+                int sheet = locate(level[i], index);
+                const int cols = graph.getCols(sheet);
+                int row = static_cast<int>(index / cols);
+                int col = static_cast<int>(index % cols);
+                const std::string& content = book.getSheet(sheet)(row, col);
+                if (!content.empty()) {
+                    std::string value;
+                    try {
+                        value = lexicalAnalyzers[sheet].evaluateCellValue(row, col, content, graph.tokensOf(level[i]));
+                    } catch (const std::exception& error) {
+                        value = std::string("Error: ") + error.what(); // one bad cell must not stop the others
+                    }
+                    values[sheet].store(index, value);
+                } else {
+                    values[sheet].store(index, std::string());
+                }
+            }
+        });
+        if (abandoned) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Copies a display block before its first change if a published snapshot still uses it.
+ */
+std::vector<std::string>& RecalcEngine::writableBlock(int sheet, std::size_t block) {
+    // Only this engine hands out references, so a count of one means nobody else can see the block
+    std::shared_ptr<std::vector<std::string>>& texts = displayBlocks[sheet][block];
+    if (texts.use_count() > 1) {
+        texts = std::make_shared<std::vector<std::string>>(*texts);
+    }
+    return *texts;
+}
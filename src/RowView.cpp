@@ -0,0 +1,115 @@
+#include "RowView.h"
+#include "NumberFormat.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Sort key of one row, extracted once before sorting.
+ */
+struct SortKey {
+    double number;           ///< Value of a numeric text.
+    const std::string* text; ///< The text itself, for non-numeric keys.
+    int row;                 ///< Data row.
+    int position;            ///< Position before sorting, so equal keys keep their order.
+    unsigned char kind;      ///< 0 number, 1 text, 2 empty or spaces only.
+};
+
+} // namespace
+
+int RowView::viewRowOf(int sourceRow) const {
+    if (!active) {
+        return sourceRow;
+    }
+    auto found = std::find(rows.begin(), rows.end(), sourceRow);
+    return found == rows.end() ? -1 : static_cast<int>(found - rows.begin());
+}
+
+void RowView::reset() {
+    active = false;
+    rows.clear();
+    rows.shrink_to_fit();
+}
+
+void RowView::activate(int rowCount) {
+    if (!active) {
+        rows.resize(rowCount);
+        for (int r = 0; r < rowCount; ++r) {
+            rows[r] = r;
+        }
+        active = true;
+    }
+}
+
+/**
+ * @brief Extracts typed keys in parallel, sorts chunks in parallel and merges them in parallel rounds.
+ */
+void RowView::sort(int rowCount, const std::function<const std::string&(int)>& textOf, bool ascending, ThreadPool& pool) {
+    activate(rowCount);
+    std::size_t count = rows.size();
+    std::vector<SortKey> keys(count);
+    pool.parallelFor(count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            SortKey& key = keys[i];
+            key.row = rows[i];
+            key.position = static_cast<int>(i);
+            key.text = &textOf(key.row);
+            TextNumber number = NumberFormat::parse(*key.text);
+            key.number = number.value;
+            // Cells padded with " " are blank, as in PivotTable
+            key.kind = key.text->find_first_not_of(' ') == std::string::npos ? 2 : number.numeric ? 0 : 1;
+        }
+    }, 4096);
+
+    auto less = [ascending](const SortKey& a, const SortKey& b) {
+        if (a.kind != b.kind) {
+            // Empty cells stay at the bottom in both directions
+            return a.kind == 2 || b.kind == 2 ? a.kind < b.kind : (a.kind < b.kind) == ascending;
+        }
+        if (a.kind == 0 && a.number != b.number) {
+            return (a.number < b.number) == ascending;
+        }
+        if (a.kind == 1) {
+            int order = a.text->compare(*b.text);
+            if (order != 0) {
+                return (order < 0) == ascending;
+            }
+        }
+        return a.position < b.position;
+    };
+
+    // One chunk per thread, each large enough to be worth a task
+    std::size_t parts = std::max<std::size_t>(1, std::min<std::size_t>(pool.size(), count / 4096));
+    std::vector<std::size_t> bounds(parts + 1);
+    for (std::size_t p = 0; p <= parts; ++p) {
+        bounds[p] = count * p / parts;
+    }
+    pool.parallelFor(parts, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            std::sort(keys.begin() + bounds[p], keys.begin() + bounds[p + 1], less);
+        }
+    }, 1);
+    for (std::size_t width = 1; width < parts; width *= 2) {
+        pool.parallelFor((parts + 2 * width - 1) / (2 * width), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t low = i * 2 * width;
+                std::size_t middle = std::min(low + width, parts);
+                std::size_t high = std::min(low + 2 * width, parts);
+                if (middle < high) {
+                    std::inplace_merge(keys.begin() + bounds[low], keys.begin() + bounds[middle],
+                                       keys.begin() + bounds[high], less);
+                }
+            }
+        }, 1);
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        rows[i] = keys[i].row;
+    }
+}
+
+void RowView::filter(int rowCount, const std::function<bool(int)>& keep) {
+    activate(rowCount);
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [&](int row) { return !keep(row); }), rows.end());
+}
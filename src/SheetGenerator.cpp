@@ -0,0 +1,168 @@
+#include "SheetGenerator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+/// Category names used as label noise, repeated like real report sheets.
+const char* const categoryLabels[] = { "North", "South", "East", "West", "Retail", "Online", "Q1", "Q2" };
+
+/// Converts a 0-based column index to its letter label ("A", "B", ..., "AA").
+std::string columnLetters(int index) {
+    std::string label;
+    while (index >= 0) {
+        label = char('A' + index % 26) + label;
+        index = index / 26 - 1;
+    }
+    return label;
+}
+
+/// Formats the number n / 100 with two decimals ("12.34"), using only integer arithmetic.
+std::string centsToString(std::uint64_t cents) {
+    std::string fraction = std::to_string(cents % 100);
+    if (fraction.size() < 2) {
+        fraction = "0" + fraction;
+    }
+    return std::to_string(cents / 100) + "." + fraction;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a generator and validates its options.
+ */
+SheetGenerator::SheetGenerator(const GeneratorOptions& options) : options(options) {
+    if (options.rows < 1 || options.cols < 1) {
+        throw std::invalid_argument("Generated sheet needs at least one row and one column.");
+    }
+    if (options.formulaRatio < 0 || options.labelRatio < 0 || options.formulaRatio + options.labelRatio > 1) {
+        throw std::invalid_argument("Formula and label ratios must be non-negative and sum to at most 1.");
+    }
+    if (options.chainWeight < 0 || options.sumWeight < 0 || options.arithWeight < 0 ||
+        options.chainWeight + options.sumWeight + options.arithWeight == 0) {
+        throw std::invalid_argument("Formula mix weights must be non-negative and not all zero.");
+    }
+    if (options.chainDepth < 1 || options.fanIn < 1) {
+        throw std::invalid_argument("Chain depth and fan-in must be at least 1.");
+    }
+}
+
+/**
+ * @brief SplitMix64 over the seed and coordinates; unlike std:: distributions
+ * its output is identical with every standard library.
+ */
+std::uint64_t SheetGenerator::hash(int row, int col, std::uint64_t salt) const {
+    std::uint64_t x = options.seed;
+    x ^= static_cast<std::uint64_t>(row) * 0x9E3779B97F4A7C15ULL;
+    x ^= static_cast<std::uint64_t>(col) * 0xC2B2AE3D27D4EB4FULL;
+    x ^= salt * 0x165667B19E3779F9ULL;
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+double SheetGenerator::unit(int row, int col, std::uint64_t salt) const {
+    return static_cast<double>(hash(row, col, salt) >> 11) / static_cast<double>(1ULL << 53);
+}
+
+/**
+ * @brief Returns the content of a cell.
+ *
+ * Column A is a long numeric column. In the other columns the rows are grouped
+ * into segments of chainDepth rows; a segment is either a reference chain
+ * (a number followed by "=B1+7", "=B2+7", ...) or a run of independent cells
+ * mixing numbers, labels, fan-in SUM ranges and arithmetic formulas.
+ */
+std::string SheetGenerator::cellAt(int row, int col) const {
+    if (col == 1) {
+        return std::to_string(hash(row, col, 1) % 1000);
+    }
+
+    const int totalWeight = options.chainWeight + options.sumWeight + options.arithWeight;
+    const double chainShare = options.formulaRatio * options.chainWeight / totalWeight;
+    const int segment = (row - 1) / options.chainDepth;
+    const bool chainSegment = options.chainDepth > 1 && unit(segment, col, 2) < chainShare;
+
+    if (chainSegment) {
+        if ((row - 1) % options.chainDepth == 0) {
+            return std::to_string(hash(row, col, 3) % 100);
+        }
+        return "=" + columnLetters(col - 1) + std::to_string(row - 1) + "+7";
+    }
+
+    // Cells outside chain segments make up the rest of the formula ratio
+    const double remaining = 1.0 - chainShare;
+    if (remaining <= 0) {
+        return centsToString(hash(row, col, 6) % 100000);
+    }
+    const double labelChance = options.labelRatio / remaining;
+    const double formulaChance = (options.formulaRatio - chainShare) / remaining;
+    const double pick = unit(row, col, 4);
+
+    if (pick < labelChance) {
+        std::uint64_t choice = hash(row, col, 5);
+        if (choice % 3 == 0) {
+            return "Label" + std::to_string(choice % 50);
+        }
+        return categoryLabels[choice % (sizeof(categoryLabels) / sizeof(categoryLabels[0]))];
+    }
+    if (pick < labelChance + formulaChance) {
+        return formulaAt(row, col);
+    }
+    return centsToString(hash(row, col, 6) % 100000);
+}
+
+/**
+ * @brief Builds a fan-in SUM or arithmetic formula according to their weights.
+ */
+std::string SheetGenerator::formulaAt(int row, int col) const {
+    const int nonChainWeight = options.sumWeight + options.arithWeight;
+    if (nonChainWeight == 0) {
+        return centsToString(hash(row, col, 7) % 100000);
+    }
+
+    const std::string rowText = std::to_string(row);
+    if (static_cast<int>(hash(row, col, 8) % nonChainWeight) < options.sumWeight) {
+        int first = std::max(1, row - options.fanIn + 1);
+        return "=SUM(A" + std::to_string(first) + "..A" + rowText + ")";
+    }
+    if (hash(row, col, 9) % 2 == 0) {
+        return "=2*A" + rowText;
+    }
+    return "=A" + rowText + "+" + columnLetters(col - 2) + rowText;
+}
+
+/**
+ * @brief Writes the whole sheet as CSV, one line per row.
+ */
+void SheetGenerator::write(std::ostream& out) const {
+    std::string line;
+    for (int r = 1; r <= options.rows; ++r) {
+        line.clear();
+        for (int c = 1; c <= options.cols; ++c) {
+            if (c > 1) {
+                line += ',';
+            }
+            line += cellAt(r, c);
+        }
+        line += '\n';
+        out << line;
+    }
+}
+
+/**
+ * @brief Writes the whole sheet to a CSV file.
+ */
+bool SheetGenerator::writeToFile(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open file for writing: " << filename << "\n";
+        return false;
+    }
+    write(file);
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,102 @@
+#include "SpillStore.h"
+
+#include <cstring>
+
+namespace {
+
+void appendLength(std::string& record, std::uint32_t length) {
+    char bytes[sizeof(length)];
+    std::memcpy(bytes, &length, sizeof(length));
+    record.append(bytes, sizeof(length));
+}
+
+bool readLength(const std::string& record, std::size_t& position, std::uint32_t& length) {
+    if (record.size() - position < sizeof(length)) {
+        return false;
+    }
+    std::memcpy(&length, record.data() + position, sizeof(length));
+    position += sizeof(length);
+    return true;
+}
+
+} // namespace
+
+SpillStore::SpillStore() = default;
+
+SpillStore::~SpillStore() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+/**
+ * @brief Records are the row count, then per row its cell count, then per cell its length and bytes.
+ */
+bool SpillStore::write(const std::vector<std::vector<const std::string*>>& rows, Slot& slot) {
+    std::string record;
+    appendLength(record, static_cast<std::uint32_t>(rows.size()));
+    for (const auto& row : rows) {
+        appendLength(record, static_cast<std::uint32_t>(row.size()));
+        for (const std::string* text : row) {
+            appendLength(record, static_cast<std::uint32_t>(text->size()));
+            record += *text;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file && !(file = std::tmpfile())) {
+        return false;
+    }
+    if (std::fseek(file, static_cast<long>(fileSize), SEEK_SET) != 0 ||
+        std::fwrite(record.data(), 1, record.size(), file) != record.size()) {
+        return false;
+    }
+    slot.offset = fileSize;
+    slot.size = record.size();
+    fileSize += record.size();
+    ++blocksWritten;
+    bytesWritten += record.size();
+    return true;
+}
+
+bool SpillStore::read(const Slot& slot, std::vector<std::vector<std::string>>& rows) {
+    std::string record(slot.size, '\0');
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!file || std::fflush(file) != 0 || std::fseek(file, static_cast<long>(slot.offset), SEEK_SET) != 0 ||
+            std::fread(&record[0], 1, record.size(), file) != record.size()) {
+            return false;
+        }
+        ++blocksRead;
+        bytesRead += record.size();
+    }
+
+    std::size_t position = 0;
+    std::uint32_t rowCount = 0;
+    if (!readLength(record, position, rowCount)) {
+        return false;
+    }
+    rows.assign(rowCount, std::vector<std::string>());
+    for (auto& row : rows) {
+        std::uint32_t cellCount = 0;
+        if (!readLength(record, position, cellCount)) {
+            return false;
+        }
+        row.resize(cellCount);
+        for (auto& text : row) {
+            std::uint32_t length = 0;
+            if (!readLength(record, position, length) || record.size() - position < length) {
+                return false;
+            }
+            text.assign(record, position, length);
+            position += length;
+        }
+    }
+    return true;
+}
+
+SpillStore::Stats SpillStore::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return { hitCount.load(std::memory_order_relaxed), faultCount.load(std::memory_order_relaxed),
+             blocksWritten, bytesWritten, blocksRead, bytesRead };
+}
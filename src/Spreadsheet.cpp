@@ -1,4 +1,5 @@
 #include "Spreadsheet.h"
+#include "FormulaRewriter.h"
 #include "AnsiTerminal.h"
 #include <iostream>
 #include <iomanip>
@@ -9,7 +10,7 @@
 #include <unordered_map>
 
 // Constructor: Initializes the spreadsheet with the specified number of rows and columns
-Spreadsheet::Spreadsheet(int rows, int cols) : rows(rows), cols(cols) {
+Spreadsheet::Spreadsheet(int rows, int cols) : data(workbook.getSheet(0)), rows(rows), cols(cols) {
     //data.resize(rows, std::vector<std::string>(cols, "")); // Initialize all cells with empty strings
 secondHeader =" ";
 }
@@ -33,19 +34,9 @@ void Spreadsheet::setSecondHeader(const std::string& value) {
     }
 }
 
+// Uses the same parser as the evaluator, so "-5" and "1e3" are values
 char Spreadsheet::getContentType(const std::string& content) const {
-bool isNumeric = true;
-
-    // İçerikteki her karakteri kontrol et
-    for (char ch : content) {
-        if (!std::isdigit(ch) && ch != '.') { // Sayısal karakter veya ondalık nokta değilse
-            isNumeric = false;
-            break;
-        }
-    }
-
-    // Sayısal ise 'V', değilse 'L' döndür
-    return isNumeric ? 'V' : 'L';
+    return NumberFormat::parse(content).numeric ? 'V' : 'L';
 }
 void Spreadsheet::createNew(int newRows, int newCols) {
     data.clear(); // Önce mevcut verileri temizle
@@ -55,41 +46,285 @@ void Spreadsheet::createNew(int newRows, int newCols) {
    // data = std::vector<std::vector<std::string>>(rows, std::vector<std::string>(cols, ""));
     firsHeader.clear();
     secondHeader.clear();
+    view.reset();
+    while (workbook.getSheetCount() > 1) {
+        workbook.removeSheet(workbook.getSheetCount() - 1);
+    }
+}
+void Spreadsheet::profile(EvaluationProfiler& profiler) {
+    Tokenizer tokenizer = Tokenizer::createDefault();
+    LexicalAnalysis lexicalAnalyzer(tokenizer, data);
+    lexicalAnalyzer.setProfiler(&profiler);
+    lexicalAnalyzer.setWorkbook(&workbook);
+
+    profiler.reset();
+    profiler.beginRecalculation();
+    for (int r = 0; r < data.getRows(); ++r) {
+        for (int c = 0; c < data.getCols(); ++c) {
+            const std::string& cellContent = data(r, c);
+            if (cellContent.empty()) {
+                continue;
+            }
+            // Evaluate the same way display() does, one profiler frame per cell
+            EvaluationProfiler::Scope profileScope(&profiler, r, c);
+            lexicalAnalyzer.evaluateCellText(r, c);
+        }
+    }
+    profiler.endRecalculation();
+}
+
+void Spreadsheet::setCell(int row, int col, const std::string& value, bool continueEdit) {
+    syncJournal();
+    // Outside the data, operator() gives the empty text where getValue() gives " "
+    journal.record(row, col, data(row, col), value, continueEdit);
+    data.setValue(row + 1, col + 1, value);
+    journalVersion = data.getVersion();
+    autosaver.update(data);
+}
+
+// Undo and redo go through setValue, so the background recalculation only revisits the restored cell
+bool Spreadsheet::undo(int& row, int& col) {
+    syncJournal();
+    std::string value;
+    if (!journal.undo(row, col, value)) {
+        return false;
+    }
+    data.setValue(row + 1, col + 1, value);
+    journalVersion = data.getVersion();
+    autosaver.update(data);
+    return true;
+}
+
+bool Spreadsheet::redo(int& row, int& col) {
+    syncJournal();
+    std::string value;
+    if (!journal.redo(row, col, value)) {
+        return false;
+    }
+    data.setValue(row + 1, col + 1, value);
+    journalVersion = data.getVersion();
+    autosaver.update(data);
+    return true;
+}
+
+// The copies are built first so the data is written, and versioned, once
+void Spreadsheet::fillDown(int row, int col, int lastRow, int lastCol) {
+    if (lastRow <= row || lastCol < col) {
+        return;
+    }
+    Tokenizer tokenizer = Tokenizer::createDefault();
+    FormulaRewriter rewriter(tokenizer);
+    std::vector<std::vector<std::string>> values(lastRow - row, std::vector<std::string>(lastCol - col + 1));
+    for (int c = col; c <= lastCol; ++c) {
+        const std::string& content = data(row, c);
+        for (int r = row + 1; r <= lastRow; ++r) {
+            values[r - row - 1][c - col] = rewriter.shift(content, r - row, 0);
+        }
+    }
+    syncJournal();
+    data.setBlock(row + 2, col + 1, values);
+    finishBulkEdit();
+}
+
+void Spreadsheet::fillRight(int row, int col, int lastRow, int lastCol) {
+    if (lastRow < row || lastCol <= col) {
+        return;
+    }
+    Tokenizer tokenizer = Tokenizer::createDefault();
+    FormulaRewriter rewriter(tokenizer);
+    std::vector<std::vector<std::string>> values(lastRow - row + 1, std::vector<std::string>(lastCol - col));
+    for (int r = row; r <= lastRow; ++r) {
+        const std::string& content = data(r, col);
+        for (int c = col + 1; c <= lastCol; ++c) {
+            values[r - row][c - col - 1] = rewriter.shift(content, 0, c - col);
+        }
+    }
+    syncJournal();
+    data.setBlock(row + 1, col + 2, values);
+    finishBulkEdit();
+}
+
+void Spreadsheet::pasteBlock(int row, int col, const std::vector<std::vector<std::string>>& values) {
+    syncJournal();
+    data.setBlock(row + 1, col + 1, values);
+    finishBulkEdit();
+}
+
+void Spreadsheet::clearRange(int firstRow, int firstCol, int lastRow, int lastCol) {
+    syncJournal();
+    data.clearRange(firstRow + 1, firstCol + 1, lastRow + 1, lastCol + 1);
+    finishBulkEdit();
+}
+
+void Spreadsheet::insertRows(int row, int count) {
+    syncJournal();
+    workbook.insertRows(0, row + 1, count);
+    view.reset();
+    finishBulkEdit();
+}
+
+void Spreadsheet::deleteRows(int row, int count) {
+    syncJournal();
+    workbook.deleteRows(0, row + 1, count);
+    view.reset();
+    finishBulkEdit();
+}
+
+void Spreadsheet::insertColumns(int col, int count) {
+    syncJournal();
+    workbook.insertColumns(0, col + 1, count);
+    finishBulkEdit();
+}
+
+void Spreadsheet::deleteColumns(int col, int count) {
+    syncJournal();
+    workbook.deleteColumns(0, col + 1, count);
+    finishBulkEdit();
+}
+
+// The journal holds single-cell edits, whose undo would not restore the rest of the block
+void Spreadsheet::finishBulkEdit() {
+    journal.clear();
+    journalVersion = data.getVersion();
+    autosaver.update(data);
+}
+
+void Spreadsheet::setAutosavePath(const std::string& path) {
+    autosaver.setPath(path);
+}
+
+void Spreadsheet::syncJournal() {
+    if (data.getVersion() != journalVersion) {
+        journal.clear();
+        view.reset();
+        journalVersion = data.getVersion();
+    }
+}
+
+const std::string& Spreadsheet::displayedText(const ValueSnapshot* values, int row, int col) const {
+    const std::string& content = data(row, col);
+    if (lazy && !content.empty()) {
+        const std::string& text = lazy->getDisplayText(0, row, col);
+        return text.empty() ? content : text;
+    }
+    const std::string* value = values && !content.empty() ? values->valueAt(row, col) : nullptr;
+    return value && !value->empty() ? *value : content;
+}
+
+// Edits made before sorting must not reset the view afterwards, so the journal is synced first
+void Spreadsheet::sortByColumn(int col, bool ascending) {
+    syncJournal();
+    std::shared_ptr<const ValueSnapshot> values = recalculator.latest();
+    const ValueSnapshot* current = values && values->version == workbook.getVersion() ? values.get() : nullptr;
+    ThreadPool pool;
+    const int rowCount = std::max(rows, data.getRows());
+    if (!lazy) {
+        view.sort(rowCount, [&](int row) -> const std::string& {
+            return displayedText(current, row, col);
+        }, ascending, pool);
+        return;
+    }
+    // The evaluator is not thread-safe, so the column is evaluated before the pool compares it
+    lazy->sync();
+    std::vector<const std::string*> texts(rowCount);
+    for (int row = 0; row < rowCount; ++row) {
+        texts[row] = &displayedText(nullptr, row, col);
+    }
+    view.sort(rowCount, [&](int row) -> const std::string& { return *texts[row]; }, ascending, pool);
+}
+
+void Spreadsheet::filterByColumn(int col, const std::function<bool(const std::string&)>& keep) {
+    syncJournal();
+    std::shared_ptr<const ValueSnapshot> values = recalculator.latest();
+    const ValueSnapshot* current = values && values->version == workbook.getVersion() ? values.get() : nullptr;
+    if (lazy) {
+        lazy->sync();
+    }
+    view.filter(std::max(rows, data.getRows()), [&](int row) { return keep(displayedText(current, row, col)); });
 }
+
+void Spreadsheet::pivotToRange(int row, int col, PivotTable& pivot) {
+    ThreadPool pool;
+    pivot.aggregate(data, 0, data.getRows() - 1, pool);
+    pasteBlock(row, col, pivot.getRows());
+}
+
+void Spreadsheet::clearView() {
+    view.reset();
+}
+
+std::string Spreadsheet::getDisplayedValue(int row, int col) const {
+    if (lazy) {
+        lazy->sync();
+        return displayedText(nullptr, row, col);
+    }
+    std::shared_ptr<const ValueSnapshot> values = recalculator.latest();
+    return displayedText(values && values->version == workbook.getVersion() ? values.get() : nullptr, row, col);
+}
+
+void Spreadsheet::recalculate() {
+    recalculator.request(workbook);
+    recalculator.waitUntilIdle();
+}
+
+void Spreadsheet::setLazyEvaluation(bool enabled) {
+    if (!enabled) {
+        lazy.reset();
+    } else if (!lazy) {
+        lazy = std::make_unique<LazyEvaluator>(workbook);
+    }
+}
+
+bool Spreadsheet::hasNewValues() const {
+    return recalculator.latest() != shownSnapshot;
+}
+
+bool Spreadsheet::isRecalculating() const {
+    return recalculator.isCalculating();
+}
+
 void Spreadsheet::display(AnsiTerminal& terminal,int cursorRow, int cursorCol, int offsetRow,int offsetCol) {
     terminal.clearScreen();
+    syncJournal(); // a loaded or resized sheet drops the row view
 
     const int headerRow = 4;
+    const int visibleRows = getVisibleRows();
     const int headerCol = 8;
     const int cellWidth = 10;
 
 // Display selected cell info
-    std::string cellLabel =  getColumnLabel(cursorCol) + std::to_string(cursorRow + 1);
-    std::string cellContent = data.getValue(cursorRow + 1, cursorCol + 1); // Adjust to 1-based indexing
+    // Rows on screen are mapped through the view; labels name the row of the data
+    int cursorSource = cursorRow < visibleRows ? getSourceRow(cursorRow) : cursorRow;
+    std::string cellLabel =  getColumnLabel(cursorCol) + std::to_string(cursorSource + 1);
+    std::string cellContent = data.getValue(cursorSource + 1, cursorCol + 1); // Adjust to 1-based indexing
     std::string displayContent = cellContent.empty() ? " " : cellContent;
-    terminal.printAt(1, 2, "\033[42m " + cellLabel + " (" + std::string(1, getContentType(displayContent)) + ") " + displayContent + " \033[0m");
-
-    std::vector<std::string> operators = { "+", "-", "*", "/" };
-    std::vector<std::string> formulaLabels = { "SUM", "@SUM", "AVER", "@AVER", "STDDEV", "@STDDEV", "MAX", "@MAX", "MIN", "@MIN" };
-   
-   // The following function was implemented with assistance from ChatGPT.
-    std::unordered_map<RegexType, std::string> regexMap = {
-    { RegexType::TokenPattern, "([A-Z][0-9]{1,3}|[\\+\\-\\*/]|(SUM|@SUM|STDDEV|@STDDEV|AVER|@AVER|MAX|@MAX|MIN|@MIN)\\(([A-Z]{1,2}[0-9]{1,3})\\.\\.([A-Z]{1,2}[0-9]{1,3})\\)|-?\\d*\\.?\\d+([eE][-+]?\\d+)?|\\w+)" },
-    { RegexType::MatrixReference, "^[A-Z]{1,2}[0-9]{1,3}$" },
-    { RegexType::Formula, "^(SUM|@SUM|STDDEV|@STDDEV|AVER|@AVER|MAX|@MAX|MIN|@MIN)\\(([A-Z]{1,2}[0-9]{1,3})\\.\\.([A-Z]{1,2}[0-9]{1,3})\\)$" },
-    { RegexType::DecimalNumber, "^-?\\.\\d+$" },
-    { RegexType::GeneralNumber, "^-?\\d*\\.?\\d+([eE][-+]?\\d+)?$" },
-    { RegexType::AlphanumericLabel, ".*[A-Za-z].*[0-9].*|.*[0-9].*[A-Za-z].*" }
-};
-
-Tokenizer tokenizer(operators, formulaLabels, regexMap);
-
-    LexicalAnalysis lexicalAnalyzer(tokenizer,data);
-
-
+    char contentType = data.getNumber(cursorSource, cursorCol).numeric ? 'V' : 'L'; // classified when the cell was set
+    terminal.printAt(1, 2, "\033[42m " + cellLabel + " (" + std::string(1, contentType) + ") " + displayContent + " \033[0m");
 
+    // Values come from the worker thread; until the current version is published
+    // the previous snapshot is shown together with a "calculating" indicator.
+    // Lazily evaluated cells are computed below as they are drawn, so they are never stale.
+    bool stale = false;
+    if (lazy) {
+        lazy->sync();
+    } else {
+        recalculator.request(workbook);
+        shownSnapshot = recalculator.latest();
+        stale = !shownSnapshot || shownSnapshot->version != workbook.getVersion();
+    }
+    for (int sheet = 0; sheet < workbook.getSheetCount(); ++sheet) {
+        workbook.getSheet(sheet).enforceMemoryBudget(); // releases blocks read back by the last recalculation
+    }
 
-    terminal.printAt(2, 2, secondHeader);    // 10x10 pencere içindeki sütun başlıklarını çiz
+    terminal.printAt(2, 2, secondHeader);
+    if (stale) {
+        terminal.printInvertedAt(2, headerCol + windowSize * cellWidth - 12, " Calculating ");
+    }
+    if (view.isActive()) {
+        std::string viewLabel = " " + std::to_string(visibleRows) + " of " + std::to_string(std::max(rows, data.getRows())) + " rows ";
+        terminal.printInvertedAt(2, headerCol + windowSize * cellWidth - 14 - static_cast<int>(viewLabel.size()), viewLabel);
+    }
+    // 10x10 pencere içindeki sütun başlıklarını çiz
 
 
     for (int c = 0; c < windowSize && c + offsetCol < cols; ++c) {
@@ -99,48 +334,33 @@ Tokenizer tokenizer(operators, formulaLabels, regexMap);
     }
 
     // 10x10 pencere içindeki satır başlıklarını çiz
-    for (int r = 0; r < windowSize && r + offsetRow < rows; ++r) {
-        terminal.printAt(headerRow + r + 1, 2, "\033[42m " + std::to_string(r + offsetRow + 1) + " \033[0m");
+    for (int r = 0; r < windowSize && r + offsetRow < visibleRows; ++r) {
+        terminal.printAt(headerRow + r + 1, 2, "\033[42m " + std::to_string(getSourceRow(r + offsetRow) + 1) + " \033[0m");
     }
 
-    for (int r = 0; r < windowSize && r + offsetRow < rows; ++r) {
-        terminal.printAt(headerRow + r + 1, 2, "\033[42m " + std::to_string(r + offsetRow + 1) + " \033[0m");
+    for (int r = 0; r < windowSize && r + offsetRow < visibleRows; ++r) {
+        terminal.printAt(headerRow + r + 1, 2, "\033[42m " + std::to_string(getSourceRow(r + offsetRow) + 1) + " \033[0m");
     }
 
-    for (int r = 0; r < windowSize && r + offsetRow < rows; ++r) {
+    for (int r = 0; r < windowSize && r + offsetRow < visibleRows; ++r) {
+        int sourceRow = getSourceRow(r + offsetRow);
         for (int c = 0; c < windowSize && c + offsetCol < cols; ++c) {
             int rowPosition = headerRow + r + 1;
             int colPosition = headerCol + c * cellWidth;
 
             // Get cell content
             
-            std::string cellContent = data(r + offsetRow,c + offsetCol);
+            std::string cellContent = data(sourceRow,c + offsetCol);
             std::string displayText=" ";
             if(cellContent!= "")
             {
-                cellContent.resize(10, ' '); // Ensure fixed width for display
-
-                // Analyze the current cell
-                std::vector<Token> cellTokens = tokenizer.tokenize(data(r + offsetRow,c + offsetCol));
-                // Check for empty tokens or unknown token types
-                std::string analyzedValue;
-                if (cellTokens.empty() || cellTokens[0].type == TokenType::Unknown) {
-                    analyzedValue = cellContent.substr(0, 8); // Display raw content
+                // Show the computed value, or the raw content for cells the snapshot does not cover yet
+                if (lazy) {
+                    displayText = displayedText(nullptr, sourceRow, c + offsetCol);
                 } else {
-                    analyzedValue = lexicalAnalyzer.evaluateFormula(cellTokens);
+                    const std::string* value = shownSnapshot ? shownSnapshot->valueAt(sourceRow, c + offsetCol) : nullptr;
+                    displayText = (value && !value->empty()) ? *value : cellContent;
                 }
-
-                // Determine display text based on analysis
-                displayText = analyzedValue;
-                if (analyzedValue.find("Error") != std::string::npos) {
-                    displayText = cellContent; // Display "Err" for invalid formulas or references
-                }
-          
-            if(lexicalAnalyzer.isNumeric(displayText))
-            {
-                displayText=lexicalAnalyzer.formatDecimal(displayText);
-            }
-            
                 displayText.resize(10, ' '); // Ensure fixed width for display
             }
             else{
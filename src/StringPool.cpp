@@ -0,0 +1,58 @@
+#include "StringPool.h"
+
+#include <cctype>
+
+namespace {
+
+/**
+ * @brief Looks for a capital letter directly followed by a digit, as in every cell reference.
+ */
+bool containsCellName(const std::string& text) {
+    for (std::size_t i = 1; i < text.size(); ++i) {
+        if (std::isdigit(static_cast<unsigned char>(text[i])) && std::isupper(static_cast<unsigned char>(text[i - 1]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * @brief Looks the text up by content and appends it to the arena if it is new.
+ */
+const std::string* StringPool::intern(const std::string& text) {
+    if (text.empty()) {
+        return empty();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(std::string_view(text));
+    if (found != index.end()) {
+        return found->second;
+    }
+    texts.push_back({ text, NumberFormat::parse(text), containsCellName(text) });
+    const std::string* pooled = &texts.back().text;
+    // The key views the pooled copy, which never moves
+    index.emplace(std::string_view(*pooled), pooled);
+    // Short texts live inside the string object itself; longer ones own a heap buffer
+    const char* inlineStart = reinterpret_cast<const char*>(pooled);
+    if (pooled->data() < inlineStart || pooled->data() >= inlineStart + sizeof(std::string)) {
+        heapBytes += pooled->capacity() + 1;
+    }
+    return pooled;
+}
+
+std::size_t StringPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return texts.size();
+}
+
+/**
+ * @brief Estimates the pool's footprint; index nodes are counted as key, value and one link.
+ */
+std::size_t StringPool::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t nodeBytes = sizeof(std::string_view) + sizeof(const std::string*) + sizeof(void*);
+    return texts.size() * sizeof(PooledText) + heapBytes +
+           index.size() * nodeBytes + index.bucket_count() * sizeof(void*);
+}
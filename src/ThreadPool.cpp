@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+/**
+ * @brief Starts threadCount - 1 workers; the caller of parallelFor is the last thread.
+ */
+ThreadPool::ThreadPool(unsigned threadCount)
+    : job(nullptr), jobCount(0), jobGrain(1), nextIndex(0), generation(0), busyWorkers(0), stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Runs body over [0, count) on every thread of the pool.
+ */
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body,
+                             std::size_t grain) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<std::size_t>(1, grain);
+    if (workers.empty() || count <= grain) {
+        body(0, count); // Not worth waking the workers
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        jobCount = count;
+        jobGrain = grain;
+        nextIndex = 0;
+        busyWorkers = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    jobReady.notify_all();
+
+    executeChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock, [this]() { return busyWorkers == 0; });
+    job = nullptr;
+    if (failure) {
+        std::exception_ptr thrown = failure;
+        failure = nullptr;
+        std::rethrow_exception(thrown);
+    }
+}
+
+void ThreadPool::run() {
+    unsigned long long seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        executeChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        jobDone.notify_one();
+    }
+}
+
+void ThreadPool::executeChunks() {
+    for (;;) {
+        std::size_t begin = nextIndex.fetch_add(jobGrain);
+        if (begin >= jobCount) {
+            return;
+        }
+        try {
+            (*job)(begin, std::min(begin + jobGrain, jobCount));
+        } catch (...) {
+            // An exception leaving a worker thread would terminate the program
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    }
+}
@@ -20,20 +20,60 @@ Tokenizer::Tokenizer(const std::vector<std::string>& operators,
     }
 }
 
+/**
+ * @brief Creates a Tokenizer configured with the spreadsheet grammar.
+ * @return A Tokenizer for cell contents such as "=A1+7", "=-(A1+2)^2", "=SUM(A1..A4)", "=LOOKUP(A1;B1..B9;C1..C9)",
+ *         "=SUMIF(A1..A9;>5;B1..B9)" or "=Sheet2!A1*2".
+ */
+Tokenizer Tokenizer::createDefault() {
+    std::vector<std::string> operators = { "+", "-", "*", "/", "^", "(", ")" };
+    std::vector<std::string> formulaLabels = { "SUM", "@SUM", "AVER", "@AVER", "STDDEV", "@STDDEV", "MAX", "@MAX", "MIN", "@MIN", "LOOKUP", "@LOOKUP", "MATCH", "@MATCH",
+                                              "SUMIF", "@SUMIF", "COUNTIF", "@COUNTIF", "AVERIF", "@AVERIF" };
+
+    // The following patterns were implemented with assistance from ChatGPT.
+    // A reference, or the first cell of a range, may name another sheet of the workbook ("Sheet2!A1");
+    // a sheet name such as "Q1" is not taken for a reference
+    const std::string sheet = "(?:[A-Za-z_]\\w*!)?";
+    // The criterion of a conditional aggregate is a constant with an optional comparison, e.g. ">=5" or "=East"
+    const std::string conditional = "(SUMIF|@SUMIF|COUNTIF|@COUNTIF|AVERIF|@AVERIF)\\(" + sheet + "[A-Z]{1,2}[0-9]{1,7}\\.\\.[A-Z]{1,2}[0-9]{1,7};[^;()]*(;" + sheet + "[A-Z]{1,2}[0-9]{1,7}\\.\\.[A-Z]{1,2}[0-9]{1,7})?\\)";
+    std::unordered_map<RegexType, std::string> regexMap = {
+        { RegexType::TokenPattern, "([A-Z][0-9]{1,7}(?!\\w*!)|[\\+\\-\\*/\\^\\(\\)]|(SUM|@SUM|STDDEV|@STDDEV|AVER|@AVER|MAX|@MAX|MIN|@MIN)\\((" + sheet + "[A-Z]{1,2}[0-9]{1,7})\\.\\.([A-Z]{1,2}[0-9]{1,7})\\)|(LOOKUP|@LOOKUP|MATCH|@MATCH)\\(" + sheet + "-?[\\w.]+;" + sheet + "[A-Z]{1,2}[0-9]{1,7}\\.\\.[A-Z]{1,2}[0-9]{1,7}(;" + sheet + "[A-Z]{1,2}[0-9]{1,7}\\.\\.[A-Z]{1,2}[0-9]{1,7})?\\)|" + conditional + "|-?\\d*\\.?\\d+([eE][-+]?\\d+)?|[A-Za-z_]\\w*![A-Z]{1,2}[0-9]{1,7}|\\w+)" },
+        { RegexType::MatrixReference, "^" + sheet + "[A-Z]{1,2}[0-9]{1,7}$" },
+        { RegexType::Formula, "^(SUM|@SUM|STDDEV|@STDDEV|AVER|@AVER|MAX|@MAX|MIN|@MIN)\\((" + sheet + "[A-Z]{1,2}[0-9]{1,7})\\.\\.([A-Z]{1,2}[0-9]{1,7})\\)$|^(LOOKUP|@LOOKUP|MATCH|@MATCH)\\(" + sheet + "-?[\\w.]+;" + sheet + "[A-Z]{1,2}[0-9]{1,7}\\.\\.[A-Z]{1,2}[0-9]{1,7}(;" + sheet + "[A-Z]{1,2}[0-9]{1,7}\\.\\.[A-Z]{1,2}[0-9]{1,7})?\\)$|^" + conditional + "$" },
+        { RegexType::DecimalNumber, "^-?\\.\\d+$" },
+        { RegexType::GeneralNumber, "^-?\\d*\\.?\\d+([eE][-+]?\\d+)?$" },
+        { RegexType::AlphanumericLabel, ".*[A-Za-z].*[0-9].*|.*[0-9].*[A-Za-z].*" }
+    };
+
+    return Tokenizer(operators, formulaLabels, regexMap);
+}
+
 /**
  * @brief Tokenizes the input string into a list of tokens based on regex patterns and predefined rules.
  * @param str The input string to tokenize.
  * @return A vector of Token objects extracted from the input string.
  */
 std::vector<Token> Tokenizer::tokenize(const std::string& str) const {
+    std::vector<std::size_t> positions;
+    return tokenize(str, positions);
+}
+
+/**
+ * @brief Tokenizes the input string, recording the offset of every token.
+ * @param str The input string to tokenize.
+ * @param positions Receives the offset of every token.
+ * @return A vector of Token objects extracted from the input string.
+ */
+std::vector<Token> Tokenizer::tokenize(const std::string& str, std::vector<std::size_t>& positions) const {
     std::vector<Token> tokens;
+    positions.clear();
 
     if (regexes.find(RegexType::TokenPattern) == regexes.end()) {
         throw std::runtime_error("TokenPattern regex is not defined.");
     }
 
     // Use the TokenPattern regex for initial token matching
-    std::regex tokenRegex = regexes.at(RegexType::TokenPattern);
+    const std::regex& tokenRegex = regexes.at(RegexType::TokenPattern);
 
     auto tokensBegin = std::sregex_iterator(str.begin(), str.end(), tokenRegex);
     auto tokensEnd = std::sregex_iterator();
@@ -42,20 +82,26 @@ std::vector<Token> Tokenizer::tokenize(const std::string& str) const {
 
     for (std::sregex_iterator i = tokensBegin; i != tokensEnd; ++i) {
         std::string part = (*i).str();
+        std::size_t position = static_cast<std::size_t>((*i).position());
         Token currentToken = classifyToken(part);
 
         if (lastToken.type == TokenType::MatrixReference && currentToken.type == TokenType::MatrixReference) {
             currentToken.type = TokenType::Label;
             currentToken.value = lastToken.value + part;
             tokens.pop_back();
+            position = positions.back();
+            positions.pop_back();
         } else if (lastToken.type == TokenType::MatrixReference && currentToken.type != TokenType::Operator &&
                    currentToken.type != TokenType::Unknown) {
             currentToken.type = TokenType::Label;
             currentToken.value = lastToken.value + part;
             tokens.pop_back();
+            position = positions.back();
+            positions.pop_back();
         }
 
         tokens.push_back(currentToken);
+        positions.push_back(position);
         lastToken = currentToken;
     }
 
@@ -0,0 +1,146 @@
+#include "Workbook.h"
+#include "FormulaRewriter.h"
+
+#include <algorithm>
+#include <cctype>
+
+Workbook::Workbook() {
+    names.push_back("Sheet1");
+    sheets.push_back(std::make_unique<CellMatrix>());
+}
+
+Workbook::Workbook(const CellMatrix& first) {
+    names.push_back("Sheet1");
+    sheets.push_back(std::make_unique<CellMatrix>(first.snapshot()));
+}
+
+/**
+ * @brief Snapshots every sheet; the copy shares their blocks.
+ */
+Workbook Workbook::snapshot() const {
+    Workbook copy(*sheets[0]);
+    for (std::size_t i = 1; i < sheets.size(); ++i) {
+        copy.names.push_back(names[i]);
+        copy.sheets.push_back(std::make_unique<CellMatrix>(sheets[i]->snapshot()));
+    }
+    copy.names[0] = names[0];
+    copy.structureVersion = structureVersion;
+    return copy;
+}
+
+int Workbook::findSheet(const std::string& name) const {
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int Workbook::addSheet(const std::string& name) {
+    if (!isValidSheetName(name) || findSheet(name) >= 0) {
+        return -1;
+    }
+    names.push_back(name);
+    sheets.push_back(std::make_unique<CellMatrix>());
+    ++structureVersion; // the new sheet starts at version 0
+    return static_cast<int>(sheets.size()) - 1;
+}
+
+bool Workbook::removeSheet(int index) {
+    if (index <= 0 || index >= getSheetCount()) {
+        return false;
+    }
+    // The removed versions stay counted, so the total never decreases
+    structureVersion += sheets[index]->getVersion() + 1;
+    names.erase(names.begin() + index);
+    sheets.erase(sheets.begin() + index);
+    return true;
+}
+
+void Workbook::insertRows(int sheet, int row, int count) {
+    if (sheet < 0 || sheet >= getSheetCount() || row < 1 || row > sheets[sheet]->getRows() || count <= 0) {
+        return;
+    }
+    sheets[sheet]->insertRows(row, count);
+    moveReferences(sheet, true, row - 1, count);
+}
+
+void Workbook::deleteRows(int sheet, int row, int count) {
+    if (sheet < 0 || sheet >= getSheetCount() || row < 1 || row > sheets[sheet]->getRows() || count <= 0) {
+        return;
+    }
+    count = std::min(count, sheets[sheet]->getRows() - row + 1);
+    sheets[sheet]->deleteRows(row, count);
+    moveReferences(sheet, true, row - 1, -count);
+}
+
+void Workbook::insertColumns(int sheet, int col, int count) {
+    if (sheet < 0 || sheet >= getSheetCount() || col < 1 || col > sheets[sheet]->getCols() || count <= 0) {
+        return;
+    }
+    sheets[sheet]->insertColumns(col, count);
+    moveReferences(sheet, false, col - 1, count);
+}
+
+void Workbook::deleteColumns(int sheet, int col, int count) {
+    if (sheet < 0 || sheet >= getSheetCount() || col < 1 || col > sheets[sheet]->getCols() || count <= 0) {
+        return;
+    }
+    count = std::min(count, sheets[sheet]->getCols() - col + 1);
+    sheets[sheet]->deleteColumns(col, count);
+    moveReferences(sheet, false, col - 1, -count);
+}
+
+/**
+ * @brief Moves the ends of every area naming the edited sheet; an end inside deleted cells moves to the nearest kept one.
+ */
+void Workbook::moveReferences(int sheet, bool byRow, int at, int count) {
+    Tokenizer tokenizer = Tokenizer::createDefault();
+    FormulaRewriter rewriter(tokenizer);
+    for (int target = 0; target < getSheetCount(); ++target) {
+        FormulaRewriter::Move move = [&](ReferenceArea& area) {
+            if ((area.sheet.empty() ? target : findSheet(area.sheet)) != sheet) {
+                return true;
+            }
+            int& first = byRow ? area.startRow : area.startCol;
+            int& last = byRow ? area.endRow : area.endCol;
+            if (first > last) {
+                std::swap(first, last);
+            }
+            if (count > 0) {
+                first += first >= at ? count : 0;
+                last += last >= at ? count : 0;
+                return true;
+            }
+            int end = at - count; // first cell kept after the deleted ones
+            first = first >= end ? first + count : std::min(first, at);
+            last = last >= end ? last + count : std::min(last, at - 1);
+            return first <= last;
+        };
+        sheets[target]->rewriteReferences([&](const std::string& text) { return rewriter.rewrite(text, move); });
+    }
+}
+
+/**
+ * @brief Sums the sheet versions; each of them only ever grows.
+ */
+std::uint64_t Workbook::getVersion() const {
+    std::uint64_t version = structureVersion;
+    for (const auto& sheet : sheets) {
+        version += sheet->getVersion();
+    }
+    return version;
+}
+
+bool Workbook::isValidSheetName(const std::string& name) {
+    if (name.empty() || !(std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_')) {
+        return false;
+    }
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
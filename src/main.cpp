@@ -1,8 +1,13 @@
 #include "AnsiTerminal.h"
 #include "Spreadsheet.h"
+#include "FileTask.h"
 
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 #include <string.h>
+#include <cstdlib>
+#include <cctype>
 enum class ProgramMode {
     MainMenu,
     Spreadsheet
@@ -25,7 +30,8 @@ void updateOffsets(int& offsetRow, int& offsetCol, int cursorRow, int cursorCol,
     else if (cursorCol >= offsetCol + windowSize) offsetCol = cursorCol - windowSize + 1;  // Sağ kenara ulaştı
 }
 void updateCellContent(Spreadsheet& sheet, int cursorRow, int cursorCol, char key, int& prevRow, int& prevCol) {
-    std::string currentContent = sheet.data.getValue(cursorRow + 1, cursorCol + 1); // Mevcut içeriği al
+    int sourceRow = sheet.getSourceRow(cursorRow); // the cursor row is a row on screen, possibly sorted
+    std::string currentContent = sheet.data.getValue(sourceRow + 1, cursorCol + 1); // Mevcut içeriği al
     if (cursorRow == prevRow && cursorCol == prevCol) {
         // Aynı hücredeyiz, mevcut içeriğe karakter ekle
         currentContent += key; 
@@ -33,57 +39,185 @@ void updateCellContent(Spreadsheet& sheet, int cursorRow, int cursorCol, char ke
         // Yeni hücreye geçildi, yeni karakteri başlat
         currentContent = key;
     }
-    // Güncellenmiş içeriği ata ve ikinci başlığı güncelle
-    sheet.data.setValue(cursorRow + 1, cursorCol + 1, currentContent);
+    // Güncellenmiş içeriği ata ve ikinci başlığı güncelle; aynı hücredeki tuşlar tek geri alma adımıdır
+    sheet.setCell(sourceRow, cursorCol, currentContent, cursorRow == prevRow && cursorCol == prevCol);
     sheet.setSecondHeader(currentContent);
     prevRow = cursorRow;
     prevCol = cursorCol;
 }
+// Prompts, progress and results share the line below the main menu; each replaces the previous one
+void printStatus(AnsiTerminal& terminal, int windowSize, const std::string& text) {
+    terminal.printAt(windowSize + 7, 1, "\033[K");
+    terminal.printInvertedAt(windowSize + 7, 2, text);
+}
+
 // Helper function to get file name from user
-std::string getFileNameFromUser(AnsiTerminal& terminal, int windowSize, const std::string& promptMessage, int offsetX) {
-    terminal.printInvertedAt(windowSize + 6, offsetX, promptMessage);
+std::string getFileNameFromUser(AnsiTerminal& terminal, int windowSize, const std::string& promptMessage) {
+    printStatus(terminal, windowSize, promptMessage);
     std::string filename;
     char fileInputChar;
-    int currentX = offsetX + promptMessage.length() + 2; // Başlangıç pozisyonu
+    int currentX = 2 + promptMessage.length() + 2; // Başlangıç pozisyonu
 
     while ((fileInputChar = terminal.getSpecialKey()) != '\n') {
         filename += fileInputChar;
-        terminal.printInvertedAt(windowSize + 6, currentX, filename);
+        terminal.printInvertedAt(windowSize + 7, currentX, filename);
     }
     return filename;
 }
 
-void handleMainMenu(Spreadsheet& sheet, AnsiTerminal& terminal, ProgramMode& mode, int windowSize, std::string& currentFile) {
+// Recalculates the sheet with profiling enabled and lists the most expensive cells
+void showProfile(Spreadsheet& sheet, AnsiTerminal& terminal, int windowSize) {
+    const std::size_t topCount = 10;
+    EvaluationProfiler profiler;
+    sheet.profile(profiler);
+
+    terminal.clearScreen();
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3) << "Profile: " << profiler.getCellCount()
+            << " cells evaluated, total recalculation " << profiler.getRecalculationMs() << " ms";
+    terminal.printInvertedAt(1, 2, summary.str());
+    terminal.printAt(3, 2, "Cell       Evals   Self(us)  Total(us)  Depth   Refs");
+
+    int line = 4;
+    for (const auto& cell : profiler.topCells(topCount)) {
+        std::ostringstream row;
+        row << std::left << std::setw(10) << sheet.getColumnLabel(cell.col) + std::to_string(cell.row + 1)
+            << std::right << std::setw(6) << cell.evaluations
+            << std::fixed << std::setprecision(1)
+            << std::setw(11) << cell.selfNs / 1000 << std::setw(11) << cell.totalNs / 1000
+            << std::setw(7) << cell.maxDepth << std::setw(7) << cell.referencedCells;
+        terminal.printAt(line++, 2, row.str());
+    }
+
+    terminal.printInvertedAt(windowSize + 6, 2, "e. Export to profile.csv | any other key. Back");
+    if (terminal.getSpecialKey() == 'e') {
+        profiler.exportToFile("profile.csv", topCount);
+    }
+}
+
+// Formats the status line of a running load or save, e.g. "Loading 45% (120 of 266 KB, 1200 rows)"
+std::string formatProgress(FileTask& task) {
+    IoProgress& progress = task.getProgress();
+    std::uint64_t done = progress.bytesDone;
+    std::uint64_t total = progress.bytesTotal;
+    std::ostringstream status;
+    status << (task.isLoad() ? "Loading " : "Saving ") << (total > 0 ? done * 100 / total : 100) << "% ("
+           << done / 1024 << " of " << total / 1024 << " KB, " << progress.rowsDone << " rows) | c. Cancel";
+    return status.str();
+}
+
+// Waits for a background load or save while showing its progress; 'c' cancels it.
+// A load into the sheet displays its first screen of rows as soon as they are parsed;
+// other loads leave their data in the task.
+bool runFileTask(FileTask& task, Spreadsheet& sheet, AnsiTerminal& terminal, int windowSize, bool intoSheet = true) {
+    CellMatrix previous = sheet.data.snapshot(); // restored if a previewed load does not complete
+    bool previewShown = false;
+    while (!task.isFinished()) {
+        std::shared_ptr<const CellMatrix> preview = task.getProgress().takePreview();
+        if (preview && intoSheet) {
+            sheet.data.replaceWith(*preview);
+            sheet.display(terminal, 0, 0, 0, 0);
+            previewShown = true;
+        }
+        printStatus(terminal, windowSize, formatProgress(task));
+        if (terminal.waitForInput(100) && terminal.getSpecialKey() == 'c') {
+            task.cancel();
+        }
+    }
+
+    if (task.succeeded()) {
+        if (task.isLoad() && intoSheet) {
+            sheet.data.replaceWith(task.getData());
+        }
+        return true;
+    }
+    if (previewShown) {
+        sheet.data.replaceWith(previous);
+    }
+    return false;
+}
+
+// Loaded sheets with more cells than this evaluate the cells on screen instead of recalculating everything
+const std::size_t lazyEvaluationCells = 100000;
+
+// Names the sheet of a file after its base name, e.g. "data/Sales 2024.csv" becomes "Sales_2024"
+std::string sheetNameFromFile(const std::string& path) {
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    name = name.substr(0, name.find('.'));
+    for (char& c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c))) c = '_';
+    }
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) name = "_" + name;
+    return name;
+}
+
+// The file holds the first sheet; every other sheet is written in full beside it, named after the sheet so that
+// "Add Sheet" loads it back under the same name, e.g. "data/Sales.csv" beside "data/book.csv". Returns the status.
+std::string saveOtherSheets(Spreadsheet& sheet, AnsiTerminal& terminal, int windowSize, const std::string& file,
+                            const std::string& message) {
+    std::string directory = file.substr(0, file.find_last_of("/\\") + 1);
+    std::string written;
+    for (int i = 1; i < sheet.workbook.getSheetCount(); ++i) {
+        const std::string& name = sheet.workbook.getSheetName(i);
+        std::string sheetFile = directory + name + ".csv";
+        if (sheetFile == file) {
+            return "Sheet " + name + " not saved: it would overwrite " + file;
+        }
+        FileTask task(sheetFile, sheet.workbook.getSheet(i));
+        if (!runFileTask(task, sheet, terminal, windowSize, false)) {
+            return task.wasCancelled() ? "Saving cancelled." : "Failed to save sheet " + name + " to " + sheetFile;
+        }
+        written += (i > 1 ? ", " : "") + sheetFile;
+    }
+    return written.empty() ? message : message + " (other sheets: " + written + ")";
+}
+
+void handleMainMenu(Spreadsheet& sheet, AnsiTerminal& terminal, ProgramMode& mode, int windowSize, std::string& currentFile,
+                    std::uint64_t& fileVersion) {
     terminal.clearScreen();
     
     // Current filename information2
     std::string currentFileDisplay = currentFile.empty() ? "Untitled" : currentFile;
 
     // Main menu and current file name
-    std::string DownTabMenu = "1. Create New | 2. Select File | 3. Save File | 4. Save As | 5. Show Current File | q. Quit";
+    std::string DownTabMenu = "1. Create New | 2. Select File | 3. Save File | 4. Save As | 5. Show Current File | 6. Profile | 7. Compact File | 8. Add Sheet | 9. Pivot | q. Quit";
     terminal.printInvertedAt(windowSize + 6, 2, DownTabMenu);
     terminal.printInvertedAt(windowSize + 8, 2, "Current File: " + currentFileDisplay);
+    // Formulas read the other sheets by name, e.g. "=Sales!B2" or "=SUM(Sales!B1..B9)"
+    std::string sheetNames = "Sheets: " + sheet.workbook.getSheetName(0);
+    for (int i = 1; i < sheet.workbook.getSheetCount(); ++i) {
+        sheetNames += ", " + sheet.workbook.getSheetName(i);
+    }
+    terminal.printInvertedAt(windowSize + 9, 2, sheetNames);
 
-    // Dynamically calculate starting X position
-    int offsetX = DownTabMenu.length() + 5;
+    // The result of the previous command stays below the menu until the next one
+    static std::string status;
+    printStatus(terminal, windowSize, status);
+    status.clear();
 
     char inputKey = terminal.getSpecialKey(); // get User Input
     switch (inputKey) {
         case '1': { 
             sheet.createNew(20, 20); // Create a new table
+            sheet.setLazyEvaluation(false);
             currentFile.clear();   // The filename for the new table is cleared
+            sheet.setAutosavePath("untitled.csv.autosave");
             mode = ProgramMode::Spreadsheet; // go Spreadsheet mod
             break;
         }
         case '2': {
             // Dosya adını kullanıcıdan al
-            currentFile = getFileNameFromUser(terminal, windowSize, "Enter file name to load: ", offsetX);
+            currentFile = getFileNameFromUser(terminal, windowSize, "Enter file name to load: ");
 
-            if (sheet.data.loadFromFile(currentFile)) {
-                terminal.printInvertedAt(windowSize + 6, offsetX, "File loaded successfully");
+            FileTask task(currentFile, windowSize);
+            if (runFileTask(task, sheet, terminal, windowSize)) {
+                status = "File loaded successfully";
+                sheet.setLazyEvaluation(static_cast<std::size_t>(sheet.data.getRows()) * sheet.data.getCols() > lazyEvaluationCells);
+                sheet.setAutosavePath(currentFile + ".autosave"); // never overwrites the file itself
+                fileVersion = sheet.data.getVersion(); // the file and its change log hold this version
                 mode = ProgramMode::Spreadsheet; // go Spreadsheet mod
             } else {
-                terminal.printInvertedAt(windowSize + 6, offsetX, "Failed to load file.");
+                status = task.wasCancelled() ? "Loading cancelled." : "Failed to load file.";
                 currentFile.clear(); // In case of incorrect loading, the file name is cleared
             }
             break;
@@ -91,22 +225,30 @@ void handleMainMenu(Spreadsheet& sheet, AnsiTerminal& terminal, ProgramMode& mod
         case '3': {
             // Save File
             if (currentFile.empty()) {
-                terminal.printInvertedAt(windowSize + 6, offsetX, "No file name. Use 'Save As' instead.");
-            } else if (sheet.data.saveToFile(currentFile)) {
-                terminal.printInvertedAt(windowSize + 6, offsetX, "File saved successfully");
+                status = "No file name. Use 'Save As' instead.";
             } else {
-                terminal.printInvertedAt(windowSize + 6, offsetX, "Failed to save file.");
+                // Only the cells edited since the last load or save are appended to the change log
+                FileTask task(currentFile, sheet.data, fileVersion);
+                if (runFileTask(task, sheet, terminal, windowSize)) {
+                    fileVersion = task.getData().getVersion();
+                    status = saveOtherSheets(sheet, terminal, windowSize, currentFile, "File saved successfully");
+                } else {
+                    status = task.wasCancelled() ? "Saving cancelled." : "Failed to save file.";
+                }
             }
             break;
         }
         case '4': {
             // Save As
-            std::string newFileName = getFileNameFromUser(terminal, windowSize, "Enter file name to save as: ", offsetX);
-            if (sheet.data.saveToFile(newFileName)) {
+            std::string newFileName = getFileNameFromUser(terminal, windowSize, "Enter file name to save as: ");
+            FileTask task(newFileName, sheet.data);
+            if (runFileTask(task, sheet, terminal, windowSize)) {
                 currentFile = newFileName; // Update as new file name
-                terminal.printInvertedAt(windowSize + 6, offsetX, "File saved successfully");
+                sheet.setAutosavePath(currentFile + ".autosave");
+                fileVersion = task.getData().getVersion();
+                status = saveOtherSheets(sheet, terminal, windowSize, currentFile, "File saved successfully");
             } else {
-                terminal.printInvertedAt(windowSize + 6, offsetX, "Failed to save file.");
+                status = task.wasCancelled() ? "Saving cancelled." : "Failed to save file.";
             }
             break;
         }
@@ -114,7 +256,7 @@ void handleMainMenu(Spreadsheet& sheet, AnsiTerminal& terminal, ProgramMode& mod
         {
             if(currentFile.empty())
             {
-                terminal.printInvertedAt(windowSize + 6, offsetX, "File is not exist, you can Create New");
+                status = "File is not exist, you can Create New";
             }
             else
             {
@@ -122,6 +264,74 @@ void handleMainMenu(Spreadsheet& sheet, AnsiTerminal& terminal, ProgramMode& mod
             }
           break;
         }
+        case '6': {
+            showProfile(sheet, terminal, windowSize);
+            break;
+        }
+        case '7': {
+            // Rewrite the whole file, folding the change log into it
+            if (currentFile.empty()) {
+                status = "No file name. Use 'Save As' instead.";
+            } else {
+                FileTask task(currentFile, sheet.data);
+                if (runFileTask(task, sheet, terminal, windowSize)) {
+                    fileVersion = task.getData().getVersion();
+                    status = saveOtherSheets(sheet, terminal, windowSize, currentFile, "File compacted successfully");
+                } else {
+                    status = task.wasCancelled() ? "Saving cancelled." : "Failed to save file.";
+                }
+            }
+            break;
+        }
+        case '8': {
+            // Load a CSV as another sheet of the workbook, named after the file
+            std::string sheetFile = getFileNameFromUser(terminal, windowSize, "Enter file name to add as a sheet: ");
+            std::string name = sheetNameFromFile(sheetFile);
+            if (sheet.workbook.findSheet(name) >= 0) {
+                status = "Sheet " + name + " already exists.";
+                break;
+            }
+            FileTask task(sheetFile, windowSize);
+            if (runFileTask(task, sheet, terminal, windowSize, false)) {
+                CellMatrix& added = sheet.workbook.getSheet(sheet.workbook.addSheet(name));
+                added.setMemoryBudget(sheet.data.getMemoryBudget());
+                added.replaceWith(task.getData());
+                status = "Sheet " + name + " added";
+            } else {
+                status = task.wasCancelled() ? "Loading cancelled." : "Failed to load file.";
+            }
+            break;
+        }
+        case '9': {
+            // Group the rows of the sheet, e.g. by "A,B" with "SUM(C),AVER(D)", and paste the result at a cell
+            std::vector<int> keyColumns;
+            std::vector<PivotValue> values;
+            std::string keys = getFileNameFromUser(terminal, windowSize, "Group by columns (e.g. A,B): ");
+            if (!PivotTable::parseColumns(keys, keyColumns)) {
+                status = "Invalid columns.";
+                break;
+            }
+            std::string aggregates = getFileNameFromUser(terminal, windowSize, "Aggregates (e.g. SUM(C),AVER(D)): ");
+            if (!PivotTable::parseValues(aggregates, values)) {
+                status = "Invalid aggregates.";
+                break;
+            }
+            std::string target = getFileNameFromUser(terminal, windowSize, "Paste the result at cell (e.g. H1): ");
+            for (char& c : target) {
+                c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            }
+            // The result may extend the sheet, but must start inside it or next to it
+            int row, col;
+            if (!LexicalAnalysis::parseCellReference(target, row, col) || row < 0 || col < 0 ||
+                row > sheet.data.getRows() || col > sheet.data.getCols()) {
+                status = "Invalid cell.";
+                break;
+            }
+            PivotTable pivot(keyColumns, values);
+            sheet.pivotToRange(row, col, pivot);
+            mode = ProgramMode::Spreadsheet; // show the result with the data
+            break;
+        }
         case 'q': {
             mode = ProgramMode::MainMenu;
             break;
@@ -136,14 +346,75 @@ void handleSpreadsheet(Spreadsheet& sheet, AnsiTerminal& terminal, ProgramMode&
                        int& offsetRow, int& offsetCol, int windowSize, bool& editingMode, int& prevRow, int& prevCol) {
     updateOffsets(offsetRow, offsetCol, cursorRow, cursorCol, windowSize); // Ofseti güncelle
     sheet.display(terminal, cursorRow, cursorCol, offsetRow, offsetCol); // Spread sheet'i göster
+    // Recalculation runs in the background; repaint when its values arrive, without blocking keystrokes
+    while (!terminal.waitForInput(50)) {
+        if (sheet.hasNewValues()) {
+            sheet.display(terminal, cursorRow, cursorCol, offsetRow, offsetCol);
+        }
+    }
     char inputKey = terminal.getSpecialKey(); // Kullanıcı girdisi al
 
     if (inputKey == 'q') {
         mode = ProgramMode::MainMenu; // Ana menüye dön
         prevRow = -1;
         prevCol = -1;
+    } else if (inputKey == static_cast<char>('u' | 0x80) || inputKey == static_cast<char>('r' | 0x80)) {
+        // Alt+U undoes and Alt+R redoes the last edit; the cursor moves to the restored cell
+        int row, col;
+        bool applied = inputKey == static_cast<char>('u' | 0x80) ? sheet.undo(row, col) : sheet.redo(row, col);
+        if (applied) {
+            if (sheet.getViewRow(row) < 0) {
+                sheet.clearView(); // the restored cell was filtered out
+            }
+            cursorRow = sheet.getViewRow(row);
+            cursorCol = col;
+            std::string restored = sheet.data.getValue(row + 1, col + 1);
+            sheet.setSecondHeader(restored.empty() ? " " : restored);
+        }
+        editingMode = false;
+        prevRow = -1;
+        prevCol = -1;
+    } else if (inputKey == static_cast<char>('s' | 0x80) || inputKey == static_cast<char>('f' | 0x80) ||
+               inputKey == static_cast<char>('c' | 0x80)) {
+        // Alt+S sorts by the cursor column (again to reverse), Alt+F keeps the rows matching the cursor cell,
+        // Alt+C shows every row again; the cursor stays on the same cell of the data
+        static int sortedCol = -1;
+        static bool sortedAscending = false;
+        int sourceRow = sheet.getSourceRow(cursorRow);
+        if (inputKey == static_cast<char>('s' | 0x80)) {
+            sortedAscending = sortedCol == cursorCol ? !sortedAscending : true;
+            sortedCol = cursorCol;
+            sheet.sortByColumn(cursorCol, sortedAscending);
+        } else if (inputKey == static_cast<char>('f' | 0x80)) {
+            std::string key = sheet.getDisplayedValue(sourceRow, cursorCol);
+            sheet.filterByColumn(cursorCol, [&key](const std::string& value) { return value == key; });
+        } else {
+            sheet.clearView();
+            sortedCol = -1;
+        }
+        cursorRow = std::max(0, sheet.getViewRow(sourceRow));
+        editingMode = false;
+        prevRow = -1;
+        prevCol = -1;
+    } else if (inputKey == static_cast<char>('i' | 0x80) || inputKey == static_cast<char>('d' | 0x80) ||
+               inputKey == static_cast<char>('j' | 0x80) || inputKey == static_cast<char>('k' | 0x80)) {
+        // Alt+I inserts a row above the cursor and Alt+D deletes it; Alt+J and Alt+K do the same for its column
+        int sourceRow = sheet.getSourceRow(cursorRow);
+        if (inputKey == static_cast<char>('i' | 0x80)) {
+            sheet.insertRows(sourceRow, 1);
+        } else if (inputKey == static_cast<char>('d' | 0x80)) {
+            sheet.deleteRows(sourceRow, 1);
+        } else if (inputKey == static_cast<char>('j' | 0x80)) {
+            sheet.insertColumns(cursorCol, 1);
+        } else {
+            sheet.deleteColumns(cursorCol, 1);
+        }
+        cursorRow = std::min(sourceRow, std::max(0, sheet.getVisibleRows() - 1));
+        editingMode = false;
+        prevRow = -1;
+        prevCol = -1;
     } else if (strchr("UDLR", inputKey) && !editingMode) {
-        handleNavigation(inputKey, cursorRow, cursorCol, sheet.getRows(), sheet.getCols());
+        handleNavigation(inputKey, cursorRow, cursorCol, sheet.getVisibleRows(), sheet.getCols());
     } else if (inputKey == '\n') {
         editingMode = false;
         prevRow = -1;
@@ -158,6 +429,10 @@ void handleSpreadsheet(Spreadsheet& sheet, AnsiTerminal& terminal, ProgramMode&
 int main() {
     AnsiTerminal terminal;
     Spreadsheet sheet(20, 40); // 20 satır ve 8 sütunluk bir tablo oluşturun
+    // SPREADSHEET_MEMORY_MB caps the memory of the cells on shared servers; colder rows are spilled to a temporary file
+    if (const char* budget = std::getenv("SPREADSHEET_MEMORY_MB")) {
+        sheet.data.setMemoryBudget(static_cast<std::size_t>(std::strtoull(budget, nullptr, 10)) << 20);
+    }
     ProgramMode mode = ProgramMode::MainMenu; // Başlangıç modu menü
 
 
@@ -173,12 +448,12 @@ int main() {
     bool editingMode=false;
     // std::string DownTabMenu ="Create New(1)  Select File(2) Save Current File(3) 4.Show Current File Quit(q)";//std::string DownTabMenu[4]={ "Create New(1)","Select File(2)"," Save Current File(3)", "Quit(q)"};
     // std::string DownTabMenuSelection="   ";
-    char fileInputChar='_';
     std::string filename="";
+    std::uint64_t fileVersion = 0; // data version held by the current file
   while (running) {
         switch (mode) {
             case ProgramMode::MainMenu:
-                handleMainMenu(sheet, terminal, mode, windowSize, filename);
+                handleMainMenu(sheet, terminal, mode, windowSize, filename, fileVersion);
                 break;
             case ProgramMode::Spreadsheet:
                 handleSpreadsheet(sheet, terminal, mode, cursorRow, cursorCol, offsetRow, offsetCol, 
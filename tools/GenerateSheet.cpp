@@ -0,0 +1,59 @@
+/**
+ * @file GenerateSheet.cpp
+ * @brief Command line tool writing a synthetic spreadsheet as CSV.
+ *
+ * Usage: GenerateSheet [--rows N] [--cols N] [--formula-ratio F] [--label-ratio F]
+ *                      [--chain-weight N] [--sum-weight N] [--arith-weight N]
+ *                      [--chain-depth N] [--fan-in N] [--seed N] [--out FILE]
+ *
+ * Without --out the sheet is written to standard output.
+ */
+
+#include "SheetGenerator.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static const char* usage =
+    "Usage: GenerateSheet [--rows N] [--cols N] [--formula-ratio F] [--label-ratio F]\n"
+    "                     [--chain-weight N] [--sum-weight N] [--arith-weight N]\n"
+    "                     [--chain-depth N] [--fan-in N] [--seed N] [--out FILE]\n";
+
+int main(int argc, char** argv) {
+    GeneratorOptions options;
+    std::string outFile;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--rows") options.rows = std::stoi(value);
+            else if (arg == "--cols") options.cols = std::stoi(value);
+            else if (arg == "--formula-ratio") options.formulaRatio = std::stod(value);
+            else if (arg == "--label-ratio") options.labelRatio = std::stod(value);
+            else if (arg == "--chain-weight") options.chainWeight = std::stoi(value);
+            else if (arg == "--sum-weight") options.sumWeight = std::stoi(value);
+            else if (arg == "--arith-weight") options.arithWeight = std::stoi(value);
+            else if (arg == "--chain-depth") options.chainDepth = std::stoi(value);
+            else if (arg == "--fan-in") options.fanIn = std::stoi(value);
+            else if (arg == "--seed") options.seed = std::stoull(value);
+            else if (arg == "--out") outFile = value;
+            else throw std::invalid_argument("Unknown option " + arg);
+        }
+
+        SheetGenerator generator(options);
+        if (outFile.empty()) {
+            generator.write(std::cout);
+        } else if (!generator.writeToFile(outFile)) {
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n" << usage;
+        return 1;
+    }
+    return 0;
+}